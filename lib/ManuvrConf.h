@@ -44,6 +44,9 @@ This is where definition of (application or device)-specific parameters ought to
 #define CPLD_SPI_MAX_QUEUE_DEPTH  40
 #define CPLD_SPI_MAX_QUEUE_PRINT   3
 #define PREALLOCD_IMU_FRAMES       6
+#define PREALLOCD_RAW_FRAMES      16
+//#define CONFIG_INTEGRATOR_FILTER  MAHONY   // MAHONY, MADGWICK (default), or ESKF.
+//#define CONFIG_INTEGRATOR_THREADED         // Integrate in a thread apart from the kernel.
 
 #define CONFIG_MANUVR_BENCHMARKS
 #define MANUVR_DEBUG
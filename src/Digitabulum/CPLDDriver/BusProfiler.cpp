@@ -0,0 +1,198 @@
+/*
+File:   BusProfiler.cpp
+Author: J. Ian Lindsay
+Date:   2017.10.22
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "BusProfiler.h"
+#include <Platform/Peripherals/SPI/SPIBusOp.h>
+
+// No opcode is this large, so these are never real keys.
+#define BUS_PROFILER_KEY_UNUSED  0xFFFF
+#define BUS_PROFILER_KEY_OTHER   0xFFFE
+
+
+/*******************************************************************************
+*   ___ _              ___      _ _              _      _
+*  / __| |__ _ ______ | _ ) ___(_) |___ _ _ _ __| |__ _| |_ ___
+* | (__| / _` (_-<_-< | _ \/ _ \ | / -_) '_| '_ \ / _` |  _/ -_)
+*  \___|_\__,_/__/__/ |___/\___/_|_\___|_| | .__/_\__,_|\__\___|
+*                                          |_|
+* Constructors/destructors, class initialization functions and so-forth...
+*******************************************************************************/
+
+BusProfiler::BusProfiler() {
+  reset();
+}
+
+
+/**
+* Clears every row.
+*/
+void BusProfiler::reset() {
+  for (uint8_t r = 0; r < BUS_PROFILER_ROWS; r++) {
+    ProfileRow* row = &_rows[r];
+    row->key   = BUS_PROFILER_KEY_UNUSED;
+    row->count = 0;
+    for (uint8_t s = 0; s < BUS_PROFILER_STAGES; s++) {
+      row->total_us[s] = 0;
+      row->max_us[s]   = 0;
+      for (uint8_t b = 0; b < BUS_PROFILER_BUCKETS; b++) {
+        row->hist[s][b] = 0;
+      }
+    }
+  }
+  _recorded = 0;
+}
+
+
+/**
+* Finds the row for the given key, claiming an unused one if need be. If the
+*   table is full, the last row catches the overflow.
+*
+* @param  key  (addr << 8) | opcode
+* @return The row to count into. Never nullptr.
+*/
+BusProfiler::ProfileRow* BusProfiler::_row_for(uint16_t key) {
+  for (uint8_t r = 0; r < (BUS_PROFILER_ROWS - 1); r++) {
+    if (key == _rows[r].key) return &_rows[r];
+    if (BUS_PROFILER_KEY_UNUSED == _rows[r].key) {
+      _rows[r].key = key;
+      return &_rows[r];
+    }
+  }
+  _rows[BUS_PROFILER_ROWS - 1].key = BUS_PROFILER_KEY_OTHER;
+  return &_rows[BUS_PROFILER_ROWS - 1];
+}
+
+
+/**
+* Bins one bus operation's timestamps. Timestamps are micros() values, and
+*   must be in order. Wrap-around is handled by unsigned subtraction.
+*
+* @param  addr        The op's first transfer parameter.
+* @param  opcode      The op's opcode, as an integer.
+* @param  t_queued    Time of queue insertion.
+* @param  t_began     Time of the call to begin().
+* @param  t_done      Time the transfer finished.
+* @param  t_cb_start  Time the callback was entered.
+* @param  t_cb_end    Time the callback returned.
+*/
+void BusProfiler::record(uint8_t addr, uint8_t opcode, uint32_t t_queued, uint32_t t_began, uint32_t t_done, uint32_t t_cb_start, uint32_t t_cb_end) {
+  const uint32_t d[BUS_PROFILER_STAGES] = {
+    t_began    - t_queued,
+    t_done     - t_began,
+    t_cb_start - t_done,
+    t_cb_end   - t_cb_start
+  };
+  ProfileRow* row = _row_for(((uint16_t) addr << 8) | opcode);
+  row->count++;
+  for (uint8_t s = 0; s < BUS_PROFILER_STAGES; s++) {
+    uint16_t* bin = &row->hist[s][_bucket(d[s])];
+    if (*bin < 0xFFFF) (*bin)++;
+    row->total_us[s] += d[s];
+    if (d[s] > row->max_us[s]) row->max_us[s] = d[s];
+  }
+  _recorded++;
+}
+
+
+/**
+* @param  s  The stage.
+* @return A short name for the stage.
+*/
+const char* BusProfiler::stageString(BusStage s) {
+  switch (s) {
+    case BusStage::QUEUE:     return "QUEUE";
+    case BusStage::XFER:      return "XFER";
+    case BusStage::DISPATCH:  return "DISPATCH";
+    case BusStage::CALLBACK:  return "CALLBACK";
+  }
+  return "?";
+}
+
+
+/**
+* Debug support method. Prints the average and worst case of each stage for
+*   each row, followed by the non-empty buckets.
+*
+* @param  output  The buffer to receive the output.
+*/
+void BusProfiler::printDebug(StringBuilder* output) {
+  output->concatf("-- Bus profile (%u ops)\n", (unsigned int) _recorded);
+  for (uint8_t r = 0; r < BUS_PROFILER_ROWS; r++) {
+    ProfileRow* row = &_rows[r];
+    if ((BUS_PROFILER_KEY_UNUSED == row->key) || (0 == row->count)) continue;
+    if (BUS_PROFILER_KEY_OTHER == row->key) {
+      output->concatf("--   (other)         %u ops\n", (unsigned int) row->count);
+    }
+    else {
+      output->concatf("--   0x%02x %-10s  %u ops\n",
+        (row->key >> 8),
+        BusOp::getOpcodeString((BusOpcode) (row->key & 0xFF)),
+        (unsigned int) row->count
+      );
+    }
+    for (uint8_t s = 0; s < BUS_PROFILER_STAGES; s++) {
+      output->concatf("--     %-8s  avg %6uus  max %6uus  |",
+        stageString((BusStage) s),
+        (unsigned int) (row->total_us[s] / row->count),
+        (unsigned int) row->max_us[s]
+      );
+      for (uint8_t b = 0; b < BUS_PROFILER_BUCKETS; b++) {
+        if (row->hist[s][b]) output->concatf(" <%u:%u", (1u << b), row->hist[s][b]);
+      }
+      output->concat("\n");
+    }
+  }
+}
+
+
+/**
+* Machine-readable dump. One line per row and stage, comma-separated:
+*   addr,opcode,stage,count,total_us,max_us,b0,b1,...,b15
+* addr is 256 for the overflow row, since 255 is a real address. The bucket edges are in the header line.
+*
+* @param  output  The buffer to receive the output.
+*/
+void BusProfiler::serialize(StringBuilder* output) {
+  output->concatf("#busprof,2,%u,%u", (unsigned int) _recorded, BUS_PROFILER_BUCKETS);
+  for (uint8_t b = 0; b < BUS_PROFILER_BUCKETS; b++) {
+    output->concatf(",%u", (0 == b) ? 0 : (1u << (b - 1)));
+  }
+  output->concat("\n");
+  for (uint8_t r = 0; r < BUS_PROFILER_ROWS; r++) {
+    ProfileRow* row = &_rows[r];
+    if ((BUS_PROFILER_KEY_UNUSED == row->key) || (0 == row->count)) continue;
+    const bool other = (BUS_PROFILER_KEY_OTHER == row->key);
+    for (uint8_t s = 0; s < BUS_PROFILER_STAGES; s++) {
+      output->concatf("%u,%u,%u,%u,%u,%u",
+        other ? 256 : (row->key >> 8),
+        other ? 0 : (row->key & 0xFF),
+        s,
+        (unsigned int) row->count,
+        (unsigned int) row->total_us[s],
+        (unsigned int) row->max_us[s]
+      );
+      for (uint8_t b = 0; b < BUS_PROFILER_BUCKETS; b++) {
+        output->concatf(",%u", row->hist[s][b]);
+      }
+      output->concat("\n");
+    }
+  }
+}
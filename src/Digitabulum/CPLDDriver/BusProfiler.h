@@ -0,0 +1,103 @@
+/*
+File:   BusProfiler.h
+Author: J. Ian Lindsay
+Date:   2017.10.22
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Always-on latency accounting for bus operations.
+
+Every op that makes it onto the bus is timestamped at five points...
+  1) Insertion into the work queue.
+  2) The call to begin().
+  3) The end of the transfer (under the ISR).
+  4) The start of its callback.
+  5) The end of its callback.
+...and the four intervals between them are binned into histograms. Rows are
+  keyed by the op's first transfer parameter (the whole CPLD address, RW bit
+  and all) and its opcode, so the preformed sensor reads each get their own
+  row, apart from writes to the same register.
+
+Buckets are powers of two in microseconds. Bucket 0 holds zero, and bucket n
+  holds [2^(n-1), 2^n). The last bucket holds everything larger. Recording is a
+  table scan over a few rows and a count-leading-zeros, so it is cheap enough
+  to leave running in production.
+*/
+
+#ifndef __DIGITABULUM_BUS_PROFILER_H__
+#define __DIGITABULUM_BUS_PROFILER_H__
+
+#include <inttypes.h>
+#include <DataStructures/StringBuilder.h>
+
+#define BUS_PROFILER_STAGES    4
+#define BUS_PROFILER_BUCKETS  16
+#ifndef BUS_PROFILER_ROWS
+  // How many (address, opcode) pairs get their own row? The last row catches
+  //   everything that arrives after the others are taken.
+  #define BUS_PROFILER_ROWS   16
+#endif
+
+/* The intervals that are measured. */
+enum class BusStage : uint8_t {
+  QUEUE    = 0,   // Queue insertion to begin().
+  XFER     = 1,   // begin() to the end of the transfer.
+  DISPATCH = 2,   // End of the transfer to the start of the callback.
+  CALLBACK = 3    // The callback itself.
+};
+
+
+class BusProfiler {
+  public:
+    BusProfiler();
+
+    void record(uint8_t addr, uint8_t opcode, uint32_t t_queued, uint32_t t_began, uint32_t t_done, uint32_t t_cb_start, uint32_t t_cb_end);
+    void reset();
+
+    void printDebug(StringBuilder*);
+    void serialize(StringBuilder*);
+
+    inline uint32_t recorded() {   return _recorded;   };
+
+    static const char* stageString(BusStage);
+
+
+  private:
+    typedef struct {
+      uint16_t key;                                // (addr << 8) | opcode
+      uint32_t count;
+      uint32_t total_us[BUS_PROFILER_STAGES];
+      uint32_t max_us[BUS_PROFILER_STAGES];
+      uint16_t hist[BUS_PROFILER_STAGES][BUS_PROFILER_BUCKETS];  // Saturating.
+    } ProfileRow;
+
+    ProfileRow _rows[BUS_PROFILER_ROWS];
+    uint32_t   _recorded = 0;
+
+    ProfileRow* _row_for(uint16_t key);
+
+    /**
+    * @param  us  An interval, in microseconds.
+    * @return The histogram bucket it belongs to.
+    */
+    static inline uint8_t _bucket(uint32_t us) {
+      if (0 == us) return 0;
+      const uint8_t b = (uint8_t) (32 - __builtin_clz(us));
+      return (b < BUS_PROFILER_BUCKETS) ? b : (BUS_PROFILER_BUCKETS - 1);
+    };
+};
+
+#endif  // __DIGITABULUM_BUS_PROFILER_H__
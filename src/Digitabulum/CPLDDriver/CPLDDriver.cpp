@@ -41,28 +41,52 @@ volatile CPLDDriver* cpld = nullptr;
 volatile bool timeout_punch = false;
 
 /*
-* For the sake of speed, we handle IRQ data issues in a single memory field,
+* For the sake of speed, we handle IRQ data issues in a few static fields,
 *   none of which is concurrency-safe.
-* IRQs are double-buffered in the first 20 bytes, over which DMA runs continuously.
+* IRQs are double-buffered in _irq_data[0-19], over which DMA runs continuously.
 *   Upon DMA half-complete, _irq_data_ptr is set to the most-recent (stable) half
-*   of the buffer, and any differences between them are computed and stored in...
-* _irq_data[20-29] are diff. Diffs get clobbered each DMA half-cycle, so to
-*   avoid losing track of IRQs, we then write them into...
-* _irq_data[30-39] an action accumulator. The ISR writes...
-*    action |= diff
+*   of the buffer, which is loaded into _irq_cur as a pair of words. Any
+*   differences from the prior half are computed and stored in...
+* _irq_diff. Diffs get clobbered each DMA half-cycle, so to avoid losing track
+*   of IRQs, each changed bit is then pushed into...
+* _irq_ring, as a timestamped IRQEvent. The ring preserves every edge, in order,
+*   with the time its frame arrived. If the ring is full, the bit is set in
+*   _irq_lost instead, and will be serviced without its timing. _irq_lost is
+*   only ever set by the ISR and taken by the thread with atomic word ops, so
+*   no edge is lost between the two.
 *
-* The ISR then fires the _irq_data_arrival message, with _irq_data[30-39]
-*   attached as a reference. When it comes time to thread, this will be revised.
+* The ISR fires the _irq_data_arrival message when it puts events into the ring
+*   and the message isn't already out. _irq_event_pending says whether it is,
+*   and only whoever sets it raises the message. iiu_group_irq() drains the ring
+*   in batches, and the message recycles until the ring is empty. Then the
+*   flag is cleared, and the ring checked once more for edges that arrived
+*   meanwhile.
+*
+* The CPLD sends the 80-bit frame MSB-first, so stream bit 0 is the MSB of
+*   w0, and stream bit 64 is the MSB of w1.
 */
-volatile static uint8_t  _irq_data[40] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                          0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                          0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+typedef struct {
+  uint64_t w0;   // Stream bits 0-63.
+  uint16_t w1;   // Stream bits 64-79.
+} IRQFrame;
+
+volatile static uint8_t  _irq_data[20] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
                                           0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 volatile static uint8_t* _irq_data_0   = &(_irq_data[0]);   // Convenience
 volatile static uint8_t* _irq_data_1   = &(_irq_data[10]);  // Convenience
-volatile static uint8_t* _irq_diff     = &(_irq_data[20]);  // Convenience
-volatile static uint8_t* _irq_accum    = &(_irq_data[30]);  // Convenience
 volatile static uint8_t* _irq_data_ptr = _irq_data_0;  // Used for block-wise access.
+volatile static IRQFrame _irq_cur      = {0, 0};  // The stable half, as words.
+volatile static IRQFrame _irq_diff     = {0, 0};  // Bits that changed on the last frame.
+volatile static uint32_t _irq_lost[3]  = {0, 0, 0};  // Edges that didn't fit in the ring. Bit n is stream bit n.
+
+/* One edge on one IRQ line. */
+typedef struct {
+  uint32_t t_us;    // micros() at arrival of the frame that carried it.
+  uint8_t  bit;     // Stream bit index (0-79).
+  uint8_t  level;   // The level after the edge.
+} IRQEvent;
+
+static SPSCRing<IRQEvent, CPLD_IRQ_RING_DEPTH> _irq_ring;  // ISR -> iiu_group_irq()
 volatile static uint32_t _irq_frames_rxd   = 0;  // How many IRQ frames have arrived.
 volatile static uint32_t _irq_latency_0    = 0;  // IRQ latency discovery.
 volatile static uint32_t _irq_latency_1    = 0;  // IRQ latency discovery.
@@ -71,6 +95,76 @@ volatile static uint32_t _irq_latency_2    = 0;  // IRQ latency discovery.
 
 /* This message is dispatched when IRQ data changes. */
 static ManuvrMsg _irq_data_arrival;
+volatile static uint8_t _irq_event_pending = 0;  // Is _irq_data_arrival raised, or being serviced?
+
+
+/**
+* Takes responsibility for raising _irq_data_arrival, if nobody has it.
+*
+* @return true if the caller must raise (or recycle) the message.
+*/
+static inline bool irq_event_claim() {
+  return (0 == __atomic_exchange_n(&_irq_event_pending, 1, __ATOMIC_SEQ_CST));
+}
+
+
+/**
+* Loads a 10-byte IRQ frame from the wire into a pair of words.
+*
+* @param  buf  The frame, as the CPLD sent it.
+* @return The frame as words.
+*/
+static inline IRQFrame irq_frame_load(const volatile uint8_t* buf) {
+  IRQFrame ret;
+  const uint8_t* b = (const uint8_t*) buf;
+  memcpy(&ret.w0, b, 8);
+  #if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    ret.w0 = __builtin_bswap64(ret.w0);
+  #endif
+  ret.w1 = ((uint16_t) b[8] << 8) | b[9];
+  return ret;
+}
+
+/**
+* Queues one edge. If the ring is full, the edge is remembered in _irq_lost.
+*/
+static inline void irq_event_push(uint32_t t_us, uint8_t bit, uint8_t level) {
+  if (0 != _irq_ring.insert({t_us, bit, level})) {
+    __atomic_fetch_or(&_irq_lost[bit >> 5], (1UL << (bit & 0x1F)), __ATOMIC_RELEASE);
+  }
+}
+
+/**
+* Called by the target's ISR after the stable half of the IRQ buffer has
+*   changed. Diffs the new frame against the prior one, a word at a time, and
+*   queues an event for each bit that changed.
+*
+* @param  prior_buf  The half of the buffer that was previously stable.
+* @return true if the caller should raise _irq_data_arrival.
+*/
+static inline bool irq_frame_ingest(const volatile uint8_t* prior_buf) {
+  const uint32_t now   = micros();
+  const IRQFrame prior = irq_frame_load(prior_buf);
+  const IRQFrame cur   = irq_frame_load(_irq_data_ptr);
+  uint64_t d0 = prior.w0 ^ cur.w0;
+  uint16_t d1 = prior.w1 ^ cur.w1;
+  _irq_cur.w0  = cur.w0;
+  _irq_cur.w1  = cur.w1;
+  _irq_diff.w0 = d0;
+  _irq_diff.w1 = d1;
+  if (0 == (d0 | d1)) return false;
+  while (d0) {
+    const uint8_t b = (uint8_t) __builtin_ctzll(d0);
+    d0 &= (d0 - 1);
+    irq_event_push(now, 63 - b, (uint8_t) ((cur.w0 >> b) & 1));
+  }
+  while (d1) {
+    const uint8_t b = (uint8_t) __builtin_ctz(d1);
+    d1 &= (d1 - 1);
+    irq_event_push(now, 79 - b, (uint8_t) ((cur.w1 >> b) & 1));
+  }
+  return irq_event_claim();
+}
 
 
 /**
@@ -88,6 +182,161 @@ void cpld_wakeup_isr(){
 }
 
 
+/* Set under the ISR when the bus finishes moving an op's data. For profiling. */
+volatile static uint32_t _bus_xfer_done_us = 0;
+
+/*
+* Transaction chains known to the driver. Populated from the kernel by
+*   registerChain(), and only read under the ISR.
+*/
+static SPIBusChain* _bus_chains[CPLD_SPI_MAX_CHAINS];
+
+/**
+* @param  op  The bus operation that might be the head of a chain.
+* @return The chain that op runs, or nullptr if it isn't chained.
+*/
+static SPIBusChain* _chain_for(SPIBusOp* op) {
+  for (uint8_t i = 0; i < CPLD_SPI_MAX_CHAINS; i++) {
+    if ((nullptr != _bus_chains[i]) && (op == _bus_chains[i]->op())) {
+      return _bus_chains[i];
+    }
+  }
+  return nullptr;
+}
+
+/**
+* Called by the target when an op has finished moving its data, before it is
+*   marked complete. If the op is a chain with segments left to run, the next
+*   one is loaded and started in place.
+* If the restart fails, begin() will have aborted the op, which completes it.
+*
+* @param  op  The bus operation that just finished a transfer.
+* @return true if the op was restarted (or aborted), and must not be completed.
+*/
+static bool _chain_continue(SPIBusOp* op) {
+  SPIBusChain* chain = _chain_for(op);
+  if ((nullptr != chain) && chain->advance()) {
+    if (XferFault::NONE != op->begin()) {
+      chain->rewind();
+    }
+    return true;
+  }
+  _bus_xfer_done_us = (uint32_t) micros();
+  return false;
+}
+
+/**
+* If the op is a chain that was stopped part-way (by fault, timeout, or purge),
+*   put it back on its first segment.
+*
+* @param  op  The bus operation that is leaving the bus.
+*/
+static void _chain_rewind(SPIBusOp* op) {
+  SPIBusChain* chain = _chain_for(op);
+  if (nullptr != chain) chain->rewind();
+}
+
+
+/**
+* Add a segment to the end of the chain. The op's opcode applies to all segments.
+*
+* @param  dev_addr   CPLD address of the first device.
+* @param  xfer_len   Bytes per device.
+* @param  dev_count  How many devices.
+* @param  reg_addr   Register address (with the RW and increment bits).
+* @param  buf        Where the data goes. nullptr to follow the previous segment.
+* @param  len        Length of the segment's data.
+* @param  gap        Bytes to leave between the previous segment's data and this
+*                      one's. Only meaningful if buf is nullptr.
+* @return 0 on success, -1 if the chain is full, -2 if the op is mid-chain.
+*/
+int8_t SPIBusChain::addSegment(uint8_t dev_addr, uint8_t xfer_len, uint8_t dev_count, uint8_t reg_addr, uint8_t* buf, uint16_t len, uint16_t gap) {
+  if (_seg_count >= CPLD_SPI_CHAIN_SEGMENTS) return -1;
+  if (0 != _cursor) return -2;
+  ChainSegment* seg = &_segs[_seg_count];
+  seg->params[0] = dev_addr;
+  seg->params[1] = xfer_len;
+  seg->params[2] = dev_count;
+  seg->params[3] = reg_addr;
+  seg->buf = buf;
+  seg->len = len;
+  seg->gap = gap;
+  _seg_count++;
+  return 0;
+}
+
+/**
+* Called by the bus when the op has finished a segment. ISR context.
+*
+* @return true if the next segment was loaded into the op. false if the chain
+*   ran to its end, in which case the op is back on its first segment.
+*/
+bool SPIBusChain::advance() {
+  if (0 == _cursor) {
+    // Starting the chain. Remember the op's own segment, which the owner might
+    //   have changed since the last run (EG, to flip buffers).
+    for (uint8_t i = 0; i < 4; i++) _first.params[i] = _op->getTransferParam(i);
+    _first.buf = _op->buf;
+    _first.len = _op->buf_len;
+  }
+  if (_cursor < _seg_count) {
+    ChainSegment* seg = &_segs[_cursor];
+    if (nullptr == seg->buf) {
+      // Gather into the space following whatever the op just filled.
+      uint8_t* nxt = _op->buf + _op->buf_len + seg->gap;
+      _load(seg);
+      _op->buf = nxt;
+    }
+    else {
+      _load(seg);
+    }
+    _cursor++;
+    return true;
+  }
+  rewind();
+  _runs++;
+  return false;
+}
+
+/**
+* Put the op back onto its first segment. Safe to call on a chain that is
+*   already there.
+*/
+void SPIBusChain::rewind() {
+  if (0 != _cursor) {
+    _load(&_first);
+    _cursor = 0;
+  }
+}
+
+/**
+* Write a segment into the op.
+*/
+void SPIBusChain::_load(ChainSegment* seg) {
+  _op->setParams(seg->params[0], seg->params[1], seg->params[2], seg->params[3]);
+  _op->buf     = seg->buf;
+  _op->buf_len = seg->len;
+}
+
+/**
+* Debug support method.
+*
+* @param  output  The buffer to receive the output.
+*/
+void SPIBusChain::printDebug(StringBuilder* output) {
+  output->concatf("\tChain on op %p: %u segments, %u runs%s\n",
+    (void*) _op, segmentCount(), (unsigned int) _runs,
+    (0 != _cursor) ? " (running)" : ""
+  );
+  for (uint8_t i = 0; i < _seg_count; i++) {
+    output->concatf("\t  %u: 0x%02x 0x%02x 0x%02x 0x%02x  (%u bytes, +%u)\n",
+      i + 1, _segs[i].params[0], _segs[i].params[1], _segs[i].params[2],
+      _segs[i].params[3], _segs[i].len, _segs[i].gap
+    );
+  }
+}
+
+
 // NOTE: Textual inclusion of source files is super ugly, but we're sticking
 //   with it because the platform-specific functions will demand access to
 //   static/unscoped variables defined above. Exposing these in a header file
@@ -119,6 +368,11 @@ uint8_t  CPLDDriver::forsaken_digits    = 0;  // Forsaken digits.
 uint8_t  CPLDDriver::cpld_wakeup_source = 0;  // WAKEUP mapping.
 uint8_t  CPLDDriver::irq76_conf         = 0;  // Aggregated IRQ settings.
 
+/* The register behind each shadow (CPLD_SHADOW_*). */
+static const uint8_t _shadow_addr[CPLD_SHADOW_COUNT] = {
+  CPLD_REG_CONFIG, CPLD_REG_DIGIT_FORSAKE, CPLD_REG_WAKEUP_IRQ
+};
+
 
 
 SPIBusOp  CPLDDriver::preallocated_bus_jobs[CPLD_SPI_PREALLOC_COUNT];
@@ -175,6 +429,7 @@ static const MessageTypeDef cpld_message_defs[] = {
   {  DIGITABULUM_MSG_CPLD_DIGIT_DROP      , 0x0000,               "DIGIT_DROP"     , ManuvrMsg::MSG_ARGS_NONE }, //
   {  DIGITABULUM_MSG_CPLD_RESET_COMPLETE  , 0x0000,               "CPLD_RST_CMPLTE", ManuvrMsg::MSG_ARGS_NONE }, //
   {  DIGITABULUM_MSG_CPLD_RESET_CALLBACK  , 0x0000,               "CPLD_RST_CB"    , ManuvrMsg::MSG_ARGS_NONE }, //
+  {  DIGITABULUM_MSG_CPLD_SHADOW_FLUSH    , 0x0000,               "CPLD_SHDW_FLUSH", ManuvrMsg::MSG_ARGS_NONE }, //
   {  DIGITABULUM_MSG_SPI_QUEUE_READY      , 0x0000,               "SPI_Q_RDY"      , ManuvrMsg::MSG_ARGS_NONE }, //
   {  DIGITABULUM_MSG_SPI_CB_QUEUE_READY   , 0x0000,               "SPICB_RDY"      , ManuvrMsg::MSG_ARGS_NONE }, //
   {  DIGITABULUM_MSG_SPI_TIMEOUT          , 0x0000,               "SPI_TO"         , ManuvrMsg::MSG_ARGS_NONE }, //
@@ -208,95 +463,98 @@ const char* CPLDDriver::getDigitPortString(DigitPort x) {
 }
 
 
-// NO ERROR CHECKING! Don't call this with an argument >79.
-bool irq_is_presently_high(const uint8_t bit) {
-  const uint8_t bit_offset  = bit & 0x07;  // Cheaper than modulus 8.
-  const uint8_t byte_offset = bit >> 3;    // Cheaper than div by 8.
-  return ((_irq_data_ptr[byte_offset] & (0x80 >> bit_offset)) != 0);
+/**
+* @param  f    The frame.
+* @param  bit  The stream bit. NO ERROR CHECKING! Don't call this with an argument >79.
+* @return True if the bit is set.
+*/
+static inline bool irq_frame_bit(const volatile IRQFrame* f, const uint8_t bit) {
+  return (bit < 64) ? ((f->w0 >> (63 - bit)) & 1) : ((f->w1 >> (79 - bit)) & 1);
 }
 
-// NO ERROR CHECKING! Don't call this with an argument >79.
-bool irq_demands_service(const uint8_t bit) {
-  const uint8_t bit_offset  = bit & 0x07;  // Cheaper than modulus 8.
-  const uint8_t byte_offset = bit >> 3;    // Cheaper than div by 8.
-  return ((_irq_accum[byte_offset] & (0x80 >> bit_offset)) != 0);
+bool irq_is_presently_high(const uint8_t bit) {
+  return irq_frame_bit(&_irq_cur, bit);
 }
 
-/**
-* Returns at most 12-bits of IRQ service data for the given digit.
-*
-* @return True if the IRQ data confirms a digit.
+
+/*
+* Where each digit's slice of IMU signals lives in the frame. The MC slice is
+*   8 bits wide (two IMUs), and the others are 12 bits (three IMUs). PORT_5
+*   straddles the word boundary, so it takes its last nibble from w1.
+* Extraction is ((w0 << lsh) >> rsh) | ((w1 >> w1_rsh) & w1_mask). The UNKNOWN
+*   port and the padding entry have zeroed masks.
 */
-uint16_t irq_digit_slice_service(DigitPort x) {
-  uint16_t ret = 0;
-  // TODO: There is a way to do this without branching.
-  switch (x) {
-    case DigitPort::MC:
-      ret = _irq_accum[0];
-      break;
-    case DigitPort::PORT_1:
-      ret = (uint16_t) (_irq_accum[1] & 0xFF) << 4;
-      ret += (_irq_accum[2] >> 4);
-      break;
-    case DigitPort::PORT_2:
-      ret = (uint16_t) (_irq_accum[2] & 0x0F) << 8;
-      ret += _irq_accum[3];
-      break;
-    case DigitPort::PORT_3:
-      ret = (uint16_t) (_irq_accum[4] & 0xFF) << 4;
-      ret += (_irq_accum[5] >> 4);
-      break;
-    case DigitPort::PORT_4:
-      ret = (uint16_t) (_irq_accum[5] & 0x0F) << 8;
-      ret += _irq_accum[6];
-      break;
-    case DigitPort::PORT_5:
-      ret = (uint16_t) (_irq_accum[7] & 0xFF) << 4;
-      ret += (_irq_accum[8] >> 4);
-      break;
-    default:
-      break;
-  }
-  return ret;
+typedef struct {
+  uint8_t  lsh;
+  uint8_t  rsh;
+  uint8_t  w1_rsh;
+  uint16_t w1_mask;
+  uint64_t w0_mask;   // Applied after the shifts.
+} IRQSliceDef;
+
+static constexpr IRQSliceDef _irq_slices[8] = {
+  {  0, 56,  0, 0x0000, 0xFF  },  // MC      Bits 0-7
+  {  8, 52,  0, 0x0000, 0xFFF },  // PORT_1  Bits 8-19
+  { 20, 52,  0, 0x0000, 0xFFF },  // PORT_2  Bits 20-31
+  { 32, 52,  0, 0x0000, 0xFFF },  // PORT_3  Bits 32-43
+  { 44, 52,  0, 0x0000, 0xFFF },  // PORT_4  Bits 44-55
+  { 56, 52, 12, 0x000F, 0xFF0 },  // PORT_5  Bits 56-67
+  {  0,  0,  0, 0x0000, 0x000 },  // UNKNOWN
+  {  0,  0,  0, 0x0000, 0x000 }
 };
 
+/**
+* @param  f  The frame.
+* @param  x  The digit.
+* @return At most 12-bits of IRQ data for the given digit.
+*/
+static inline uint16_t irq_frame_slice(const volatile IRQFrame* f, DigitPort x) {
+  const IRQSliceDef* d = &_irq_slices[((uint8_t) x) & 0x07];
+  return (uint16_t) ((((f->w0 << d->lsh) >> d->rsh) & d->w0_mask) | ((f->w1 >> d->w1_rsh) & d->w1_mask));
+}
 
 /**
 * Returns at most 12-bits of IRQ data for the given digit.
 *
-* @return True if the IRQ data confirms a digit.
+* @return The present state of the digit's IRQ lines.
 */
 uint16_t irq_digit_slice_current(DigitPort x) {
-  uint16_t ret = 0;
-  // TODO: There is a way to do this without branching.
-  switch (x) {
-    case DigitPort::MC:
-      ret = _irq_data_ptr[0];
-      break;
-    case DigitPort::PORT_1:
-      ret = (uint16_t) (_irq_data_ptr[1] & 0xFF) << 4;
-      ret += (_irq_data_ptr[2] >> 4);
-      break;
-    case DigitPort::PORT_2:
-      ret = (uint16_t) (_irq_data_ptr[2] & 0x0F) << 8;
-      ret += _irq_data_ptr[3];
-      break;
-    case DigitPort::PORT_3:
-      ret = (uint16_t) (_irq_data_ptr[4] & 0xFF) << 4;
-      ret += (_irq_data_ptr[5] >> 4);
-      break;
-    case DigitPort::PORT_4:
-      ret = (uint16_t) (_irq_data_ptr[5] & 0x0F) << 8;
-      ret += _irq_data_ptr[6];
-      break;
-    case DigitPort::PORT_5:
-      ret = (uint16_t) (_irq_data_ptr[7] & 0xFF) << 4;
-      ret += (_irq_data_ptr[8] >> 4);
-      break;
-    default:
-      break;
-  }
-  return ret;
+  return irq_frame_slice(&_irq_cur, x);
+};
+
+
+/*
+* The IMU served by each nibble of w0 (counting up from its LSB), and the digit
+*   it belongs to. Stream nibble n sits at w0 bits (60 - 4n) to (63 - 4n).
+*   Within a digit's slice, the last nibble is the proximal IMU. Within the MC
+*   slice, the last nibble is the IMU on the main PCB. Nibble 16 (IMU 14, the
+*   PORT_5 proximal) is in w1, and is handled apart from the tables.
+*/
+static constexpr uint8_t _irq_nibble_imu[16] = {
+  15, 16, 11, 12, 13, 8, 9, 10, 5, 6, 7, 2, 3, 4, 0, 1
+};
+static constexpr uint8_t _irq_nibble_port[16] = {
+  5, 5, 4, 4, 4, 3, 3, 3, 2, 2, 2, 1, 1, 1, 0, 0
+};
+
+/*
+* Which w0 nibbles belong to each digit. The PCB IMU (IMU 0) isn't on a digit.
+*   These are only used by the decode benchmark now.
+*/
+#define IRQ_W0_PCB_IMU  0x0F00000000000000ULL
+static constexpr uint64_t _irq_w0_gate[6] = {
+  0xF000000000000000ULL,  // MC
+  0x00FFF00000000000ULL,  // PORT_1
+  0x00000FFF00000000ULL,  // PORT_2
+  0x00000000FFF00000ULL,  // PORT_3
+  0x00000000000FFF00ULL,  // PORT_4
+  0x00000000000000FFULL   // PORT_5 (distal and intermediate)
+};
+
+/* Names for IRQs 68 through 77, for logging. */
+static const char* const _irq_status_names[10] = {
+  "MC PRESENT", "Digit_1", "Digit_2", "Digit_3", "Digit_4", "Digit_5",
+  "IRQ74", "CPLD_OE", "IRQ76", "IRQ77"
 };
 
 
@@ -325,6 +583,11 @@ CPLDDriver::CPLDDriver(const CPLDPins* p) : EventReceiver("CPLDDriver"), BusAdap
   event_spi_callback_ready.specific_target = (EventReceiver*) this;
   event_spi_callback_ready.priority(5);
 
+  _shadow_flush.repurpose(DIGITABULUM_MSG_CPLD_SHADOW_FLUSH, (EventReceiver*) this);
+  _shadow_flush.incRefs();
+  _shadow_flush.specific_target = (EventReceiver*) this;
+  _shadow_sync();
+
   SPIBusOp::event_spi_queue_ready.repurpose(DIGITABULUM_MSG_SPI_QUEUE_READY, (EventReceiver*) this);
   SPIBusOp::event_spi_queue_ready.incRefs();
   SPIBusOp::event_spi_queue_ready.specific_target = (EventReceiver*) this;
@@ -336,6 +599,12 @@ CPLDDriver::CPLDDriver(const CPLDPins* p) : EventReceiver("CPLDDriver"), BusAdap
     preallocated.insert(&preallocated_bus_jobs[i]);
   }
 
+  for (uint8_t i = 0; i < CPLD_SPI_MAX_RT_OPS; i++) {
+    _rt_ops[i].op          = nullptr;
+    _rt_ops[i].deadline_us = 0;
+  }
+  _lane_reset_stats();
+
   current_job = nullptr;
   _er_set_flag(CPLD_FLAG_QUEUE_IDLE);
 }
@@ -396,9 +665,19 @@ void CPLDDriver::reset() {
   cpld_wakeup_source = 0x00;
   forsaken_digits    = 0x00;
   irq76_conf         = 0x00;
+  _shadow_sync();              // Anything not yet flushed is moot now.
   bus_timeout_millis = 5;   // TODO: Dynamically relate this to clock frequency.
 
-  for (int z = 0; z < 30; z++) _irq_data[z] = 0;   // Wipe the IRQ data.
+  for (int z = 0; z < 20; z++) _irq_data[z] = 0;   // Wipe the IRQ data.
+  _irq_cur.w0   = 0;
+  _irq_cur.w1   = 0;
+  _irq_diff.w0  = 0;
+  _irq_diff.w1  = 0;
+  for (uint8_t i = 0; i < 3; i++) _irq_lost[i] = 0;
+  _irq_seen.w0  = 0;
+  _irq_seen.w1  = 0;
+  IRQEvent discard;
+  while (_irq_ring.get(&discard)) {}  // Edges from before the reset are moot.
   _irq_data_ptr = _irq_data_0;  // Used for block-wise access.
 
   purge_queued_work();          // Purge the SPI queue...
@@ -472,6 +751,8 @@ int CPLDDriver::_process_cpld_base_return(uint8_t _version, uint8_t _conf) {
     }
 
     if (fresh_init) {
+      // The CPLD's registers are now known. Start the shadows from there.
+      _shadow_sync();
       // This is the appropriate place for config init.
       // TODO: This value will vary. Provide it in config.
       uint8_t desired_conf_value = (CPLD_CONF_BIT_ALIGN_XFER | CPLD_CONF_BIT_PWR_CONSRV);
@@ -536,9 +817,15 @@ int8_t CPLDDriver::io_op_callback(BusOp* _op) {
 
   // There is zero chance this object will be a null pointer unless it was done on purpose.
   if (op->hasFault()) {
+    if (BusOpcode::TX == op->get_opcode()) {
+      _shadow_done(op->getTransferParam(0), op->getTransferParam(1), false);
+    }
     if (getVerbosity() > 3) local_log.concat("io_op_callback() rejected a callback because the bus op failed.\n");
     return SPI_CALLBACK_ERROR;
   }
+  if (BusOpcode::TX == op->get_opcode()) {
+    _shadow_done(op->getTransferParam(0), op->getTransferParam(1), true);
+  }
 
   switch (op->getTransferParam(0)) {
     case CPLD_REG_VERSION:
@@ -603,27 +890,39 @@ int8_t CPLDDriver::queue_io_job(BusOp* _op) {
     op->csActiveHigh(true);   // We enfoce this here to prevent having to
     op->setCSPin(_pins.req);  //   enforce it in many places.
 
-    if ((nullptr == current_job) && (work_queue.size() == 0)){
+    BusLaneState* lane = &_lanes[(uint8_t) BusLane::BACKGROUND];
+    uint32_t deadline  = 0;
+    for (uint8_t i = 0; i < CPLD_SPI_MAX_RT_OPS; i++) {
+      if (op == _rt_ops[i].op) {
+        lane     = &_lanes[(uint8_t) BusLane::REALTIME];
+        deadline = _rt_ops[i].deadline_us;
+        break;
+      }
+    }
+
+    if ((nullptr == current_job) && _lanes_empty()) {
       // If the queue is empty, fire the operation now.
+      lane->served++;
+      _job_queued_us = (uint32_t) micros();
       current_job = op;
       advance_work_queue();
       if (bus_timeout_millis) event_spi_timeout.delaySchedule(bus_timeout_millis);  // Punch the timeout schedule.
     }
     else {    // If there is something already in progress, queue up.
-      if (_er_flag(CPLD_FLAG_QUEUE_GUARD) && (MAX_Q_DEPTH <= work_queue.size())) {
-        if (getVerbosity() > 3) Kernel::log("CPLDDriver::queue_io_job(): \t Bus queue at max size. Dropping transaction.\n");
-        op->abort(XferFault::QUEUE_FLUSH);
-        callback_queue.insertIfAbsent(op);
-        if (callback_queue.size() == 1) Kernel::staticRaiseEvent(&event_spi_callback_ready);
+      if (_er_flag(CPLD_FLAG_QUEUE_GUARD) && (MAX_Q_DEPTH <= lane->ring.count())) {
+        if (getVerbosity() > 3) Kernel::log("CPLDDriver::queue_io_job(): \t Bus lane at max size. Dropping transaction.\n");
+        lane->rejected++;
+        _callback_reject(op, XferFault::QUEUE_FLUSH);
         return -1;
       }
 
-      if (0 > work_queue.insertIfAbsent(op)) {
-        if (getVerbosity() > 2) {
-          local_log.concat("CPLDDriver::queue_io_job(): \t Double-insertion. Dropping transaction with no status change.\n");
-          op->printDebug(&local_log);
-          Kernel::log(&local_log);
-        }
+      // Marking the op QUEUED is what catches double-insertion, since it will
+      //   fail the IDLE check above on the second attempt.
+      op->set_state(XferState::QUEUED);
+      if (0 > lane->ring.insert({op, (uint32_t) micros(), deadline})) {
+        if (getVerbosity() > 2) Kernel::log("CPLDDriver::queue_io_job(): \t Lane ring is full. Dropping transaction.\n");
+        lane->rejected++;
+        _callback_reject(op, XferFault::QUEUE_FLUSH);
         return -3;
       }
     }
@@ -663,14 +962,20 @@ int8_t CPLDDriver::advance_work_queue() {
         }
         // No break on purpose.
       case XferState::COMPLETE:
-        _total_xfers++;
-        callback_queue.insert(current_job);
-        current_job = nullptr;
-        if (callback_queue.size() == 1) Kernel::staticRaiseEvent(&event_spi_callback_ready);
+      case XferState::FAULT:
+        if (_callback_enqueue(current_job, true)) {
+          _total_xfers++;
+          current_job = nullptr;
+        }
+        else {
+          // No room to hand the op off. Hold the bus until the callbacks drain.
+          Kernel::staticRaiseEvent(&SPIBusOp::event_spi_queue_ready);
+        }
         break;
 
       case XferState::IDLE:
       case XferState::INITIATE:
+        _job_began_us = (uint32_t) micros();
         switch (current_job->begin()) {
           case XferFault::NONE:     // Nominal outcome. Transfer started with no problens...
             break;
@@ -681,9 +986,9 @@ int8_t CPLDDriver::advance_work_queue() {
             break;
           default:    // Began the transfer, and it barffed... was aborted.
             if (getVerbosity() > 3) local_log.concat("CPLDDriver::advance_work_queue():\t Failed to begin transfer after starting.\n");
-            callback_queue.insert(current_job);
-            current_job = nullptr;
-            if (callback_queue.size() == 1) Kernel::staticRaiseEvent(&event_spi_callback_ready);
+            if (_callback_enqueue(current_job)) {
+              current_job = nullptr;
+            }
             break;
         }
         break;
@@ -706,9 +1011,9 @@ int8_t CPLDDriver::advance_work_queue() {
   }
 
   if (current_job == nullptr) {
-    current_job = work_queue.dequeue();
     // Begin the bus operation.
-    if (current_job) {
+    if (_lane_take(&current_job)) {
+      _job_began_us = (uint32_t) micros();
       if (XferFault::NONE != current_job->begin()) {
         if (getVerbosity() > 2) local_log.concatf("advance_work_queue() tried to clobber an existing transfer on the pick-up.\n");
         Kernel::staticRaiseEvent(&SPIBusOp::event_spi_queue_ready);  // Bypass our method. Jump right to the target.
@@ -727,7 +1032,7 @@ int8_t CPLDDriver::advance_work_queue() {
 
 
 /**
-* Purges only the jobs belonging to the given device from the work_queue.
+* Purges only the jobs belonging to the given device from the work ring.
 * Leaves the currently-executing job.
 *
 * @param  dev  The device pointer that owns jobs we wish purged.
@@ -736,17 +1041,18 @@ void CPLDDriver::purge_queued_work_by_dev(BusOpCallback *dev) {
   if (nullptr == dev) return;
   SPIBusOp* current = nullptr;
 
-  if (work_queue.size() > 0) {
-    int i = 0;
-    while (i < work_queue.size()) {
-      current = work_queue.get(i);
-      if (current->callback == dev) {
-        current->abort(XferFault::QUEUE_FLUSH);
-        work_queue.remove(current);
-        reclaim_queue_item(current);
+  // Rotate each ring once, putting back anything that survives. We are both
+  //   the producer and the consumer here, so order is preserved.
+  for (uint8_t l = 0; l < CPLD_SPI_LANE_COUNT; l++) {
+    LaneEntry entry;
+    unsigned int remaining = _lanes[l].ring.count();
+    while ((remaining-- > 0) && _lanes[l].ring.get(&entry)) {
+      if (entry.op->callback == dev) {
+        entry.op->abort(XferFault::QUEUE_FLUSH);
+        reclaim_queue_item(entry.op);
       }
       else {
-        i++;
+        _lanes[l].ring.insert(entry);
       }
     }
   }
@@ -757,14 +1063,15 @@ void CPLDDriver::purge_queued_work_by_dev(BusOpCallback *dev) {
 
 
 /**
-* Purges only the work_queue. Leaves the currently-executing job.
+* Purges the work rings of every lane. Then purges the currently-executing job.
 */
 void CPLDDriver::purge_queued_work() {
-  SPIBusOp* current = nullptr;
-  while (work_queue.hasNext()) {
-    current = work_queue.dequeue();
-    current->abort(XferFault::QUEUE_FLUSH);
-    reclaim_queue_item(current);
+  for (uint8_t l = 0; l < CPLD_SPI_LANE_COUNT; l++) {
+    LaneEntry entry;
+    while (_lanes[l].ring.get(&entry)) {
+      entry.op->abort(XferFault::QUEUE_FLUSH);
+      reclaim_queue_item(entry.op);
+    }
   }
 
   // Check this last to head off any silliness with bus operations colliding with us.
@@ -816,6 +1123,7 @@ SPIBusOp* CPLDDriver::new_op(BusOpcode _op, BusOpCallback* _req) {
 * @param item The SPIBusOp to be reclaimed.
 */
 void CPLDDriver::reclaim_queue_item(SPIBusOp* op) {
+  _chain_rewind(op);
   if (op->hasFault() && (getVerbosity() > 1)) {    // Print failures.
     StringBuilder log;
     op->printDebug(&log);
@@ -851,12 +1159,24 @@ void CPLDDriver::reclaim_queue_item(SPIBusOp* op) {
 */
 int8_t CPLDDriver::service_callback_queue() {
   int8_t return_value = 0;
-  SPIBusOp* temp_op = callback_queue.dequeue();
+  CallbackEntry entry;
 
-  while ((nullptr != temp_op) && (return_value < spi_cb_per_event)) {
+  while ((return_value < spi_cb_per_event) && _callback_ring.get(&entry)) {
+    SPIBusOp* temp_op = entry.op;
     if (getVerbosity() > 6) temp_op->printDebug(&local_log);
+    const uint32_t t_cb_start = (uint32_t) micros();
+    if (entry.profiled) {
+      _clk_account(entry.t_done - entry.t_began, temp_op->buf_len, t_cb_start);
+    }
+    _cb_xfer_done_us = entry.profiled ? entry.t_done : t_cb_start;
     if (nullptr != temp_op->callback) {
       int8_t cb_code = temp_op->callback->io_op_callback(temp_op);
+      if (entry.profiled) {
+        _profiler.record(
+          temp_op->getTransferParam(0), (uint8_t) temp_op->get_opcode(),
+          entry.t_queued, entry.t_began, entry.t_done, t_cb_start, (uint32_t) micros()
+        );
+      }
       switch (cb_code) {
         case SPI_CALLBACK_RECYCLE:
           temp_op->set_state(XferState::IDLE);
@@ -876,10 +1196,15 @@ int8_t CPLDDriver::service_callback_queue() {
     }
     else {
       // We are the responsible party.
+      if (entry.profiled) {
+        _profiler.record(
+          temp_op->getTransferParam(0), (uint8_t) temp_op->get_opcode(),
+          entry.t_queued, entry.t_began, entry.t_done, t_cb_start, t_cb_start
+        );
+      }
       reclaim_queue_item(temp_op);
     }
     return_value++;
-    temp_op = callback_queue.dequeue();
   }
 
   flushLocalLog();
@@ -887,6 +1212,207 @@ int8_t CPLDDriver::service_callback_queue() {
 }
 
 
+/**
+* Hands a finished (or failed) bus operation off to be called back. Raises the
+*   callback event if the ring had been empty.
+*
+* @param  op        The bus operation to be called back.
+* @param  profiled  true if op is current_job, and its timestamps should be kept.
+* @return true if the op was accepted. false if the callback ring was full.
+*/
+bool CPLDDriver::_callback_enqueue(SPIBusOp* op, bool profiled) {
+  CallbackEntry entry = { op, _job_queued_us, _job_began_us, _bus_xfer_done_us, profiled };
+  if (profiled) {
+    // If the transfer didn't finish under the ISR (EG, it was aborted), the
+    //   done-stamp is from an earlier op. Use the present.
+    const uint32_t now = (uint32_t) micros();
+    if ((entry.t_done - entry.t_began) > (now - entry.t_began)) entry.t_done = now;
+  }
+  _chain_rewind(op);
+  if (0 == _callback_ring.insert(entry)) {
+    if (1 == _callback_ring.count()) Kernel::staticRaiseEvent(&event_spi_callback_ready);
+    return true;
+  }
+  return false;
+}
+
+
+/**
+* Aborts an op that never made it onto the bus, and calls it back. If the
+*   callback ring is full, the owner is called back right here instead. The op
+*   is then reclaimed whatever the owner answers, since queueing it again now
+*   would only be refused again.
+*
+* @param  op     The bus operation that was refused.
+* @param  fault  Why.
+*/
+void CPLDDriver::_callback_reject(SPIBusOp* op, XferFault fault) {
+  op->abort(fault);
+  if (_callback_enqueue(op)) return;
+  if (getVerbosity() > 2) local_log.concat("CPLDDriver: Callback ring is full. Calling back a refused op in place.\n");
+  if (nullptr != op->callback) {
+    op->callback->io_op_callback(op);
+  }
+  reclaim_queue_item(op);
+}
+
+
+/**
+* Takes the next op to be run. The real-time lane is served first, except that
+*   background work gets a turn after CPLD_SPI_RT_BURST_MAX real-time ops in a
+*   row, so that configuration can't be starved out by a steady read stream.
+* Real-time ops whose deadline has passed are skipped. They are aborted with
+*   TIMEOUT and called back, so their owners can decide what to do.
+*
+* @param  op  Receives the op to run.
+* @return true if there was an op to run.
+*/
+bool CPLDDriver::_lane_take(SPIBusOp** op) {
+  BusLaneState* rt = &_lanes[(uint8_t) BusLane::REALTIME];
+  BusLaneState* bg = &_lanes[(uint8_t) BusLane::BACKGROUND];
+  LaneEntry entry;
+  const uint32_t now = (uint32_t) micros();
+
+  if ((_rt_burst < CPLD_SPI_RT_BURST_MAX) || bg->ring.isEmpty()) {
+    while (rt->ring.get(&entry)) {
+      const uint32_t waited = now - entry.queued_at;
+      // An op that has no room to be called back is run late, rather than lost.
+      const bool cb_full = (_callback_ring.count() >= _callback_ring.capacity());
+      if ((0 == entry.deadline_us) || (waited <= entry.deadline_us) || cb_full) {
+        rt->served++;
+        _job_queued_us = entry.queued_at;
+        rt->wait_total_us += waited;
+        if (waited > rt->wait_max_us) rt->wait_max_us = waited;
+        _rt_burst++;
+        *op = entry.op;
+        return true;
+      }
+      // The data this op would fetch is already stale.
+      rt->expired++;
+      entry.op->abort(XferFault::TIMEOUT);
+      _callback_enqueue(entry.op);   // There was room, as checked above.
+    }
+  }
+
+  _rt_burst = 0;
+  if (bg->ring.get(&entry)) {
+    const uint32_t waited = now - entry.queued_at;
+    bg->served++;
+    _job_queued_us = entry.queued_at;
+    bg->wait_total_us += waited;
+    if (waited > bg->wait_max_us) bg->wait_max_us = waited;
+    *op = entry.op;
+    return true;
+  }
+  return false;
+}
+
+/**
+* Clears the lane statistics. Doesn't touch the queued work.
+*/
+void CPLDDriver::_lane_reset_stats() {
+  for (uint8_t l = 0; l < CPLD_SPI_LANE_COUNT; l++) {
+    _lanes[l].served        = 0;
+    _lanes[l].expired       = 0;
+    _lanes[l].rejected      = 0;
+    _lanes[l].wait_total_us = 0;
+    _lanes[l].wait_max_us   = 0;
+    _lanes[l].ring.resetStats();
+  }
+}
+
+/**
+* Puts an op into the real-time lane. Calling this again for the same op
+*   updates its deadline.
+*
+* @param  op           The bus operation.
+* @param  deadline_us  How long the op may wait before it is skipped. 0 for never.
+* @return 0 on success, -1 if there is no room.
+*/
+int8_t CPLDDriver::setRealtime(SPIBusOp* op, uint32_t deadline_us) {
+  int8_t slot = -1;
+  for (uint8_t i = 0; i < CPLD_SPI_MAX_RT_OPS; i++) {
+    if (op == _rt_ops[i].op) {
+      _rt_ops[i].deadline_us = deadline_us;
+      return 0;
+    }
+    if ((slot < 0) && (nullptr == _rt_ops[i].op)) slot = i;
+  }
+  if (slot >= 0) {
+    _rt_ops[slot].deadline_us = deadline_us;
+    _rt_ops[slot].op          = op;
+    return 0;
+  }
+  return -1;
+}
+
+/**
+* Returns an op to the background lane. Takes effect the next time it is queued.
+*
+* @param  op  The bus operation.
+* @return 0 on success, -1 if the op was not real-time.
+*/
+int8_t CPLDDriver::clearRealtime(SPIBusOp* op) {
+  for (uint8_t i = 0; i < CPLD_SPI_MAX_RT_OPS; i++) {
+    if (op == _rt_ops[i].op) {
+      _rt_ops[i].op = nullptr;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/**
+* @param  op  The bus operation.
+* @return The lane the op will be queued into.
+*/
+BusLane CPLDDriver::laneFor(SPIBusOp* op) {
+  for (uint8_t i = 0; i < CPLD_SPI_MAX_RT_OPS; i++) {
+    if (op == _rt_ops[i].op) return BusLane::REALTIME;
+  }
+  return BusLane::BACKGROUND;
+}
+
+
+/**
+* Registers a transaction chain, so that the bus will run all of its segments
+*   whenever its op is queued.
+*
+* @param  chain  The chain to register.
+* @return 0 on success, 1 if already registered, -1 if there is no room.
+*/
+int8_t CPLDDriver::registerChain(SPIBusChain* chain) {
+  int8_t slot = -1;
+  for (uint8_t i = 0; i < CPLD_SPI_MAX_CHAINS; i++) {
+    if (chain == _bus_chains[i]) return 1;
+    if ((slot < 0) && (nullptr == _bus_chains[i])) slot = i;
+  }
+  if (slot >= 0) {
+    _bus_chains[slot] = chain;
+    return 0;
+  }
+  return -1;
+}
+
+/**
+* Unregisters a transaction chain. Its op will be run as a single transfer.
+*
+* @param  chain  The chain to unregister.
+* @return 0 on success, -1 if not registered, -2 if the chain is on the bus.
+*/
+int8_t CPLDDriver::unregisterChain(SPIBusChain* chain) {
+  if (chain->op() == current_job) return -2;
+  for (uint8_t i = 0; i < CPLD_SPI_MAX_CHAINS; i++) {
+    if (chain == _bus_chains[i]) {
+      _bus_chains[i] = nullptr;
+      chain->rewind();
+      return 0;
+    }
+  }
+  return -1;
+}
+
+
 
 /*******************************************************************************
 * CPLD register manipulation and integral hardware functions.                  *
@@ -938,18 +1464,117 @@ void CPLDDriver::internalOscillator(bool on) {
 }
 
 /**
-* Calling this function will set the CPLD config register.
+* Declares the steady bus load that the clock needs to carry. Replaces any
+*   prior declaration, and retunes the clock if the governor is enabled.
+*   Repeating the current declaration does nothing.
 *
-* @param  mask   Combination of flags to change.
-* @param  state  Should the flags be cleared or set?
+* @param  ops_per_sec    Bus operations per second.
+* @param  bytes_per_sec  Buffer bytes per second, across all of those ops.
 */
-void CPLDDriver::setCPLDConfig(uint8_t mask, bool state) {
-  if (state) {
-    writeRegister(CPLD_REG_CONFIG, (cpld_conf_value | mask));
+void CPLDDriver::setBusDemand(uint32_t ops_per_sec, uint32_t bytes_per_sec) {
+  if ((ops_per_sec == _gov_demand_ops) && (bytes_per_sec == _gov_demand_bytes)) return;
+  _gov_demand_ops   = ops_per_sec;
+  _gov_demand_bytes = bytes_per_sec;
+  _clk_retune();
+}
+
+/**
+* Works out the external clock needed for the declared demand. Each op is
+*   charged CPLD_CLK_GOV_OP_OVERHEAD byte-times for its parameters and the
+*   request handshake, and the headroom is added on top. The CPLD divides its
+*   clock once to get the SPI clock.
+*
+* @return The external clock frequency in Hz, or 0 if there is no demand.
+*/
+uint32_t CPLDDriver::clkRequired() {
+  if (0 == (_gov_demand_ops | _gov_demand_bytes)) return 0;
+  uint64_t bits = ((uint64_t) _gov_demand_bytes + ((uint64_t) _gov_demand_ops * CPLD_CLK_GOV_OP_OVERHEAD)) * 8;
+  uint64_t hz   = ((bits * (100 + _gov_headroom)) / 100) * 2;
+  if (hz < CPLD_EXT_CLK_MIN_HZ) hz = CPLD_EXT_CLK_MIN_HZ;
+  if (hz > CPLD_EXT_CLK_MAX_HZ) hz = CPLD_EXT_CLK_MAX_HZ;
+  return (uint32_t) hz;
+}
+
+/**
+* Enables or disables the clock governor. Disabling it leaves the clock where
+*   it is.
+*
+* @param  en  Should the governor manage the clock?
+*/
+void CPLDDriver::clkGovernor(bool en) {
+  _gov_enabled = en;
+  _clk_retune();
+}
+
+/**
+* Moves the CPLD clock to suit the declared demand.
+* Raising the clock always happens right away. Lowering it waits until the
+*   demand has fallen by a quarter, so small changes don't churn the timer.
+* Moving to the external clock starts the timer before the CPLD is told to use
+*   it. Moving to the internal oscillator tells the CPLD first, and the timer
+*   is stopped when the write is called back (see _process_cpld_base_return()).
+*
+* @return 1 if the clock was changed, 0 if not, -1 if the timer refused.
+*/
+int8_t CPLDDriver::_clk_retune() {
+  if (!_gov_enabled || !hardwareReady()) return 0;
+  const bool int_osc = (_shadow[CPLD_SHADOW_CONF] & CPLD_CONF_BIT_INT_CLK);
+  const uint32_t need = clkRequired();
+  if (0 == need) {
+    if (int_osc) return 0;
+    internalOscillator(true);
   }
   else {
-    writeRegister(CPLD_REG_CONFIG, (cpld_conf_value & ~mask));
+    if (!int_osc && _er_flag(CPLD_FLAG_EXT_OSC)) {
+      if ((need <= _ext_clk_freq) && (need > ((_ext_clk_freq >> 2) * 3))) return 0;
+    }
+    if (!_set_timer_base(need)) return -1;
+    if (int_osc || !_er_flag(CPLD_FLAG_EXT_OSC)) {
+      internalOscillator(false);
+    }
   }
+  _gov_retunes++;
+  if (getVerbosity() > 4) {
+    local_log.concatf("Clock governor: %u ops/s, %u B/s -> %s %u Hz\n",
+      (unsigned int) _gov_demand_ops, (unsigned int) _gov_demand_bytes,
+      (need ? "EXT" : "INT"), (unsigned int) (need ? _ext_clk_freq : 0)
+    );
+  }
+  return 1;
+}
+
+/**
+* Charges a completed transfer to the utilization window, and closes the
+*   window once it has run for CPLD_CLK_GOV_WINDOW_US.
+*
+* @param  busy_us  How long the transfer held the bus.
+* @param  bytes    The size of its buffer.
+* @param  now      micros()
+*/
+void CPLDDriver::_clk_account(uint32_t busy_us, uint32_t bytes, uint32_t now) {
+  _gov_busy_us += busy_us;
+  _gov_bytes   += bytes;
+  const uint32_t window = now - _gov_window_start;
+  if (window >= CPLD_CLK_GOV_WINDOW_US) {
+    const uint32_t util = (uint32_t) (((uint64_t) _gov_busy_us * 1000) / window);
+    _gov_util_permille = (util > 1000) ? 1000 : (uint16_t) util;
+    _gov_bytes_per_sec = (uint32_t) (((uint64_t) _gov_bytes * 1000000) / window);
+    _gov_busy_us       = 0;
+    _gov_bytes         = 0;
+    _gov_window_start  = now;
+  }
+}
+
+/**
+* Calling this function will set the CPLD config register. The change is
+*   shadowed, and written out with any others made in the same kernel pass.
+*
+* @param  mask   Combination of flags to change.
+* @param  state  Should the flags be cleared or set?
+*/
+void CPLDDriver::setCPLDConfig(uint8_t mask, bool state) {
+  const uint8_t cur = _shadow[CPLD_SHADOW_CONF];
+  _shadow_put(CPLD_SHADOW_CONF, (state ? (cur | mask) : (cur & ~mask)));
 }
 
 /**
@@ -959,11 +1584,112 @@ void CPLDDriver::setCPLDConfig(uint8_t mask, bool state) {
 * @param  state  Should the flags be cleared or set?
 */
 void CPLDDriver::_digit_irq_force(uint8_t d, bool state) {
-  if (state) {
-    writeRegister(CPLD_REG_DIGIT_FORSAKE, (forsaken_digits | (1 << d)));
+  const uint8_t cur = _shadow[CPLD_SHADOW_FORSAKE];
+  _shadow_put(CPLD_SHADOW_FORSAKE, (state ? (cur | (1 << d)) : (cur & ~(1 << d))));
+}
+
+/**
+* Stages a new value for one of the writable CPLD registers. The first change
+*   in a kernel pass schedules the flush. Later changes to the same register
+*   fold into the write that is already pending.
+*
+* @param  idx  The shadow index (CPLD_SHADOW_*).
+* @param  val  The value the register ought to hold.
+*/
+void CPLDDriver::_shadow_put(uint8_t idx, uint8_t val) {
+  const uint8_t bit = (1 << idx);
+  if (_shadow_dirty & bit) {
+    _shadow_saved++;   // Combined with a write already pending.
   }
-  else {
-    writeRegister(CPLD_REG_DIGIT_FORSAKE, (forsaken_digits & ~(1 << d)));
+  _shadow[idx]   = val;
+  _shadow_dirty |= bit;
+  if (!_shadow_pending) {
+    _shadow_pending = true;
+    Kernel::staticRaiseEvent(&_shadow_flush);
+  }
+}
+
+/**
+* Writes every dirty shadow to the CPLD, unless the CPLD was already sent that
+*   value. Register order matters for the oscillator hand-off, so CONFIG is
+*   always written first. Any external clock it needs will have been started
+*   by internalOscillator() before the shadow was touched.
+*/
+void CPLDDriver::_shadow_commit() {
+  _shadow_pending = false;
+  for (uint8_t i = 0; i < CPLD_SHADOW_COUNT; i++) {
+    const uint8_t bit = (1 << i);
+    if (_shadow_dirty & bit) {
+      // Compare against the write on the bus, if there is one.
+      const uint8_t held = (_shadow_inflight & bit) ? _shadow_flight[i] : _shadow_sent[i];
+      if (_shadow[i] != held) {
+        writeRegister(_shadow_addr[i], _shadow[i]);
+        _shadow_flight[i] = _shadow[i];
+        _shadow_inflight |= bit;
+        _shadow_writes++;
+      }
+      else {
+        _shadow_saved++;   // The write would not have changed anything.
+      }
+    }
+  }
+  _shadow_dirty = 0;
+}
+
+/**
+* Discards pending changes and takes the shadows from our register
+*   representations. Called when those are known to match the CPLD.
+*/
+void CPLDDriver::_shadow_sync() {
+  _shadow[CPLD_SHADOW_CONF]    = cpld_conf_value;
+  _shadow[CPLD_SHADOW_FORSAKE] = forsaken_digits;
+  _shadow[CPLD_SHADOW_WAKEUP]  = cpld_wakeup_source;
+  for (uint8_t i = 0; i < CPLD_SHADOW_COUNT; i++) {
+    _shadow_sent[i]    = _shadow[i];
+    _shadow_retries[i] = 0;
+  }
+  _shadow_dirty    = 0;
+  _shadow_inflight = 0;
+}
+
+/**
+* Called back when a write to a CPLD register is finished. Only a write that
+*   succeeded updates what the register is known to hold. If the latest write
+*   to a register failed, it is flushed again, up to CPLD_SHADOW_RETRIES times.
+*   After that, the register is left alone until it is next changed.
+*
+* @param  reg_addr  The register written.
+* @param  val       The value written.
+* @param  ok        Did the write succeed?
+*/
+void CPLDDriver::_shadow_done(uint8_t reg_addr, uint8_t val, bool ok) {
+  for (uint8_t i = 0; i < CPLD_SHADOW_COUNT; i++) {
+    if (reg_addr == _shadow_addr[i]) {
+      const uint8_t bit = (1 << i);
+      if (ok) {
+        _shadow_sent[i]    = val;
+        _shadow_retries[i] = 0;
+      }
+      if ((_shadow_inflight & bit) && (val == _shadow_flight[i])) {
+        _shadow_inflight &= ~bit;   // That was the latest write.
+        if (!ok && (_shadow[i] != _shadow_sent[i])) {
+          if (_shadow_retries[i] < CPLD_SHADOW_RETRIES) {
+            _shadow_retries[i]++;
+            _shadow_dirty |= bit;
+            if (!_shadow_pending) {
+              _shadow_pending = true;
+              Kernel::staticRaiseEvent(&_shadow_flush);
+            }
+          }
+          else {
+            _shadow_retries[i] = 0;   // The next change starts over.
+            _shadow_failed++;
+            if (getVerbosity() > 1) local_log.concatf("Gave up writing 0x%02x to CPLD register 0x%02x.\n", val, reg_addr);
+          }
+        }
+      }
+      return;
+    }
   }
 }
 
@@ -1025,53 +1751,44 @@ bool CPLDDriver::digitExists(DigitPort x) {
 
 
 /**
-* Processes the IRQ message from the CPLD. If the driver is also servicing IRQs,
-*   per-IMU signal groups will be passed to the ManuManager.
+* Handles one IRQ edge. Status lines are dealt with here, and IMU lines are
+*   passed to the ManuManager, if the driver is servicing IRQs.
 *
-* @return non-zero on error.
+* @param  bit    The stream bit index.
+* @param  level  The level after the edge.
+* @param  t_us   When the edge arrived.
 */
-int8_t CPLDDriver::iiu_group_irq() {
-  int8_t return_value = 0;
-  uint32_t _irq_time = micros();
-  const char* l_2_h = "L->H";
-  const char* h_2_l = "H->L";
-  // This class cares about these IRQs...
-  // 68  Metacarpals present.
-  // 69  Digit 1 present.
-  // 70  Digit 2 present.
-  // 71  Digit 3 present.
-  // 72  Digit 4 present.
-  // 73  Digit 5 present.
-  // 74  CONFIG register, bit 2.
-  // 75  CPLD_OE
-  // 76  Aggregated IRQ
-  // 77  Aggregated IRQ
-
-  if (_irq_accum[8] & 0x0F) {  // We only care about the bottom-half here.
-    if (_irq_accum[8] & 0x08) {
-      if (getVerbosity() > 4) local_log.concatf("MC PRESENT %s\n", irq_is_presently_high(68) ? l_2_h : h_2_l);
-    }
-    if (_irq_accum[8] & 0x04) {
-      if (getVerbosity() > 4) local_log.concatf("Digit_1 %s\n", irq_is_presently_high(69) ? l_2_h : h_2_l);
-    }
-    if (_irq_accum[8] & 0x02) {
-      if (getVerbosity() > 4) local_log.concatf("Digit_2 %s\n", irq_is_presently_high(70) ? l_2_h : h_2_l);
-    }
-    if (_irq_accum[8] & 0x01) {
-      if (getVerbosity() > 4) local_log.concatf("Digit_3 %s\n", irq_is_presently_high(71) ? l_2_h : h_2_l);
-    }
+void CPLDDriver::_irq_edge(uint8_t bit, uint8_t level, uint32_t t_us) {
+  // Keep our own picture of the lines, as of this edge.
+  if (bit < 64) {
+    const uint64_t m = (1ULL << (63 - bit));
+    _irq_seen.w0 = level ? (_irq_seen.w0 | m) : (_irq_seen.w0 & ~m);
+  }
+  else {
+    const uint16_t m = (uint16_t) (1 << (79 - bit));
+    _irq_seen.w1 = level ? (_irq_seen.w1 | m) : (_irq_seen.w1 & ~m);
   }
 
-  if (_irq_accum[9] & 0xFC) {  // We only care about the top-6.
-    if (_irq_accum[9] & 0x80) {
-      if (getVerbosity() > 4) local_log.concatf("Digit_4 %s\n", irq_is_presently_high(72) ? l_2_h : h_2_l);
-    }
-    if (_irq_accum[9] & 0x40) {
-      if (getVerbosity() > 4) local_log.concatf("Digit_5 %s\n", irq_is_presently_high(73) ? l_2_h : h_2_l);
+  if (bit >= 68) {
+    // This class cares about these IRQs...
+    // 68  Metacarpals present.
+    // 69  Digit 1 present.
+    // 70  Digit 2 present.
+    // 71  Digit 3 present.
+    // 72  Digit 4 present.
+    // 73  Digit 5 present.
+    // 74  CONFIG register, bit 2.
+    // 75  CPLD_OE
+    // 76  Aggregated IRQ
+    // 77  Aggregated IRQ
+    if (bit > 77) return;
+    if ((bit < 74) && (nullptr != _manu)) {
+      // A digit came or went. The sensor reads follow presence.
+      _manu->digitPresenceChanged();
     }
-    if (_irq_accum[9] & 0x20) {
+    if (74 == bit) {
       if (0 == _irq_latency_2) {
-        _irq_latency_2 = _irq_time;
+        _irq_latency_2 = (uint32_t) micros();
         if (getVerbosity() > 4) {
           local_log.concatf("IRQ latency\n\tArrival:     %u us\n", wrap_accounted_delta(_irq_latency_0, _irq_latency_1));
           local_log.concatf("\tApplication  %u us\n", wrap_accounted_delta(_irq_latency_0, _irq_latency_2));
@@ -1081,74 +1798,69 @@ int8_t CPLDDriver::iiu_group_irq() {
         // We have verified that we can talk to the hardware.
         _er_set_flag(CPLD_FLAG_CPLD_READY);
         irq_service_enabled(true);
+        _clk_retune();  // Any demand declared before now can be acted on.
       }
     }
-    if (_irq_accum[9] & 0x10) {
-      if (getVerbosity() > 4) local_log.concatf("CPLD_OE %s.\n", irq_is_presently_high(75) ? l_2_h : h_2_l);
-    }
-    if (_irq_accum[9] & 0x08) {
-      if (getVerbosity() > 4) local_log.concatf("IRQ76 %s.\n", irq_is_presently_high(76) ? l_2_h : h_2_l);
-    }
-    if (_irq_accum[9] & 0x04) {
-      if (getVerbosity() > 4) local_log.concatf("IRQ77 %s.\n", irq_is_presently_high(77) ? l_2_h : h_2_l);
+    else if (getVerbosity() > 4) {
+      local_log.concatf("%s %s\n", _irq_status_names[bit - 68], level ? "L->H" : "H->L");
     }
+    return;
   }
 
-  if ((nullptr != _manu) && irq_service_enabled()) {
-    uint8_t imu_offset = 0;
-    // Now we will scan across the IMU signals looking for the data ready signals.
-    // If all the present digits have their signals raised, we fire the frame
-    //   read for that sensor aspect.
-    uint16_t irq_svc_slice = irq_digit_slice_service(DigitPort::MC);
-    uint16_t irq_dat_slice = irq_digit_slice_current(DigitPort::MC);
-    if (irq_svc_slice & 0x0F) {
-      // The first 4-bits of data are not subject to guards, since the IMU is on
-      //   the PCB with the CPLD and shift register.
-      _manu->deliverIRQ(DigitPort::MC, imu_offset, (irq_dat_slice & 0x0F), (irq_svc_slice & 0x0F));
-    }
-    imu_offset++;
+  if ((nullptr == _manu) || !irq_service_enabled()) return;
+  DigitPort port = DigitPort::PORT_5;
+  uint8_t   imu  = 14;
+  if (bit < 64) {
+    const uint8_t nib = 15 - (bit >> 2);
+    port = (DigitPort) _irq_nibble_port[nib];
+    imu  = _irq_nibble_imu[nib];
+  }
+  // Signals from the PCB IMU are not subject to guards, since it is on the
+  //   PCB with the CPLD and shift register. The others are only heeded if
+  //   their digit is present.
+  if ((0 != imu) && !digitExists(port)) return;
+
+  const uint8_t shift = (bit < 64) ? ((63 - bit) & 0x3C) : ((79 - bit) & 0x3C);
+  const uint8_t data  = (uint8_t) (((bit < 64) ? (_irq_seen.w0 >> shift) : (_irq_seen.w1 >> shift)) & 0x0F);
+  _manu->deliverIRQ(port, imu, data, (uint8_t) (0x08 >> (bit & 0x03)), t_us);
+}
 
-    if (digitExists(DigitPort::MC)) {
-      // The top 4-bits are only observed if the MC unit is connected.
-      if (irq_svc_slice & 0xF0) {
-        // Ship IRQ to MC IMU.
-        _manu->deliverIRQ(DigitPort::MC, imu_offset, (irq_dat_slice & 0xF0) >> 4, (irq_svc_slice & 0xF0));
-      }
-    }
-    imu_offset++;
-
-    for (uint8_t i = 1; i < 6; i++) {
-      // The other digits are loopable.
-      const DigitPort port = (DigitPort) i;
-      if (digitExists(port)) {
-        irq_svc_slice = irq_digit_slice_service(port);
-        irq_dat_slice = irq_digit_slice_current(port);
-
-        if (irq_svc_slice) {
-          const uint8_t p_svc = irq_svc_slice & 0x000F;
-          const uint8_t i_svc = (irq_svc_slice >> 4) & 0x000F;
-          const uint8_t d_svc = (irq_svc_slice >> 8) & 0x000F;
-          if (d_svc) {  // Distal
-            _manu->deliverIRQ(port, imu_offset+2, (irq_dat_slice >> 8) & 0x000F, d_svc);
-          }
-          if (i_svc) {  // Intermediate
-            _manu->deliverIRQ(port, imu_offset+1, (irq_dat_slice >> 4) & 0x000F, i_svc);
-          }
-          if (p_svc) {  // Proximal
-            _manu->deliverIRQ(port, imu_offset+0, irq_dat_slice & 0x000F, p_svc);
-          }
-        }
+
+/**
+* Drains a batch of IRQ edges from the ring, in order of arrival, and keeps
+*   the service latency figures. Edges that overflowed the ring are serviced
+*   afterward, with the current time and level standing in for their own.
+*
+* @return The number of edges handled.
+*/
+int8_t CPLDDriver::iiu_group_irq() {
+  const uint32_t now = (uint32_t) micros();
+  uint16_t handled = 0;
+  IRQEvent ev;
+  while ((handled < CPLD_IRQ_BATCH_MAX) && _irq_ring.get(&ev)) {
+    const uint32_t lat = now - ev.t_us;
+    _irq_lat_count++;
+    _irq_lat_total_us += lat;
+    if (lat > _irq_lat_max_us) _irq_lat_max_us = lat;
+    _irq_edge(ev.bit, ev.level, ev.t_us);
+    handled++;
+  }
+  if (handled > _irq_batch_max) _irq_batch_max = handled;
+
+  if (_irq_ring.isEmpty()) {
+    for (uint8_t i = 0; i < 3; i++) {
+      // Take the word and clear it in one step, since the ISR might add more.
+      uint32_t l = __atomic_exchange_n(&_irq_lost[i], 0, __ATOMIC_ACQUIRE);
+      while (l) {
+        const uint8_t bit = (uint8_t) ((i << 5) + __builtin_ctz(l));
+        l &= (l - 1);
+        _irq_edge(bit, irq_is_presently_high(bit), now);
+        _irq_edges_lost++;
       }
-      imu_offset += 3;
     }
   }
-
-  // Mark everything as serviced.
-  for (int i = 0; i < 10; i++) {
-    _irq_accum[i] = 0;
-  }
   flushLocalLog();
-  return return_value;
+  return (handled > 127) ? 127 : (int8_t) handled;
 }
 
 
@@ -1197,7 +1909,6 @@ int8_t CPLDDriver::attached() {
     _irq_data_arrival.incRefs();
     _irq_data_arrival.specific_target = (EventReceiver*) this;
     _irq_data_arrival.priority(2);
-    _irq_data_arrival.addArg((void*) _irq_accum, 10);
 
     _periodic_debug.repurpose(0x5080, (EventReceiver*) this);
     _periodic_debug.incRefs();
@@ -1257,12 +1968,24 @@ int8_t CPLDDriver::callback_proc(ManuvrMsg* event) {
   /* Some class-specific set of conditionals below this line. */
   switch (event->eventCode()) {
     case DIGITABULUM_MSG_IMU_IRQ_RAISED:
+      if (_irq_ring.isEmpty()) {
+        // Let the ISR raise the message again. It won't have for edges that
+        //   arrived since the check above, so look once more.
+        __atomic_store_n(&_irq_event_pending, 0, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!_irq_ring.isEmpty() && irq_event_claim()) {
+          return_value = EVENT_CALLBACK_RETURN_RECYCLE;
+        }
+      }
+      else {
+        return_value = EVENT_CALLBACK_RETURN_RECYCLE;
+      }
       break;
     case DIGITABULUM_MSG_SPI_QUEUE_READY:
       //return_value = ((work_queue.size() > 0) || (nullptr != current_job)) ? EVENT_CALLBACK_RETURN_RECYCLE : return_value;
       break;
     case DIGITABULUM_MSG_SPI_CB_QUEUE_READY:
-      return_value = (callback_queue.size() > 0) ? EVENT_CALLBACK_RETURN_RECYCLE : return_value;
+      return_value = (_callback_ring.isEmpty()) ? return_value : EVENT_CALLBACK_RETURN_RECYCLE;
       break;
     default:
       break;
@@ -1316,6 +2039,11 @@ int8_t CPLDDriver::notify(ManuvrMsg* active_event) {
       return_value = 1;
       break;
 
+    case DIGITABULUM_MSG_CPLD_SHADOW_FLUSH:
+      _shadow_commit();
+      return_value = 1;
+      break;
+
     case DIGITABULUM_MSG_CPLD_RESET_CALLBACK:
       return_value = 1;
       if (getVerbosity() > 4) local_log.concat("CPLD reset. Testing IRQs...\n");
@@ -1345,22 +2073,54 @@ void CPLDDriver::printDebug(StringBuilder* output) {
   if (_er_flag(CPLD_FLAG_EXT_OSC)) {
     output->concatf("-- Ext freq:           %u\n", _ext_clk_freq);
   }
+  output->concatf("-- Clock governor      %s (%u%% headroom, %u retunes)\n",
+    (_gov_enabled ? "on" : "off"), _gov_headroom, (unsigned int) _gov_retunes
+  );
+  output->concatf("-- Declared demand     %u ops/s, %u B/s -> %u Hz\n",
+    (unsigned int) _gov_demand_ops, (unsigned int) _gov_demand_bytes, (unsigned int) clkRequired()
+  );
+  output->concatf("-- Bus utilization     %u.%u%% (%u B/s)\n",
+    _gov_util_permille / 10, _gov_util_permille % 10, (unsigned int) _gov_bytes_per_sec
+  );
 
   output->concatf("-- DEN_AG (C/MC)       %s / %s\n", (_conf_bits_set(CPLD_CONF_BIT_DEN_AG_C) ? "on":"off"), (_conf_bits_set(CPLD_CONF_BIT_DEN_AG_MC) ? "on":"off"));
   output->concatf("-- CPLD_GPIO           %s\n", (_conf_bits_set(CPLD_CONF_BIT_GPIO) ? "hi":"lo"));
   output->concatf("-- Bus power conserve  %s\n", ((cpld_conf_value & CPLD_CONF_BIT_PWR_CONSRV) ? "on":"off"));
   output->concatf("-- Forsaken:           0x%02x\n--\n", forsaken_digits);
   output->concatf("-- IRQ76_reg:          0x%02x\n--\n", irq76_conf);
+  output->concatf("-- Shadowed writes     %u sent / %u saved / %u failed%s\n",
+    (unsigned int) _shadow_writes,
+    (unsigned int) _shadow_saved,
+    (unsigned int) _shadow_failed,
+    (_shadow_dirty ? " (pending)" : "")
+  );
 
   if (getVerbosity() > 2) {
     output->concatf("-- Guarding queue      %s\n",   (_er_flag(CPLD_FLAG_QUEUE_GUARD)?"yes":"no"));
     output->concatf("-- spi_cb_per_event    %d\n\n", spi_cb_per_event);
   }
   printAdapter(output);
-  output->concatf("-- callback q depth    %d\n--\n", callback_queue.size());
+  for (uint8_t l = 0; l < CPLD_SPI_LANE_COUNT; l++) {
+    BusLaneState* lane = &_lanes[l];
+    output->concatf("-- %s lane       %u / %u (high-water %u, overflows %u)\n",
+      (l == (uint8_t) BusLane::REALTIME) ? "Realtime  " : "Background",
+      lane->ring.count(), lane->ring.capacity(), lane->ring.highWater(), (unsigned int) lane->ring.overflows()
+    );
+    output->concatf("--   served %u, expired %u, rejected %u, wait avg/max %uus / %uus\n",
+      (unsigned int) lane->served, (unsigned int) lane->expired, (unsigned int) lane->rejected,
+      (unsigned int) ((lane->served > 0) ? (lane->wait_total_us / lane->served) : 0),
+      (unsigned int) lane->wait_max_us
+    );
+  }
+  output->concatf("-- Callback ring       %u / %u (high-water %u, overflows %u)\n--\n",
+    _callback_ring.count(), _callback_ring.capacity(), _callback_ring.highWater(), (unsigned int) _callback_ring.overflows()
+  );
+  for (uint8_t i = 0; i < CPLD_SPI_MAX_CHAINS; i++) {
+    if (nullptr != _bus_chains[i]) _bus_chains[i]->printDebug(output);
+  }
 
-  if (getVerbosity() > 3) {
-    printWorkQueue(output, CPLD_SPI_MAX_QUEUE_PRINT);
+  if ((getVerbosity() > 3) && (nullptr != current_job)) {
+    current_job->printDebug(output);
   }
   output->concat("\n\n");
 }
@@ -1395,11 +2155,21 @@ void CPLDDriver::printIRQs(StringBuilder* output) {
   for (int i = 0; i < 10; i++) { output->concatf("%02x", _irq_data_0[i]); }
   output->concat("\n--    _irq_data_1:     ");
   for (int i = 0; i < 10; i++) { output->concatf("%02x", _irq_data_1[i]); }
-  output->concat("\n--    _irq_diff:       ");
-  for (int i = 0; i < 10; i++) { output->concatf("%02x", _irq_diff[i]); }
-  output->concat("\n--    _irq_accum:      ");
-  for (int i = 0; i < 10; i++) { output->concatf("%02x", _irq_accum[i]); }
-  output->concat("\n\n");
+  output->concatf("\n--    _irq_diff:       %016llx%04x", (unsigned long long) _irq_diff.w0, _irq_diff.w1);
+  output->concatf("\n--    _irq_seen:       %016llx%04x", (unsigned long long) _irq_seen.w0, _irq_seen.w1);
+  output->concatf("\n-- Edge ring           %u queued, high water %u/%u, %u overflowed\n",
+    _irq_ring.count(), _irq_ring.highWater(), _irq_ring.capacity(), (unsigned int) _irq_ring.overflows()
+  );
+  output->concatf("-- Edges lost          %u\n", (unsigned int) _irq_edges_lost);
+  if (_irq_lat_count) {
+    output->concatf("-- Service latency     %u edges, avg %u us, max %u us, biggest batch %u\n",
+      (unsigned int) _irq_lat_count,
+      (unsigned int) (_irq_lat_total_us / _irq_lat_count),
+      (unsigned int) _irq_lat_max_us,
+      _irq_batch_max
+    );
+  }
+  output->concat("\n");
 }
 
 
@@ -1416,11 +2186,121 @@ static const ConsoleCommand console_cmds[] = {
   { "i3", "Digit states" },
   { "i4", "Measure IRQ latency" },
   { "i5", "Hardware state" },
+  { "i6", "Benchmark IRQ frame decode" },
+  { "i7", "Reset IRQ latency stats" },
+  { "h", "Bus latency histograms" },
+  { "h1", "Bus latency histograms (machine-readable)" },
+  { "h2", "Reset bus latency histograms" },
+  { "l", "Reset bus lane stats" },
+  { "G", "Enable or disable the clock governor." },
+  { "H", "Set the clock governor's headroom (percent)." },
   { "o", "Enable or disable internal oscillator." },
   { "O", "Enable or disable external oscillator." }
 };
 
 
+/**
+* The byte-wise slice extraction that the slice table replaced. Kept as a
+*   reference for irq_decode_bench().
+*/
+static uint16_t irq_slice_bytewise(const uint8_t* b, uint8_t port) {
+  switch (port) {
+    case 0:  return b[0];
+    case 1:  return ((uint16_t) b[1] << 4) + (b[2] >> 4);
+    case 2:  return ((uint16_t) (b[2] & 0x0F) << 8) + b[3];
+    case 3:  return ((uint16_t) b[4] << 4) + (b[5] >> 4);
+    case 4:  return ((uint16_t) (b[5] & 0x0F) << 8) + b[6];
+    case 5:  return ((uint16_t) b[7] << 4) + (b[8] >> 4);
+  }
+  return 0;
+}
+
+/**
+* Microbenchmark for the IRQ decode path. Runs a fixed pseudo-random sequence
+*   of frames through each stage, using local state only, so it is safe to run
+*   with the hardware live. The table-driven slices are also checked against
+*   the byte-wise reference.
+*
+* @param  output  The buffer to receive the results.
+* @param  count   How many frames to decode.
+*/
+static void irq_decode_bench(StringBuilder* output, uint32_t count) {
+  uint8_t  frames[32][10];
+  uint32_t x = 0x2545F491;   // xorshift32 state.
+  for (uint8_t f = 0; f < 32; f++) {
+    for (uint8_t i = 0; i < 10; i++) {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      // Sparse changes look more like the real thing.
+      frames[f][i] = (f > 0) ? (frames[f-1][i] ^ ((x & 0x07) ? 0 : (uint8_t) (x >> 8))) : (uint8_t) x;
+    }
+  }
+
+  volatile uint32_t sink = 0;   // Keeps the optimizer honest.
+  IRQFrame acc = {0, 0};
+  uint32_t t0 = micros();
+  for (uint32_t n = 0; n < count; n++) {
+    const IRQFrame prior = irq_frame_load(frames[n & 31]);
+    const IRQFrame cur   = irq_frame_load(frames[(n + 1) & 31]);
+    acc.w0 |= (prior.w0 ^ cur.w0);
+    acc.w1 |= (prior.w1 ^ cur.w1);
+  }
+  const uint32_t t_ingest = micros() - t0;
+  sink = sink + (uint32_t) acc.w0 + acc.w1;
+
+  t0 = micros();
+  for (uint32_t n = 0; n < count; n++) {
+    const IRQFrame cur = irq_frame_load(frames[n & 31]);
+    for (uint8_t p = 0; p < 6; p++) sink = sink + irq_frame_slice(&cur, (DigitPort) p);
+  }
+  const uint32_t t_slice = micros() - t0;
+
+  t0 = micros();
+  for (uint32_t n = 0; n < count; n++) {
+    for (uint8_t p = 0; p < 6; p++) sink = sink + irq_slice_bytewise(frames[n & 31], p);
+  }
+  const uint32_t t_slice_ref = micros() - t0;
+
+  uint32_t delivered = 0;
+  t0 = micros();
+  for (uint32_t n = 0; n < count; n++) {
+    const IRQFrame prior = irq_frame_load(frames[n & 31]);
+    const IRQFrame cur   = irq_frame_load(frames[(n + 1) & 31]);
+    uint64_t gate    = IRQ_W0_PCB_IMU;
+    uint8_t  present = (cur.w1 >> 6) & 0x3F;
+    while (present) {
+      gate |= _irq_w0_gate[5 - __builtin_ctz(present)];
+      present &= (present - 1);
+    }
+    uint64_t svc = (prior.w0 ^ cur.w0) & gate;
+    while (svc) {
+      const uint8_t nib = (uint8_t) (__builtin_ctzll(svc) >> 2);
+      svc &= ~(0x0FULL << (nib << 2));
+      sink = sink + _irq_nibble_imu[nib];
+      delivered++;
+    }
+  }
+  const uint32_t t_walk = micros() - t0;
+
+  uint32_t mismatches = 0;
+  for (uint8_t f = 0; f < 32; f++) {
+    const IRQFrame cur = irq_frame_load(frames[f]);
+    for (uint8_t p = 0; p < 6; p++) {
+      if (irq_frame_slice(&cur, (DigitPort) p) != irq_slice_bytewise(frames[f], p)) mismatches++;
+    }
+  }
+
+  const uint32_t c = (count > 0) ? count : 1;
+  output->concatf("---< IRQ decode (%u frames) >------------\n", (unsigned int) count);
+  output->concatf("\tLoad+diff+accum   %u us  (%u ns/frame)\n", (unsigned int) t_ingest, (unsigned int) ((t_ingest * 1000ULL) / c));
+  output->concatf("\tSlices (table)    %u us  (%u ns/frame)\n", (unsigned int) t_slice, (unsigned int) ((t_slice * 1000ULL) / c));
+  output->concatf("\tSlices (bytewise) %u us  (%u ns/frame)\n", (unsigned int) t_slice_ref, (unsigned int) ((t_slice_ref * 1000ULL) / c));
+  output->concatf("\tNibble walk       %u us  (%u ns/frame, %u deliveries)\n", (unsigned int) t_walk, (unsigned int) ((t_walk * 1000ULL) / c), (unsigned int) delivered);
+  output->concatf("\tSlice mismatches  %u\n\n", (unsigned int) mismatches);
+}
+
+
 uint CPLDDriver::consoleGetCmds(ConsoleCommand** ptr) {
   *ptr = (ConsoleCommand*) &console_cmds[0];
   return sizeof(console_cmds) / sizeof(ConsoleCommand);
@@ -1465,6 +2345,18 @@ void CPLDDriver::consoleCmdProc(StringBuilder* input) {
         case 5:
           printHardwareState(&local_log);
           break;
+        case 6:
+          irq_decode_bench(&local_log, 20000);
+          break;
+        case 7:
+          _irq_lat_count    = 0;
+          _irq_lat_total_us = 0;
+          _irq_lat_max_us   = 0;
+          _irq_batch_max    = 0;
+          _irq_edges_lost   = 0;
+          _irq_ring.resetStats();
+          local_log.concat("IRQ latency stats reset.\n");
+          break;
         //case 6:
         //  local_log.concat("\n--    debug_buffer:\n");
         //  for (int i = 0; i < 32; i++) { local_log.concatf("%02x ", debug_buffer[i]); }
@@ -1497,6 +2389,24 @@ void CPLDDriver::consoleCmdProc(StringBuilder* input) {
       _er_flip_flag(CPLD_FLAG_QUEUE_GUARD);
       local_log.concatf("CPLD guarding SPI queue from overflow?  %s\n", _er_flag(CPLD_FLAG_QUEUE_GUARD)?"yes":"no");
       break;
+    case 'h':     // Bus latency profile.
+      switch (temp_int) {
+        case 1:
+          _profiler.serialize(&local_log);
+          break;
+        case 2:
+          _profiler.reset();
+          local_log.concat("Bus profile reset.\n");
+          break;
+        default:
+          _profiler.printDebug(&local_log);
+          break;
+      }
+      break;
+    case 'l':     // Reset the lane statistics.
+      _lane_reset_stats();
+      local_log.concat("Bus lane stats reset.\n");
+      break;
     case 'm':     // Set the number of callbacks per event.
       if (temp_int) spi_cb_per_event = temp_int;
       local_log.concatf("CPLD spi_cb_per_event:  %d\n", spi_cb_per_event);
@@ -1517,6 +2427,15 @@ void CPLDDriver::consoleCmdProc(StringBuilder* input) {
       }
       break;
 
+    case 'G':     // Clock governor.
+      clkGovernor(0 != temp_int);
+      local_log.concatf("Clock governor %sabled.\n", (clkGovernor() ? "en" : "dis"));
+      break;
+    case 'H':     // Clock governor headroom.
+      clkHeadroom((uint8_t) strict_min(strict_max(temp_int, 0), 255));
+      local_log.concatf("Clock headroom is now %u%%.\n", _gov_headroom);
+      break;
+
     case 'p':     // Purge the SPI1 work queue.
       purge_queued_work();
       local_log.concat("SPI1 queue purged.\n");
@@ -1524,7 +2443,8 @@ void CPLDDriver::consoleCmdProc(StringBuilder* input) {
 
     case '%':   // Ext clock rate.
       if (setCPLDClkFreq(strict_max(temp_int, 1)*1000)) {
-        local_log.concatf("Set ext clock period to %d kHz.\n", strict_max(temp_int, 1));
+        _gov_enabled = false;   // The user is driving now.
+        local_log.concatf("Set ext clock period to %d kHz. Clock governor disabled.\n", strict_max(temp_int, 1));
       }
       else {
         local_log.concat("Failed to set ext clock period.\n");
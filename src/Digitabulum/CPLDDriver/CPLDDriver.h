@@ -102,6 +102,12 @@ The clock source can be changed at any time. Bus operations can continue
 
 Using the internal oscilllator will result in an SPI bus clock of ~2.8MHz.
 
+The clock governor does the proportional driving. Whoever generates the bulk of
+  the bus traffic (the ManuManager) declares it with setBusDemand(), and the
+  governor sets the external clock to carry that load plus a headroom margin.
+  With no declared demand, the CPLD is moved to its internal oscillator. Both
+  moves follow the ordering above.
+
 These are the hardware pin assignments and descriptions for the CPLD:
 --------------------------------------------------------------------------------
   CPLD Pin     | CPU Port/Pin | Description
@@ -281,6 +287,10 @@ Combined with the full-frame magnetometer read, we get a full frame of sensor
   |   0x91    |   0x06    |   0x11    |   0xA8    |     0x00 .... 0x00      |
   \-------------------------------------------------------------------------/
 
+Those two transactions can also be run as a single SPIBusChain, in which case
+  the bus starts the second from the completion ISR of the first, and the
+  caller gets one callback for the whole frame.
+
 
 Ranked IMU Access
 --------------------------------------------------------------------------------
@@ -329,6 +339,8 @@ IRQ agg and addressing system is complete. At least: it passes simulation.
   #include <XenoSession/Console/ManuvrConsole.h>
   #include <XenoSession/Console/ConsoleInterface.h>
 #endif
+#include "../SPSCRing.h"
+#include "BusProfiler.h"
 
 #define CPLD_MINIMUM_VERSION    30
 #define CPLD_GUARD_BIT_VALUE  0x03
@@ -347,6 +359,50 @@ IRQ agg and addressing system is complete. At least: it passes simulation.
   // How many queue items should we have on-tap?
   #define CPLD_SPI_PREALLOC_COUNT  10
 #endif
+#ifndef CPLD_SPI_RING_DEPTH
+  // Slots in each lane's work ring. Must be a power of two, and larger than
+  //   the queue depth, which applies to each lane on its own.
+  #define CPLD_SPI_RING_DEPTH      64
+#endif
+#ifndef CPLD_SPI_CB_RING_DEPTH
+  // Slots in the callback ring. Must be a power of two, and larger than both
+  //   lanes' queue depths, plus the op on the bus, since every one of them
+  //   might be called back at once.
+  #define CPLD_SPI_CB_RING_DEPTH   128
+#endif
+#ifndef CPLD_IRQ_RING_DEPTH
+  // Slots for IRQ edges waiting on service. Must be a power of two. A frame
+  //   can carry many edges at once (EG, every DRDY line rising together).
+  #define CPLD_IRQ_RING_DEPTH      128
+#endif
+#ifndef CPLD_IRQ_BATCH_MAX
+  // How many IRQ edges should be serviced per event?
+  #define CPLD_IRQ_BATCH_MAX       32
+#endif
+#ifndef CPLD_CLK_GOV_HEADROOM
+  // Percent of bus capacity the clock governor holds above declared demand.
+  #define CPLD_CLK_GOV_HEADROOM    50
+#endif
+#define CPLD_EXT_CLK_MAX_HZ        20000000  // The CPLD's limit on its external clock.
+#define CPLD_EXT_CLK_MIN_HZ        200000    // The governor won't go below this.
+#define CPLD_CLK_GOV_OP_OVERHEAD   6         // Byte-times each op spends beyond its buffer.
+#define CPLD_CLK_GOV_WINDOW_US     1000000   // Bus utilization is averaged over this long.
+#ifndef CPLD_SPI_MAX_RT_OPS
+  // How many bus operations can be registered for the real-time lane?
+  #define CPLD_SPI_MAX_RT_OPS      4
+#endif
+#ifndef CPLD_SPI_RT_BURST_MAX
+  // How many real-time ops can be started in a row while background work waits?
+  #define CPLD_SPI_RT_BURST_MAX    4
+#endif
+#ifndef CPLD_SPI_MAX_CHAINS
+  // How many transaction chains can be registered with the driver at once?
+  #define CPLD_SPI_MAX_CHAINS      3
+#endif
+#ifndef CPLD_SPI_CHAIN_SEGMENTS
+  // How many segments can a chain carry beyond the one held by its op?
+  #define CPLD_SPI_CHAIN_SEGMENTS  7
+#endif
 
 /*
 * These state flags are hosted by the EventReceiver. This may change in the future.
@@ -369,6 +425,7 @@ IRQ agg and addressing system is complete. At least: it passes simulation.
 #define DIGITABULUM_MSG_CPLD_RESET_COMPLETE  0x0603 // The CPLD reset is ready for disassertion.
 #define DIGITABULUM_MSG_CPLD_RESET_CALLBACK  0x0604 // The CPLD reset is ready for disassertion.
 #define DIGITABULUM_MSG_CPLD_DIGIT_DROP      0x0605 // A digit was lost.
+#define DIGITABULUM_MSG_CPLD_SHADOW_FLUSH    0x060E // Pending CPLD register changes should be written.
 
 /* Event codes that are specific to Digitabulum's IMU apparatus. */
 #define DIGITABULUM_MSG_IMU_IRQ_RAISED       0x0606 // IRQ asserted by CPLD.
@@ -439,6 +496,13 @@ IRQ agg and addressing system is complete. At least: it passes simulation.
 #define CPLD_CONF_BIT_DEN_AG_C   0x40  // Set DEN_AG pin for the C IMU
 #define CPLD_CONF_BIT_DEN_AG_MC  0x80  // Set DEN_AG pin for the MC IMU
 
+/* Indices into the shadow register table. */
+#define CPLD_SHADOW_CONF         0     // CPLD_REG_CONFIG
+#define CPLD_SHADOW_FORSAKE      1     // CPLD_REG_DIGIT_FORSAKE
+#define CPLD_SHADOW_WAKEUP       2     // CPLD_REG_WAKEUP_IRQ
+#define CPLD_SHADOW_COUNT        3
+#define CPLD_SHADOW_RETRIES      3     // Times a failed register write is tried again.
+
 
 //TODO: These values are not correct, but the pattern is.
 #define CPLD_IRQ_BITMASK_DRDY_MASK_0   0x11111111  //
@@ -562,6 +626,102 @@ enum class DigitPort : uint8_t {
 };
 
 
+/*
+* Bus work is split into lanes. The real-time lane carries sensor reads that
+*   are only worth doing while their data is fresh. Everything else (register
+*   configuration, identity checks, diagnostics) rides in the background lane.
+*/
+enum class BusLane : uint8_t {
+  REALTIME   = 0,
+  BACKGROUND = 1
+};
+#define CPLD_SPI_LANE_COUNT  2
+
+static_assert(CPLD_SPI_RING_DEPTH > CPLD_SPI_MAX_QUEUE_DEPTH, "CPLD_SPI_RING_DEPTH must exceed CPLD_SPI_MAX_QUEUE_DEPTH.");
+static_assert(CPLD_SPI_CB_RING_DEPTH > ((CPLD_SPI_LANE_COUNT * CPLD_SPI_MAX_QUEUE_DEPTH) + 1), "CPLD_SPI_CB_RING_DEPTH must hold every lane's queue, and the op on the bus.");
+
+/* A queued bus operation, with what the lane needs to know about it. */
+typedef struct {
+  SPIBusOp* op;
+  uint32_t  queued_at;    // micros() at the time of queueing.
+  uint32_t  deadline_us;  // If not started this long after queueing, skip it. 0 for never.
+} LaneEntry;
+
+/* A finished bus operation awaiting its callback, with its bus timestamps. */
+typedef struct {
+  SPIBusOp* op;
+  uint32_t  t_queued;
+  uint32_t  t_began;
+  uint32_t  t_done;
+  bool      profiled;     // false if the op never ran on the bus.
+} CallbackEntry;
+
+/* A lane's queue and its wait-time statistics. */
+typedef struct {
+  SPSCRing<LaneEntry, CPLD_SPI_RING_DEPTH> ring;
+  uint32_t served;         // Ops started from this lane.
+  uint32_t expired;        // Ops skipped because their deadline passed.
+  uint32_t rejected;       // Ops refused by the queue guard or a full ring.
+  uint32_t wait_total_us;  // Sum of queue-to-start time for served ops.
+  uint32_t wait_max_us;    // Worst queue-to-start time for a served op.
+} BusLaneState;
+
+
+/*
+* A transaction chain is a single SPIBusOp that the bus runs as several CPLD
+*   transactions back-to-back, without returning to the kernel between them.
+*
+* The op's own parameters and buffer are the first segment. Each added segment
+*   carries its own four transfer parameters, and is run with the op's opcode.
+*   When a segment finishes, the target's completion ISR loads the next one into
+*   the op and restarts it. Only after the last segment is the op completed, and
+*   called back once. By that time, the op has been put back into the shape of
+*   its first segment, so it can be recycled as-is.
+*
+* A segment with a null buffer is written after the previous segment's data,
+*   skipping over the segment's gap (if any). This is how a chain assembles one
+*   frame from several register blocks, and how it scatters runs of devices
+*   into their own slots when the devices between them are not read.
+*
+* The CPLD needs a REQ cycle and an address header for every transaction, so
+*   each segment is still its own transfer on the wire. What is saved is the
+*   queueing, callahead, and callback for every segment after the first.
+*/
+class SPIBusChain {
+  public:
+    SPIBusChain(SPIBusOp* op) : _op(op) {};
+
+    int8_t addSegment(uint8_t dev_addr, uint8_t xfer_len, uint8_t dev_count, uint8_t reg_addr, uint8_t* buf, uint16_t len, uint16_t gap = 0);
+    void   printDebug(StringBuilder*);
+
+    inline SPIBusOp* op() {            return _op;                };
+    inline uint8_t   segmentCount() {  return (_seg_count + 1);   };
+    inline uint32_t  runs() {          return _runs;              };
+    inline void      dropSegments() {  rewind();  _seg_count = 0; };
+
+    /* These are called by the bus. Not by the op's owner. */
+    bool advance();
+    void rewind();
+
+  private:
+    typedef struct {
+      uint8_t  params[4];
+      uint8_t* buf;
+      uint16_t len;
+      uint16_t gap;   // Bytes to skip before a null-buffer segment.
+    } ChainSegment;
+
+    SPIBusOp*    _op;
+    ChainSegment _first;   // The op's own segment, saved while the chain runs.
+    ChainSegment _segs[CPLD_SPI_CHAIN_SEGMENTS];
+    uint32_t     _runs      = 0;  // How many times the chain has run to the end.
+    uint8_t      _seg_count = 0;  // How many segments are in _segs.
+    uint8_t      _cursor    = 0;  // 0 means the op is on its first segment.
+
+    void _load(ChainSegment*);
+};
+
+
 /*
 * The CPLD driver class.
 */
@@ -628,10 +788,33 @@ class CPLDDriver : public EventReceiver,
     */
     inline int setCPLDClkFreq(int hz) {   return (_set_timer_base(hz) ? 1:0); };
 
+    /* Clock governor. */
+    void     setBusDemand(uint32_t ops_per_sec, uint32_t bytes_per_sec);
+    uint32_t clkRequired();
+    void     clkGovernor(bool);
+    inline bool clkGovernor() {               return _gov_enabled;        };
+    inline void clkHeadroom(uint8_t pct) {    _gov_headroom = pct;  _clk_retune();  };
+    inline uint16_t busUtilization() {        return _gov_util_permille;  };  // In tenths of a percent.
+
     inline int8_t setWakeupSignal(uint8_t _val) {
-      return writeRegister(CPLD_REG_WAKEUP_IRQ, _val | 0x80);
+      _shadow_put(CPLD_SHADOW_WAKEUP, _val | 0x80);
+      return 0;
     };
 
+    /**
+    * Only meaningful from inside io_op_callback().
+    *
+    * @return micros() at the end of the transfer being called back.
+    */
+    inline uint32_t xferDoneUs() {            return _cb_xfer_done_us;    };
+
+    int8_t setRealtime(SPIBusOp*, uint32_t deadline_us);
+    int8_t clearRealtime(SPIBusOp*);
+    BusLane laneFor(SPIBusOp*);
+
+    int8_t registerChain(SPIBusChain*);
+    int8_t unregisterChain(SPIBusChain*);
+
     static const char* digitStateToString(DigitState);
     static const char* getDigitPortString(DigitPort);
 
@@ -648,16 +831,79 @@ class CPLDDriver : public EventReceiver,
 
     const CPLDPins _pins;
 
-    /* List of pending callbacks for bus transactions. */
-    PriorityQueue<SPIBusOp*> callback_queue;
+    /*
+    * Hand-off rings for bus transactions. Each has one producer and one consumer.
+    *   _lanes[]:       queue_io_job() -> advance_work_queue()
+    *   _callback_ring: advance_work_queue() -> service_callback_queue()
+    * These replace the adapter's work_queue, and the old PriorityQueue of
+    *   callbacks, neither of which is safe to touch under an ISR.
+    */
+    BusLaneState _lanes[CPLD_SPI_LANE_COUNT];
+    SPSCRing<CallbackEntry, CPLD_SPI_CB_RING_DEPTH> _callback_ring;
+    BusProfiler _profiler;
+    uint32_t  _job_queued_us     = 0;  // When current_job was queued.
+    uint32_t  _job_began_us      = 0;  // When current_job was begun.
+    uint32_t  _cb_xfer_done_us   = 0;  // When the op being called back finished its transfer.
+
+    /* Ops that belong in the real-time lane, and their deadlines. */
+    struct {
+      SPIBusOp* op;
+      uint32_t  deadline_us;
+    } _rt_ops[CPLD_SPI_MAX_RT_OPS];
+    uint8_t   _rt_burst          = 0;  // Real-time ops started in a row.
     uint32_t  _ext_clk_freq      = 0;  // In Hz.
     uint32_t  bus_timeout_millis = 5;  // How long to spend in IO_WAIT?
     uint8_t   spi_cb_per_event   = 3;  // Limit the number of callbacks processed per event.
     uint16_t  _digit_flags       = 0;  // Digit sleep state tracking flags.
 
-    inline bool    _conf_bits_set(uint8_t x) {  return (x == (cpld_conf_value & x)); };
+    /* Clock governor. */
+    uint32_t  _gov_demand_ops    = 0;    // Declared bus ops per second.
+    uint32_t  _gov_demand_bytes  = 0;    // Declared buffer bytes per second.
+    uint32_t  _gov_window_start  = 0;    // When the utilization window opened.
+    uint32_t  _gov_busy_us       = 0;    // Bus time spent in the current window.
+    uint32_t  _gov_bytes         = 0;    // Buffer bytes moved in the current window.
+    uint32_t  _gov_bytes_per_sec = 0;    // Throughput over the last window.
+    uint32_t  _gov_retunes       = 0;    // Clock changes made by the governor.
+    uint16_t  _gov_util_permille = 0;    // Bus utilization over the last window.
+    uint8_t   _gov_headroom      = CPLD_CLK_GOV_HEADROOM;
+    bool      _gov_enabled       = true;
+
+    /* IRQ edge service. */
+    struct {
+      uint64_t w0;
+      uint16_t w1;
+    } _irq_seen = {0, 0};                // The IRQ lines, as of the last edge serviced.
+    uint32_t  _irq_lat_count     = 0;    // Edges serviced from the ring.
+    uint64_t  _irq_lat_total_us  = 0;    // Sum of their arrival-to-service times.
+    uint32_t  _irq_lat_max_us    = 0;    // Worst arrival-to-service time.
+    uint32_t  _irq_edges_lost    = 0;    // Edges that overflowed the ring.
+    uint16_t  _irq_batch_max     = 0;    // Most edges serviced in one event.
+
+    /*
+    * Write-combining shadows of the writable CPLD registers. Setters only
+    *   change _shadow[], and a single flush per kernel pass writes whichever
+    *   registers differ from what the CPLD holds, or is about to. A register
+    *   only counts as holding a value once the CPLD has acknowledged it.
+    */
+    ManuvrMsg _shadow_flush;
+    uint8_t   _shadow[CPLD_SHADOW_COUNT];         // What each register ought to hold.
+    uint8_t   _shadow_sent[CPLD_SHADOW_COUNT];    // What each register was acknowledged to hold.
+    uint8_t   _shadow_flight[CPLD_SHADOW_COUNT];  // The last value written, if not yet acknowledged.
+    uint8_t   _shadow_retries[CPLD_SHADOW_COUNT];  // Failed writes of each register since the last success.
+    uint8_t   _shadow_inflight   = 0;      // Registers with a write on the bus.
+    uint8_t   _shadow_dirty      = 0;      // Shadows changed since the last flush.
+    bool      _shadow_pending    = false;  // Is _shadow_flush in the kernel's queue?
+    uint32_t  _shadow_writes     = 0;      // Bus writes issued by flushes.
+    uint32_t  _shadow_saved      = 0;      // Bus writes that were combined or dropped.
+    uint32_t  _shadow_failed     = 0;      // Registers given up on after CPLD_SHADOW_RETRIES.
+
+    inline bool    _conf_bits_set(uint8_t x) {  return (x == (_shadow[CPLD_SHADOW_CONF] & x)); };
 
     void _digit_irq_force(uint8_t digit, bool state);
+    void _shadow_put(uint8_t idx, uint8_t val);
+    void _shadow_commit();
+    void _shadow_sync();
+    void _shadow_done(uint8_t reg_addr, uint8_t val, bool ok);
 
     void _deinit();
     int8_t readRegister(uint8_t reg_addr);
@@ -667,6 +913,13 @@ class CPLDDriver : public EventReceiver,
     void purge_queued_work_by_dev(BusOpCallback *dev);   // Flush the work queue by callback match
     void purge_stalled_job();     // TODO: Misnomer. Really purges the active job.
     int8_t service_callback_queue();
+    bool _callback_enqueue(SPIBusOp*, bool profiled = false);
+    void _callback_reject(SPIBusOp*, XferFault);
+    bool _lane_take(SPIBusOp**);
+    void _lane_reset_stats();
+    inline bool _lanes_empty() {
+      return (_lanes[0].ring.isEmpty() && _lanes[1].ring.isEmpty());
+    };
     void reclaim_queue_item(SPIBusOp*);
 
     /* Setup and init fxns. */
@@ -681,9 +934,12 @@ class CPLDDriver : public EventReceiver,
     void externalOscillator(bool on);    // Enable or disable the CPLD external oscillator.
     void internalOscillator(bool on);    // Enable or disable the CPLD internal oscillator.
     void setCPLDConfig(uint8_t mask, bool enable);
+    int8_t _clk_retune();
+    void   _clk_account(uint32_t busy_us, uint32_t bytes, uint32_t now);
 
     /* Used to manage the IRQ aggregator. */
     int8_t iiu_group_irq();
+    void _irq_edge(uint8_t bit, uint8_t level, uint32_t t_us);
     void measure_irq_latency();
 
     inline void setIRQ74(bool x) {  setCPLDConfig(CPLD_CONF_BIT_IRQ_74, x);       };
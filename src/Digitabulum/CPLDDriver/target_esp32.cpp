@@ -164,6 +164,9 @@ static void IRAM_ATTR spi2_isr(void *arg) {
   if (SPI2.slave.trans_done) {
     SPIBusOp* tmp = _threaded_op;  // Concurrency "safety".
     if (tmp) {
+      // Release the bus before completing, since a chained op will take it
+      //   back immediately to run its next segment.
+      _threaded_op = nullptr;
       spi2_op_counter_0++;
 
       if (2 == tmp->transferParamLength()) {
@@ -192,13 +195,13 @@ static void IRAM_ATTR spi2_isr(void *arg) {
         }
 
         if (enough_bits) {
-          tmp->markComplete();
+          // begin() re-links the DMA descriptors for the next segment.
+          if (!_chain_continue(tmp)) tmp->markComplete();
         }
         else {
           tmp->abort(XferFault::DEV_FAULT);
         }
       }
-      _threaded_op = nullptr;
     }
     SPI2.slave.trans_done  = 0;  // Clear interrupt.
   }
@@ -257,10 +260,8 @@ static void IRAM_ATTR spi3_isr(void *arg) {
 
       for (int i = 0; i < 10; i++) {
         *(_irq_data_ptr + i) = *(hw_buf + i);
-        _irq_diff[i]   = prior_buf[i] ^ _irq_data_ptr[i];
-        _irq_accum[i] |= _irq_diff[i];
       }
-      Kernel::isrRaiseEvent(&_irq_data_arrival);   // TODO: Audit for mem layout.
+      if (irq_frame_ingest(prior_buf)) Kernel::isrRaiseEvent(&_irq_data_arrival);
     }
     SPI3.slave.trans_done  = 0;  // Clear interrupt.
     SPI3.cmd.usr = 1;  // Start the transfer afresh.
@@ -25,23 +25,710 @@ This file contains functions for running firmware under linux. This should only
   should make a board-specific file that mirrors this one, rather than torturing
   the pre-processor in this file.
 
+Since there is no CPLD attached to a dev box, this file simulates one, along
+  with the 17 LSM9DS1 packages behind it. The simulation is meant to be faithful
+  to the bus contract described in CPLDDriver.h, so that the real frame path
+  (ManuManager and Integrator) can be exercised and profiled without hardware:
+  * Transfers on SPI1 are decoded as DEV_ADDR/XFER_LEN/DEV_COUNT/REG_ADDR, or as
+    two-byte internal register accesses.
+  * Each IMU has a register file for each aspect, output data generated at the
+    configured ODR, and a 32-slot FIFO for the inertial aspect.
+  * Ranked addresses fan writes out to every IMU in the rank.
+  * The 80-bit IRQ stream is assembled from the modeled interrupt pins and is
+    delivered via the same double-buffer/diff/accumulate procedure as the
+    hardware ISRs.
+  * Bus time is charged from the CPLD clock (_ext_clk_freq, or the internal
+    oscillator), so a transfer doesn't complete until the CPLD would have
+    finished clocking it.
+
+A thread stands in for the interrupt controller. It advances the sensor models,
+  completes transfers whose bus time has elapsed, and sends IRQ frames.
+
 TODO: Until something smarter is done, it is assumed that this file will be
   #include'd by pre-processor choice in CPLDDriver.cpp.
 */
 
+#include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+#include <math.h>
+
+// The default frequency for the external clock, if it isn't otherwise supplied.
+#define DEFAULT_CPLD_FREQ   20000000
+
+/* Parameters of the simulation. */
+#define CPLD_SIM_VERSION          0x20     // What the simulated part reports as its version.
+#define CPLD_SIM_INT_OSC_BUS_HZ   2800000  // SPI clock when the CPLD runs from its own oscillator.
+#define CPLD_SIM_TICK_US          100      // Period of the simulation thread.
+#define CPLD_SIM_FIFO_DEPTH       32       // Depth of the LSM9DS1 inertial FIFO.
+
+
+/*******************************************************************************
+* .-. .----..----.    .-.     .--.  .-. .-..----.
+* | |{ {__  | {}  }   | |    / {} \ |  `| || {}  \
+* | |.-._} }| .-. \   | `--./  /\  \| |\  ||     /
+* `-'`----' `-' `-'   `----'`-'  `-'`-' `-'`----'
+*
+* Interrupt service routine support functions. Everything in this block
+*   executes under the simulation thread, which stands in for an ISR.
+*******************************************************************************/
+
+/* Register files for the modeled LSM9DS1s. Indexed by IMU, then by address. */
+static uint8_t  _sim_ag_regs[LEGEND_DATASET_IIU_COUNT][0x80];
+static uint8_t  _sim_m_regs[LEGEND_DATASET_IIU_COUNT][0x40];
+
+/* Inertial FIFOs. Each slot holds G(x, y, z) then A(x, y, z). */
+static int16_t  _sim_fifo[LEGEND_DATASET_IIU_COUNT][CPLD_SIM_FIFO_DEPTH][6];
+static uint8_t  _sim_fifo_head[LEGEND_DATASET_IIU_COUNT];
+static uint8_t  _sim_fifo_lvl[LEGEND_DATASET_IIU_COUNT];
+
+static uint32_t _sim_next_ag[LEGEND_DATASET_IIU_COUNT];     // When the next A/G sample lands.
+static uint32_t _sim_next_m[LEGEND_DATASET_IIU_COUNT];      // When the next M sample lands.
+static uint32_t _sim_samples_ag[LEGEND_DATASET_IIU_COUNT];  // Samples generated.
+static uint32_t _sim_samples_m[LEGEND_DATASET_IIU_COUNT];   // Samples generated.
+
+/* The CPLD's internal registers, as the simulated part sees them. */
+static uint8_t  _sim_conf         = 0;
+static uint8_t  _sim_forsaken     = 0;
+static uint8_t  _sim_wakeup       = 0;
+static uint8_t  _sim_digits       = 0x3F;  // Connected digits. Bit 0 is MC.
+static uint32_t _sim_ext_clk_hz   = 0;     // Zero if the external clock is stopped.
+static uint8_t  _sim_irq_frame[10];        // The last IRQ frame sent on SPI2.
+static uint32_t _sim_irq_ready    = 0;     // SPI2 is busy clocking a frame until this time.
+
+/* The transfer on SPI1, and the time at which the CPLD will finish it. */
+static SPIBusOp* volatile _sim_op = nullptr;
+static uint32_t _sim_op_done      = 0;
+
+/* Accounting. */
+static uint32_t _sim_epoch        = 0;   // When the simulation started.
+static uint32_t _sim_xfers        = 0;   // Transfers on SPI1.
+static uint32_t _sim_xfer_bytes   = 0;   // Bytes clocked on SPI1.
+static uint64_t _sim_bus_us       = 0;   // Time spent clocking SPI1.
+static uint32_t _sim_irq_frames   = 0;   // Frames clocked on SPI2.
+static uint32_t _sim_lcg          = 0x2F6B4A11;
+
+static pthread_t       _sim_thread;
+static pthread_mutex_t _sim_mutex   = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool   _sim_running = false;
+
+/* LSM9DS1 sensitivities, indexed by the register field that selects them. */
+static const float _sim_sens_acc[4] = {0.061f, 0.732f, 0.122f, 0.244f};  // mg/LSB
+static const float _sim_sens_gyr[4] = {8.75f,  17.5f,  17.5f,  70.0f};   // mdps/LSB
+static const float _sim_sens_mag[4] = {0.14f,  0.29f,  0.43f,  0.58f};   // mgauss/LSB
+
+/* LSM9DS1 sample periods (us), indexed by the register field that selects them. */
+static const uint32_t _sim_period_ag[8] = {0, 67114, 16807, 8403, 4202, 2101, 1050, 0};
+static const uint32_t _sim_period_m[8]  = {1600000, 800000, 400000, 200000, 100000, 50000, 25000, 12500};
+
+
+/*
+* Small noise source for sensor data. Deterministic, so that runs are
+*   comparable with one another.
+*/
+static inline int16_t _sim_noise() {
+  _sim_lcg = (_sim_lcg * 1103515245) + 12345;
+  return (int16_t) ((_sim_lcg >> 16) & 0x07) - 3;
+}
+
+static inline void _sim_put16(uint8_t* reg, int16_t val) {
+  *(reg + 0) = (uint8_t) (val & 0xFF);
+  *(reg + 1) = (uint8_t) ((val >> 8) & 0xFF);
+}
+
+static inline int16_t _sim_lsb(float val, float sens) {
+  float lsb = (val * 1000.0f) / sens;
+  if (lsb > 32767.0f)  return 32767;
+  if (lsb < -32768.0f) return -32768;
+  return (int16_t) lsb;
+}
+
+/*
+* Sensor position within its digit. 0 is proximal, 1 is intermediate, 2 is
+*   distal. This is what decides rank membership.
+*/
+static inline uint8_t _sim_imu_position(uint8_t idx) {
+  return (idx < 2) ? (idx << 1) : ((idx - 2) % 3);
+}
+
+/*
+* The MC proximal IMU is on the PCB with the CPLD. Every other IMU is only
+*   reachable if its digit is connected.
+*/
+static inline uint8_t _sim_imu_port(uint8_t idx) {
+  return (idx < 2) ? 0 : (((idx - 2) / 3) + 1);
+}
+
+static inline bool _sim_imu_reachable(uint8_t idx) {
+  return ((0 == idx) || (_sim_digits & (1 << _sim_imu_port(idx))));
+}
+
+static inline bool _sim_imu_forsaken(uint8_t idx) {
+  const uint8_t port = _sim_imu_port(idx);
+  return (port && (_sim_forsaken & (1 << (port - 1))));
+}
+
+static inline bool _sim_ag_data_reg(uint8_t addr) {
+  return (((addr >= 0x18) && (addr <= 0x1D)) || ((addr >= 0x28) && (addr <= 0x2D)));
+}
+
+static inline bool _sim_fifo_enabled(uint8_t idx) {
+  return ((_sim_ag_regs[idx][0x23] & 0x02) && (_sim_ag_regs[idx][0x2E] & 0xE0));
+}
+
+
+/*
+* Puts the given IMU's registers into their power-on state.
+* Values match those in RegPtrMap.
+*/
+static void _sim_ag_defaults(uint8_t idx) {
+  memset(_sim_ag_regs[idx], 0, sizeof(_sim_ag_regs[idx]));
+  _sim_ag_regs[idx][0x0F] = 0x68;  // WHO_AM_I
+  _sim_ag_regs[idx][0x1E] = 0x38;  // CTRL_REG4
+  _sim_ag_regs[idx][0x1F] = 0x38;  // CTRL_REG5_XL
+  _sim_ag_regs[idx][0x22] = 0x04;  // CTRL_REG8: Address auto-increment.
+  _sim_fifo_head[idx] = 0;
+  _sim_fifo_lvl[idx]  = 0;
+}
+
+static void _sim_m_defaults(uint8_t idx) {
+  memset(_sim_m_regs[idx], 0, sizeof(_sim_m_regs[idx]));
+  _sim_m_regs[idx][0x0F] = 0x3D;  // WHO_AM_I
+  _sim_m_regs[idx][0x20] = 0x40;  // CTRL_REG1_M
+  _sim_m_regs[idx][0x22] = 0x03;  // CTRL_REG3_M: Powered down.
+  _sim_m_regs[idx][0x30] = 0x08;  // INT_CFG_M
+}
+
+
+/*
+* Refreshes FIFO_SRC from the state of the given FIFO.
+*/
+static void _sim_fifo_status(uint8_t idx, bool overrun) {
+  const uint8_t fth = _sim_ag_regs[idx][0x2E] & 0x1F;
+  uint8_t src = _sim_fifo_lvl[idx] & 0x3F;
+  if (overrun) src |= 0x40;
+  if (fth && (_sim_fifo_lvl[idx] >= fth)) src |= 0x80;
+  _sim_ag_regs[idx][0x2F] = src;
+}
+
+/*
+* Moves the oldest FIFO slot into the output registers.
+*/
+static void _sim_fifo_load(uint8_t idx) {
+  if (_sim_fifo_lvl[idx]) {
+    const int16_t* slot = _sim_fifo[idx][_sim_fifo_head[idx]];
+    for (int i = 0; i < 3; i++) {
+      _sim_put16(&_sim_ag_regs[idx][0x18 + (i << 1)], slot[i]);
+      _sim_put16(&_sim_ag_regs[idx][0x28 + (i << 1)], slot[i + 3]);
+    }
+  }
+}
+
+static void _sim_fifo_pop(uint8_t idx) {
+  if (_sim_fifo_lvl[idx]) {
+    _sim_fifo_head[idx] = (_sim_fifo_head[idx] + 1) % CPLD_SIM_FIFO_DEPTH;
+    _sim_fifo_lvl[idx]--;
+    _sim_fifo_load(idx);
+    _sim_fifo_status(idx, false);
+  }
+}
+
+
+/*
+* Generates an inertial sample. Every IMU rotates about its own X-axis at a
+*   slightly different rate, so that gravity sweeps across Y and Z, and the
+*   gyro reports the rate of the rotation.
+*/
+static void _sim_ag_sample(uint8_t idx, uint32_t t) {
+  uint8_t* regs = _sim_ag_regs[idx];
+  const bool  gyr_on = (0 != (regs[0x10] & 0xE0));
+  const float rate   = 0.5f + (0.05f * idx);           // rad/s
+  const float theta  = rate * (t / 1000000.0f);
+  const float s_a    = _sim_sens_acc[(regs[0x20] >> 3) & 0x03];
+  const float s_g    = _sim_sens_gyr[(regs[0x10] >> 3) & 0x03];
+  int16_t sample[6];
+
+  sample[0] = gyr_on ? _sim_lsb(rate * 57.29578f, s_g) + _sim_noise() : 0;
+  sample[1] = gyr_on ? _sim_noise() : 0;
+  sample[2] = gyr_on ? _sim_noise() : 0;
+  sample[3] = _sim_noise();
+  sample[4] = _sim_lsb(sinf(theta), s_a) + _sim_noise();
+  sample[5] = _sim_lsb(cosf(theta), s_a) + _sim_noise();
+
+  if (_sim_fifo_enabled(idx)) {
+    bool overrun = false;
+    if (CPLD_SIM_FIFO_DEPTH == _sim_fifo_lvl[idx]) {
+      if (0x20 == (regs[0x2E] & 0xE0)) {
+        // FIFO mode stops collecting when full.
+        _sim_fifo_status(idx, true);
+        return;
+      }
+      // Continuous mode discards the oldest sample.
+      _sim_fifo_head[idx] = (_sim_fifo_head[idx] + 1) % CPLD_SIM_FIFO_DEPTH;
+      _sim_fifo_lvl[idx]--;
+      overrun = true;
+    }
+    const uint8_t tail = (_sim_fifo_head[idx] + _sim_fifo_lvl[idx]) % CPLD_SIM_FIFO_DEPTH;
+    memcpy(_sim_fifo[idx][tail], sample, sizeof(sample));
+    _sim_fifo_lvl[idx]++;
+    if (1 == _sim_fifo_lvl[idx]) _sim_fifo_load(idx);
+    _sim_fifo_status(idx, overrun);
+  }
+  else {
+    for (int i = 0; i < 3; i++) {
+      _sim_put16(&regs[0x18 + (i << 1)], sample[i]);
+      _sim_put16(&regs[0x28 + (i << 1)], sample[i + 3]);
+    }
+  }
+  _sim_put16(&regs[0x15], 32);  // 27C. The part reports 16 LSB/C, offset from 25C.
+  regs[0x17] |= (gyr_on ? 0x07 : 0x05);  // TDA, GDA, XLDA
+  regs[0x27]  = regs[0x17];
+  _sim_samples_ag[idx]++;
+}
+
+/*
+* Generates a magnetometer sample. The field is rotated by the same motion as
+*   the inertial data.
+*/
+static void _sim_m_sample(uint8_t idx, uint32_t t) {
+  uint8_t* regs = _sim_m_regs[idx];
+  const float theta = (0.5f + (0.05f * idx)) * (t / 1000000.0f);
+  const float s_m   = _sim_sens_mag[(regs[0x21] >> 5) & 0x03];
+  const float c     = cosf(theta);
+  const float s     = sinf(theta);
+  _sim_put16(&regs[0x28], _sim_lsb(0.25f, s_m) + _sim_noise());
+  _sim_put16(&regs[0x2A], _sim_lsb((0.0f * c) + (0.4f * s), s_m) + _sim_noise());
+  _sim_put16(&regs[0x2C], _sim_lsb((0.4f * c) - (0.0f * s), s_m) + _sim_noise());
+  regs[0x27] = (regs[0x27] & 0x08) ? 0x88 : 0x08;  // ZYXOR if unread, ZYXDA
+  _sim_samples_m[idx]++;
+}
+
+
+/*
+* Brings every reachable IMU up to the given time.
+*/
+static void _sim_advance(uint32_t now) {
+  for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) {
+    if (!_sim_imu_reachable(idx)) continue;
+    uint8_t* ag = _sim_ag_regs[idx];
+    uint8_t  odr = (ag[0x10] >> 5) & 0x07;
+    if (0 == odr) odr = (ag[0x20] >> 5) & 0x07;   // Accelerometer-only mode.
+    const uint32_t period_ag = _sim_period_ag[odr];
+    if (period_ag) {
+      uint8_t n = 0;
+      while ((int32_t) (now - _sim_next_ag[idx]) >= 0) {
+        if (++n > CPLD_SIM_FIFO_DEPTH) {
+          // We fell far behind. Anything older than this is gone anyhow.
+          _sim_next_ag[idx] = now;
+        }
+        _sim_ag_sample(idx, _sim_next_ag[idx]);
+        _sim_next_ag[idx] += period_ag;
+      }
+    }
+    else {
+      _sim_next_ag[idx] = now;
+    }
+
+    uint8_t* m = _sim_m_regs[idx];
+    switch (m[0x22] & 0x03) {
+      case 0:   // Continuous conversion.
+        {
+          const uint32_t period_m = _sim_period_m[(m[0x20] >> 2) & 0x07];
+          uint8_t n = 0;
+          while ((int32_t) (now - _sim_next_m[idx]) >= 0) {
+            if (++n > 2) _sim_next_m[idx] = now;
+            _sim_m_sample(idx, _sim_next_m[idx]);
+            _sim_next_m[idx] += period_m;
+          }
+        }
+        break;
+      case 1:   // Single conversion, then power-down.
+        _sim_m_sample(idx, now);
+        m[0x22] |= 0x03;
+        // No break on purpose.
+      default:
+        _sim_next_m[idx] = now;
+        break;
+    }
+  }
+}
+
+
+/*
+* Register writes, with the side-effects that the simulation cares about.
+*/
+static void _sim_ag_write(uint8_t idx, uint8_t addr, uint8_t val) {
+  uint8_t* regs = _sim_ag_regs[idx];
+  switch (addr) {
+    case 0x0F:  case 0x14:  case 0x15:  case 0x16:  case 0x17:
+    case 0x26:  case 0x27:  case 0x2F:
+      return;   // Read-only.
+    case 0x22:  // CTRL_REG8
+      if (val & 0x01) {
+        _sim_ag_defaults(idx);   // SW_RESET
+        return;
+      }
+      break;
+    case 0x2E:  // FIFO_CTRL
+      if (0 == (val & 0xE0)) {
+        // Bypass mode empties the FIFO.
+        _sim_fifo_head[idx] = 0;
+        _sim_fifo_lvl[idx]  = 0;
+      }
+      regs[addr] = val;
+      _sim_fifo_status(idx, false);
+      return;
+    default:
+      if (_sim_ag_data_reg(addr)) return;   // Read-only.
+      break;
+  }
+  regs[addr] = val;
+}
+
+static void _sim_m_write(uint8_t idx, uint8_t addr, uint8_t val) {
+  switch (addr) {
+    case 0x0F:  case 0x27:  case 0x28:  case 0x29:  case 0x2A:
+    case 0x2B:  case 0x2C:  case 0x2D:  case 0x31:
+      return;   // Read-only.
+    case 0x21:  // CTRL_REG2_M
+      if (val & 0x04) {
+        _sim_m_defaults(idx);   // SOFT_RST
+        return;
+      }
+      break;
+    default:
+      break;
+  }
+  _sim_m_regs[idx][addr] = val;
+}
+
+
+/*
+* Conducts the IMU's side of a transfer once the CPLD has connected it.
+* REG_ADDR is interpreted exactly as the IMU would: MSB is R/~W, and the
+*   magnetometer takes bit 6 as the auto-increment flag, while the inertial
+*   aspect auto-increments per CTRL_REG8.
+* The inertial output registers roll over between the gyro and accelerometer
+*   blocks, as the part does when FIFO reads are enabled. When the FIFO is
+*   enabled, each 12 bytes read from that block pops one slot.
+*
+* @param  dev   The CPLD address of the IMU aspect.
+* @param  reg   The REG_ADDR byte.
+* @param  buf   The slice of the transfer buffer for this device.
+* @param  len   XFER_LEN
+*/
+static void _sim_imu_access(uint8_t dev, uint8_t reg, uint8_t* buf, uint8_t len) {
+  const bool    mag  = (dev >= CPLD_REG_IMU_DM_P_M);
+  const uint8_t idx  = mag ? (dev - CPLD_REG_IMU_DM_P_M) : dev;
+  const bool    read = (reg & 0x80);
+
+  if (!_sim_imu_reachable(idx) || ((_sim_conf & CPLD_CONF_BIT_PWR_CONSRV) && _sim_imu_forsaken(idx))) {
+    // Nothing drives MISO.
+    if (read) memset(buf, 0, len);
+    return;
+  }
+
+  if (mag) {
+    uint8_t* regs = _sim_m_regs[idx];
+    uint8_t  addr = reg & 0x3F;
+    for (uint8_t n = 0; n < len; n++) {
+      if (read) {
+        *(buf + n) = regs[addr];
+        if (0x2D == addr) regs[0x27] = 0x00;   // Data was consumed.
+      }
+      else {
+        _sim_m_write(idx, addr, *(buf + n));
+      }
+      if (reg & 0x40) addr = (addr + 1) & 0x3F;
+    }
+  }
+  else {
+    uint8_t* regs   = _sim_ag_regs[idx];
+    uint8_t  addr   = reg & 0x7F;
+    uint8_t  popped = 0;
+    const bool inc  = (regs[0x22] & 0x04);
+    for (uint8_t n = 0; n < len; n++) {
+      if (read) {
+        *(buf + n) = regs[addr];
+        switch (addr) {
+          case 0x16:  regs[0x17] &= ~0x04;  break;   // TDA
+          case 0x1D:  regs[0x17] &= ~0x02;  break;   // GDA
+          case 0x2D:  regs[0x17] &= ~0x01;  break;   // XLDA
+          default:    break;
+        }
+        regs[0x27] = regs[0x17];
+        if (_sim_ag_data_reg(addr) && (12 == ++popped)) {
+          popped = 0;
+          if (_sim_fifo_enabled(idx)) _sim_fifo_pop(idx);
+        }
+      }
+      else {
+        _sim_ag_write(idx, addr, *(buf + n));
+        if (0 == (regs[0x22] & 0x04)) break;   // SW_RESET happened under us.
+      }
+      if (inc) {
+        switch (addr) {
+          case 0x1D:  addr = 0x28;  break;
+          case 0x2D:  addr = 0x18;  break;
+          default:    addr = (addr + 1) & 0x7F;  break;
+        }
+      }
+    }
+  }
+}
+
+
+/*
+* The CPLD's half of a transfer on SPI1. Moves the data in one go. The caller
+*   is responsible for charging the bus time.
+*
+* @param  op          The transfer.
+* @param  wire_bytes  Will be set to the number of bytes clocked on the bus.
+* @return XferFault::NONE if the CPLD would accept the transfer.
+*/
+static XferFault _sim_cpld_transfer(SPIBusOp* op, uint32_t* wire_bytes) {
+  const uint8_t p0 = op->getTransferParam(0);
+  const uint8_t p1 = op->getTransferParam(1);
+
+  if (2 == op->transferParamLength()) {
+    // Internal register access. The version and config registers come back
+    //   in the two bytes following the address, regardless of direction.
+    uint8_t version = CPLD_SIM_VERSION;
+    switch (p0) {
+      case CPLD_REG_VERSION:
+        break;
+      case CPLD_REG_CONFIG:
+        _sim_conf = p1;
+        break;
+      case CPLD_REG_WAKEUP_IRQ:
+        _sim_wakeup = p1;
+        break;
+      case CPLD_REG_DIGIT_FORSAKE:
+        _sim_forsaken = p1 & 0x1F;
+        break;
+      default:
+        version = 0xFF;   // The CPLD won't answer a bad address.
+        break;
+    }
+    *(op->buf + 0) = version;
+    *(op->buf + 1) = _sim_conf;
+    *wire_bytes = 2;
+    return XferFault::NONE;
+  }
+
+  const uint8_t  dev      = p0 & 0x7F;
+  const uint8_t  count    = op->getTransferParam(2);
+  const uint8_t  reg      = op->getTransferParam(3);
+  const uint32_t total    = (uint32_t) p1 * count;
+
+  if ((0 == total) || (nullptr == op->buf) || (op->buf_len < total)) {
+    return XferFault::BAD_PARAM;
+  }
+
+  if (dev < CPLD_REG_RANK_P_M) {
+    // Individual access, traversing successive devices.
+    if ((dev + count) > CPLD_REG_RANK_P_M) return XferFault::DEV_FAULT;
+    for (uint8_t i = 0; i < count; i++) {
+      _sim_imu_access(dev + i, reg, op->buf + (i * p1), p1);
+    }
+  }
+  else if (dev <= CPLD_REG_RANK_D_I) {
+    // Ranked access is write-only, and each rank is a single device.
+    if ((reg & 0x80) || ((dev + count) > (CPLD_REG_RANK_D_I + 1))) return XferFault::DEV_FAULT;
+    for (uint8_t i = 0; i < count; i++) {
+      const uint8_t rank = (dev + i) - CPLD_REG_RANK_P_M;
+      const uint8_t base = (rank < 3) ? CPLD_REG_IMU_DM_P_M : CPLD_REG_IMU_DM_P_I;
+      for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) {
+        if ((rank % 3) == _sim_imu_position(idx)) {
+          _sim_imu_access(base + idx, reg, op->buf + (i * p1), p1);
+        }
+      }
+    }
+  }
+  else {
+    return XferFault::DEV_FAULT;
+  }
+
+  *wire_bytes = 4 + ((_sim_conf & CPLD_CONF_BIT_ALIGN_XFER) ? ((total + 3) & ~3) : total);
+  return XferFault::NONE;
+}
+
+
+/*
+* @return The SPI clock, as the CPLD would generate it. Zero means DC.
+*/
+static uint32_t _sim_bus_hz() {
+  if (_sim_conf & CPLD_CONF_BIT_INT_CLK) return CPLD_SIM_INT_OSC_BUS_HZ;
+  return (_sim_ext_clk_hz >> 1);  // The CPLD divides its clock once.
+}
+
+static inline uint32_t _sim_bus_time(uint32_t bytes) {
+  const uint32_t hz = _sim_bus_hz();
+  if (0 == hz) return 0xFFFFFFFF;   // Clock at DC. Transfer never ends.
+  const uint32_t us = (uint32_t) (((uint64_t) bytes * 8000000) / hz);
+  return (us) ? us : 1;
+}
+
+
+/*
+* Assembles the IRQ frame as the CPLD would. Bit 0 is the MSB of byte 0.
+*
+* @return true if the frame should be sent.
+*/
+static bool _sim_build_irq_frame(uint8_t* frame) {
+  memset(frame, 0, 10);
+  for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) {
+    if (!_sim_imu_reachable(idx)) continue;
+    if (_sim_imu_forsaken(idx)) continue;
+    const uint8_t port = _sim_imu_port(idx);
+
+    const uint8_t* ag = _sim_ag_regs[idx];
+    const uint8_t* m  = _sim_m_regs[idx];
+    const uint8_t  status = ag[0x17];
+    const uint8_t  fifo   = ag[0x2F];
+    uint8_t nib = 0;
+    if ((m[0x27] & 0x08) && (0x03 != (m[0x22] & 0x03))) nib |= 0x01;   // DRDY_M
+    if ((ag[0x0C] & 0x01) && (status & 0x01)) nib |= 0x04;   // INT1: XLDA
+    if ((ag[0x0C] & 0x02) && (status & 0x02)) nib |= 0x04;   // INT1: GDA
+    if ((ag[0x0C] & 0x08) && (fifo & 0x80))   nib |= 0x04;   // INT1: FTH
+    if ((ag[0x0C] & 0x10) && (fifo & 0x40))   nib |= 0x04;   // INT1: OVR
+    if ((ag[0x0C] & 0x20) && (fifo & 0x20))   nib |= 0x04;   // INT1: FSS5
+    if ((ag[0x0D] & 0x01) && (status & 0x01)) nib |= 0x08;   // INT2: XLDA
+    if ((ag[0x0D] & 0x02) && (status & 0x02)) nib |= 0x08;   // INT2: GDA
+    if ((ag[0x0D] & 0x04) && (status & 0x04)) nib |= 0x08;   // INT2: TDA
+    if ((ag[0x0D] & 0x08) && (fifo & 0x80))   nib |= 0x08;   // INT2: FTH
+    if ((ag[0x0D] & 0x10) && (fifo & 0x40))   nib |= 0x08;   // INT2: OVR
+    if ((ag[0x0D] & 0x20) && (fifo & 0x20))   nib |= 0x08;   // INT2: FSS5
+
+    // MC occupies byte 0, proximal in the low nibble. Each digit is a 12-bit
+    //   slice with the distal sensor in the high nibble.
+    uint8_t first_bit;
+    if (idx < 2) {
+      first_bit = (idx) ? 0 : 4;
+    }
+    else {
+      first_bit = (8 + ((port - 1) * 12)) + ((2 - _sim_imu_position(idx)) << 2);
+    }
+    for (uint8_t b = 0; b < 4; b++) {
+      if (nib & (0x08 >> b)) {
+        const uint8_t bit = first_bit + b;
+        frame[bit >> 3] |= (0x80 >> (bit & 0x07));
+      }
+    }
+  }
+
+  for (uint8_t d = 0; d < 6; d++) {
+    if (_sim_digits & (1 << d)) {
+      const uint8_t bit = 68 + d;
+      frame[bit >> 3] |= (0x80 >> (bit & 0x07));
+    }
+  }
+  if (_sim_conf & CPLD_CONF_BIT_IRQ_74) frame[9] |= 0x20;
+  frame[9] |= 0x10;   // CPLD_OE
+  frame[9] |= CPLD_GUARD_BIT_VALUE;
+
+  if (_sim_conf & CPLD_CONF_BIT_IRQ_SCAN) return false;
+  return (0 != memcmp(frame, _sim_irq_frame, 10));
+}
+
+
+/*
+* The SPI2 ISR, as it would run on receipt of a frame.
+*/
+static void _sim_irq_deliver(const uint8_t* hw_buf) {
+  uint8_t* prior_buf;
+  if (CPLD_GUARD_BIT_VALUE == (*(hw_buf + 9) & 0x0F)) {
+    if (0 == _irq_latency_1) {
+      _irq_latency_1 = micros();
+    }
+    _irq_frames_rxd++;
+    if (_irq_data_ptr == _irq_data_0) {  // Double-buffer "Tock"
+      prior_buf     = (uint8_t*) _irq_data_0;
+      _irq_data_ptr = (uint8_t*) _irq_data_1;
+    }
+    else {  // Double-buffer "Tick"
+      prior_buf     = (uint8_t*) _irq_data_1;
+      _irq_data_ptr = (uint8_t*) _irq_data_0;
+    }
+    for (int i = 0; i < 10; i++) {
+      *(_irq_data_ptr + i) = *(hw_buf + i);
+    }
+    if (irq_frame_ingest(prior_buf)) Kernel::isrRaiseEvent(&_irq_data_arrival);
+  }
+}
+
+
+/*
+* Stands in for the interrupt controller.
+*/
+static void* _sim_thread_fxn(void*) {
+  uint8_t frame[10];
+  while (_sim_running) {
+    const uint32_t now = (uint32_t) micros();
+    SPIBusOp* done = nullptr;
+    bool send_frame = false;
+
+    pthread_mutex_lock(&_sim_mutex);
+    _sim_advance(now);
+    if (_sim_op) {
+      switch (_sim_op->get_state()) {
+        case XferState::TX_WAIT:
+        case XferState::RX_WAIT:
+          if ((int32_t) (now - _sim_op_done) >= 0) {
+            done    = _sim_op;
+            _sim_op = nullptr;
+          }
+          break;
+        default:
+          // The driver gave up on the transfer (timeout, purge).
+          _sim_op = nullptr;
+          break;
+      }
+    }
+    if ((int32_t) (now - _sim_irq_ready) >= 0) {
+      send_frame = _sim_build_irq_frame(frame);
+      if (send_frame) {
+        memcpy(_sim_irq_frame, frame, 10);
+        _sim_irq_frames++;
+        _sim_irq_ready = now + _sim_bus_time(10);
+      }
+    }
+    pthread_mutex_unlock(&_sim_mutex);
+
+    if (done) {
+      // A chained op starts its next segment here, as the hardware ISR would.
+      if (!_chain_continue(done)) done->markComplete();
+    }
+    if (send_frame) _sim_irq_deliver(frame);
+    usleep(CPLD_SIM_TICK_US);
+  }
+  return nullptr;
+}
+
 
 /**
 * Should undo all the effects of the init functions.
 */
 void CPLDDriver::_deinit() {
+  bus_deinit();
 }
 
 /**
 * Init the timer to provide the CPLD with an external clock. This clock is the
 *   most-flexible, and we use it by default.
+* The CPLD's external clock is limited to 20MHz.
 */
 bool CPLDDriver::_set_timer_base(int hz) {
-  return true;
+  if ((hz > 0) && (hz <= 20000000)) {
+    _ext_clk_freq = hz;
+    if (_er_flag(CPLD_FLAG_EXT_OSC)) {
+      pthread_mutex_lock(&_sim_mutex);
+      _sim_ext_clk_hz = _ext_clk_freq;
+      pthread_mutex_unlock(&_sim_mutex);
+    }
+    return true;
+  }
+  return false;
 }
 
 /**
@@ -49,6 +736,7 @@ bool CPLDDriver::_set_timer_base(int hz) {
 *   most-flexible, and we use it by default.
 */
 void CPLDDriver::init_ext_clk() {
+  _set_timer_base(DEFAULT_CPLD_FREQ);
 }
 
 /**
@@ -59,6 +747,7 @@ void CPLDDriver::init_ext_clk() {
 * @param  cpha  Clock phase
 */
 void CPLDDriver::init_spi(uint8_t cpol, uint8_t cpha) {
+  _er_set_flag(CPLD_FLAG_SPI1_READY);
 }
 
 
@@ -70,6 +759,7 @@ void CPLDDriver::init_spi(uint8_t cpol, uint8_t cpha) {
 * @param  cpha  Clock phase
 */
 void CPLDDriver::init_spi2(uint8_t cpol, uint8_t cpha) {
+  _er_set_flag(CPLD_FLAG_SPI2_READY);
 }
 
 
@@ -82,14 +772,24 @@ void CPLDDriver::init_spi2(uint8_t cpol, uint8_t cpha) {
 */
 void CPLDDriver::externalOscillator(bool on) {
   _er_set_flag(CPLD_FLAG_EXT_OSC, on);
-  if (on) {
-  }
-  else {
-  }
+  pthread_mutex_lock(&_sim_mutex);
+  _sim_ext_clk_hz = (on) ? _ext_clk_freq : 0;
+  pthread_mutex_unlock(&_sim_mutex);
 }
 
 
+/**
+* The CPLD is held in reset when this is called. So the simulated part's
+*   registers revert, and any transfer it was clocking is lost.
+*/
 void CPLDDriver::hw_flush() {
+  pthread_mutex_lock(&_sim_mutex);
+  _sim_op       = nullptr;
+  _sim_conf     = 0;
+  _sim_forsaken = 0;
+  _sim_wakeup   = 0;
+  memset(_sim_irq_frame, 0, sizeof(_sim_irq_frame));
+  pthread_mutex_unlock(&_sim_mutex);
 }
 
 
@@ -102,10 +802,42 @@ void CPLDDriver::hw_flush() {
 *******************************************************************************/
 
 int8_t CPLDDriver::bus_init() {
+  init_spi(1, 0);   // CPOL=1, CPHA=0, HW-driven
+  if (!_sim_running) {
+    const uint32_t now = (uint32_t) micros();
+    pthread_mutex_lock(&_sim_mutex);
+    for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) {
+      _sim_ag_defaults(idx);
+      _sim_m_defaults(idx);
+      _sim_next_ag[idx]    = now;
+      _sim_next_m[idx]     = now;
+      _sim_samples_ag[idx] = 0;
+      _sim_samples_m[idx]  = 0;
+    }
+    _sim_epoch      = now;
+    _sim_irq_ready  = now;
+    _sim_xfers      = 0;
+    _sim_xfer_bytes = 0;
+    _sim_bus_us     = 0;
+    _sim_irq_frames = 0;
+    pthread_mutex_unlock(&_sim_mutex);
+
+    _sim_running = true;
+    if (0 != pthread_create(&_sim_thread, nullptr, _sim_thread_fxn, nullptr)) {
+      _sim_running = false;
+      Kernel::log("CPLDDriver::bus_init(): Failed to start the CPLD simulation.\n");
+      return -1;
+    }
+  }
   return 0;
 }
 
 int8_t CPLDDriver::bus_deinit() {
+  if (_sim_running) {
+    _sim_running = false;
+    pthread_join(_sim_thread, nullptr);
+  }
+  _er_set_flag(CPLD_FLAG_SPI1_READY | CPLD_FLAG_SPI2_READY, false);
   return 0;
 }
 
@@ -116,6 +848,24 @@ int8_t CPLDDriver::bus_deinit() {
 * @param   StringBuilder* The buffer into which this fxn should write its output.
 */
 void CPLDDriver::printHardwareState(StringBuilder *output) {
+  pthread_mutex_lock(&_sim_mutex);
+  const uint32_t elapsed = wrap_accounted_delta(_sim_epoch, (uint32_t) micros());
+  output->concatf("\n-- CPLD simulation (%s) --------------------\n", (_sim_running ? "running" : "STOPPED"));
+  output->concatf("--\t Bus clock:    %u Hz\n", _sim_bus_hz());
+  output->concatf("--\t CONFIG:       0x%02x\n", _sim_conf);
+  output->concatf("--\t FORSAKEN:     0x%02x\n", _sim_forsaken);
+  output->concatf("--\t WAKEUP:       0x%02x\n", _sim_wakeup);
+  output->concatf("--\t Digits:       0x%02x\n", _sim_digits);
+  output->concatf("--\t Transfers:    %u (%u bytes)\n", _sim_xfers, _sim_xfer_bytes);
+  output->concatf("--\t Bus time:     %u us (%.2f%% utilized)\n", (uint32_t) _sim_bus_us, (elapsed ? (double) ((_sim_bus_us * 100.0) / elapsed) : 0.0));
+  output->concatf("--\t IRQ frames:   %u\n--\n", _sim_irq_frames);
+  output->concat("--\t IMU   A/G samples  FIFO   M samples\n");
+  for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) {
+    if (_sim_imu_reachable(idx)) {
+      output->concatf("--\t %2u    %10u    %2u  %10u\n", idx, _sim_samples_ag[idx], _sim_fifo_lvl[idx], _sim_samples_m[idx]);
+    }
+  }
+  pthread_mutex_unlock(&_sim_mutex);
 }
 
 
@@ -128,30 +878,55 @@ void CPLDDriver::printHardwareState(StringBuilder *output) {
 
 /**
 * Calling this member will cause the bus operation to be started.
+* The simulated CPLD moves the data immediately, but the operation will not
+*   complete until its bus time has elapsed.
 *
 * @return 0 on success, or non-zero on failure.
 */
 XferFault SPIBusOp::begin() {
   //time_began    = micros();
-  if (0 == _param_len) {
-    // Obvious invalidity. We must have at least one transfer parameter.
-    abort(XferFault::BAD_PARAM);
-    return XferFault::BAD_PARAM;
+  if (_sim_op) {
+    abort(XferFault::BUS_BUSY);
+    return XferFault::BUS_BUSY;
+  }
+
+  switch (_param_len) {  // Length dictates our transfer setup.
+    case 4:
+      break;
+    case 2:
+      if (0 == buf_len) {
+        // Internal register access. We can afford to read two bytes into the
+        //   same space as our xfer_params.
+        buf     = &xfer_params[2];  // Careful....
+        buf_len = 2;
+      }
+      break;
+    default:
+      abort(XferFault::BAD_PARAM);
+      return XferFault::BAD_PARAM;
   }
 
   set_state(XferState::INITIATE);  // Indicate that we now have bus control.
 
-  if ((opcode == BusOpcode::TX) || (2 < _param_len)) {
-    set_state((0 == buf_len) ? XferState::TX_WAIT : XferState::ADDR);
-    //__HAL_SPI_ENABLE_IT(&hspi1, (SPI_IT_TXE));
-    //HAL_SPI_TransmitReceive_IT(&hspi1, (uint8_t*) xfer_params, (uint8_t*) &STATIC_SINK, _param_len);
-  }
-  else {
-    set_state((0 == buf_len) ? XferState::RX_WAIT : XferState::ADDR);
-    // We can afford to read two bytes into the same space as our xfer_params...
-    //HAL_SPI_TransmitReceive_IT(&hspi1, (uint8_t*) xfer_params, (uint8_t*)(xfer_params + 2), 2);
+  uint32_t wire_bytes = 0;
+  pthread_mutex_lock(&_sim_mutex);
+  XferFault fault = _sim_cpld_transfer(this, &wire_bytes);
+  if (XferFault::NONE == fault) {
+    const uint32_t bus_us = _sim_bus_time(wire_bytes);
+    set_state(opcode == BusOpcode::TX ? XferState::TX_WAIT : XferState::RX_WAIT);
+    _sim_xfers++;
+    _sim_xfer_bytes += wire_bytes;
+    if (0xFFFFFFFF != bus_us) _sim_bus_us += bus_us;
+    _sim_op_done = (uint32_t) micros() + bus_us;
+    _sim_op      = this;
   }
+  pthread_mutex_unlock(&_sim_mutex);
 
+  if (XferFault::NONE != fault) {
+    abort(fault);
+    return fault;
+  }
+  _assert_cs(true);
   return XferFault::NONE;
 }
 
@@ -174,7 +949,7 @@ int8_t SPIBusOp::advance_operation(uint32_t status_reg, uint8_t data_reg) {
 
     case XferState::TX_WAIT:
     case XferState::RX_WAIT:
-      markComplete();
+      if (!_chain_continue(this)) markComplete();
       return 0;
 
     case XferState::FAULT:
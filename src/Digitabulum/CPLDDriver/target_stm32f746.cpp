@@ -94,14 +94,32 @@ void CPLDDriver::_deinit() {
 
 
 /**
-* Init the timer to provide the CPLD with an external clock. This clock is the
-*   most-flexible, and we use it by default.
+* Sets the frequency of the timer that provides the CPLD with an external
+*   clock. TIM1 toggles its output on each update, so the pin runs at half the
+*   update rate. Once the timer is running, only the reload value is changed,
+*   so the clock can be retuned without stopping it.
+* The CPLD's external clock is limited to 20MHz.
+*
+* @param  hz  The desired frequency, in Hz.
+* @return true on success.
 */
-bool CPLDDriver::_set_timer_base(uint16_t _period) {
+bool CPLDDriver::_set_timer_base(int hz) {
+  if ((hz <= 0) || (hz > CPLD_EXT_CLK_MAX_HZ)) return false;
+  const uint32_t tim_clk = 2 * HAL_RCC_GetPCLK2Freq();
+  // Round the divider up, so the clock is never faster than was asked.
+  uint32_t period = (tim_clk + (2 * (uint32_t) hz) - 1) / (2 * (uint32_t) hz);
+  if (period < 1)       period = 1;
+  if (period > 0x10000) period = 0x10000;
+  _ext_clk_freq = tim_clk / (2 * period);
+  period--;   // The timer counts from zero.
+  if (TIM1 == htim1.Instance) {
+    __HAL_TIM_SET_AUTORELOAD(&htim1, period);
+    return true;
+  }
   htim1.Instance               = TIM1;
   htim1.Init.Prescaler         = 0;
   htim1.Init.CounterMode       = TIM_COUNTERMODE_UP;
-  htim1.Init.Period            = _period;
+  htim1.Init.Period            = period;
   htim1.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
   htim1.Init.RepetitionCounter = 0;  // TODO: Move this to 8 to reduce power?
   return (HAL_OK == HAL_TIM_Base_Init(&htim1));
@@ -129,7 +147,7 @@ void CPLDDriver::init_ext_clk() {
   GPIO_InitStruct.Alternate  = GPIO_AF1_TIM1;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
-  _set_timer_base(0xFFF0);  // Make the clock real slow until we need it.
+  _set_timer_base(CPLD_EXT_CLK_MIN_HZ);  // Make the clock slow until the governor has demand.
 
   TIM_ClockConfigTypeDef sClockSourceConfig;
   sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
@@ -421,13 +439,7 @@ extern "C" {
           _spi2_dma.State = HAL_DMA_STATE_READY_MEM1;
         }
 
-        *(uint32_t*)(_irq_diff + 0) = *(uint32_t*)(previous_buf + 0) ^ *(uint32_t*)(_irq_data_ptr + 0);
-        *(uint32_t*)(_irq_diff + 4) = *(uint32_t*)(previous_buf + 4) ^ *(uint32_t*)(_irq_data_ptr + 4);
-        *(uint16_t*)(_irq_diff + 8) = *(uint16_t*)(previous_buf + 8) ^ *(uint16_t*)(_irq_data_ptr + 8);
-
-        *(uint32_t*)(_irq_accum + 0) |= *(uint32_t*)(_irq_diff + 0);
-        *(uint32_t*)(_irq_accum + 4) |= *(uint32_t*)(_irq_diff + 4);
-        *(uint16_t*)(_irq_accum + 8) |= *(uint16_t*)(_irq_diff + 8);
+        if (irq_frame_ingest(previous_buf)) Kernel::isrRaiseEvent(&_irq_data_arrival);
       }
       else {
         ///* Change the DMA state */
@@ -450,7 +462,6 @@ extern "C" {
         //DMA1_Stream3->FCR |= DMA_IT_FE;
         //__HAL_DMA_ENABLE(&_spi2_dma);
       }
-      Kernel::isrRaiseEvent(&_irq_data_arrival);
     }
   }
 
@@ -738,7 +749,8 @@ int8_t SPIBusOp::advance_operation(uint32_t status_reg, uint8_t data_reg) {
 
     case XferState::TX_WAIT:
     case XferState::RX_WAIT:
-      markComplete();
+      // CS is already released. A chained op re-arms for its next segment.
+      if (!_chain_continue(this)) markComplete();
       return 0;
 
     case XferState::ADDR:
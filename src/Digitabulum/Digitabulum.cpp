@@ -331,7 +331,6 @@ void Digitabulum::consoleCmdProc(StringBuilder* input) {
         case 4:
           {
             SensorFrame frame;
-            frame.stackLegend(&_def_pipe);
             _def_pipe.offer(&frame);
             local_log.concat("Cycled blank frame to host.\n");
           }
@@ -345,7 +344,7 @@ void Digitabulum::consoleCmdProc(StringBuilder* input) {
           local_log.concat("Moving _root_leg to _def_pipe.\n");
           break;
         case 8:
-          manu.getActiveLegend()->stackLegend(&_def_pipe);
+          manu.setLegend(&_def_pipe);
           local_log.concat("Moving _def_pipe to _root_leg.\n");
           break;
         case 9:   // Will cause a frame broadcast cycle.
@@ -106,6 +106,8 @@ const float LSM9DS1::max_range_vect_acc  = 16.0;
 const float LSM9DS1::max_range_vect_gyr  = 2000.0;
 const float LSM9DS1::max_range_vect_mag  = 16.0;
 
+uint32_t LSM9DS1::_scale_epoch = 0;
+
 
 /**
 * Return an enumerator given the state index.
@@ -204,6 +206,7 @@ void LSM9DS1::reset() {
   scale_mag           = 0;
   scale_acc           = 0;
   scale_gyr           = 0;
+  _scale_epoch++;
 
   update_rate_m       = 0;
   update_rate_i       = 0;
@@ -582,7 +585,10 @@ IMUFault LSM9DS1::proc_register_read(RegID idx) {
       if (((value >> 2) & 0x07) < MAXIMUM_RATE_INDEX_MAG)  update_rate_m = ((value >> 6) & 0x03)+1;
       break;
     case RegID::M_CTRL_REG2:
-      if (((value >> 4) & 0x03) < MAXIMUM_GAIN_INDEX_MAG)  scale_mag = (value >> 5) & 0x03;
+      if (((value >> 4) & 0x03) < MAXIMUM_GAIN_INDEX_MAG) {
+        scale_mag = (value >> 5) & 0x03;
+        _scale_epoch++;
+      }
       break;
     case RegID::M_CTRL_REG3:
       power_to_mag(value & 0x02);
@@ -628,14 +634,20 @@ IMUFault LSM9DS1::proc_register_read(RegID idx) {
       if (getVerbosity() > 5) {
         local_log.concatf("\t RegID::AG_CTRL_REG4: 0x%02x\n", (uint8_t) value);
       }
-      if (((value >> 3) & 0x07) < MAXIMUM_GAIN_INDEX_ACC)  scale_acc = (value >> 3) & 0x07;
+      if (((value >> 3) & 0x07) < MAXIMUM_GAIN_INDEX_ACC) {
+        scale_acc = (value >> 3) & 0x07;
+        _scale_epoch++;
+      }
       base_filter_param = (value >> 6) & 0x03;
       break;
     case RegID::A_CTRL_REG6:
       if (getVerbosity() > 5) {
         local_log.concatf("\t RegID::A_CTRL_REG6: 0x%02x\n", (uint8_t) value);
       }
-      if (((value >> 3) & 0x03) < MAXIMUM_GAIN_INDEX_GYR)  scale_gyr = (value >> 3) & 0x03;
+      if (((value >> 3) & 0x03) < MAXIMUM_GAIN_INDEX_GYR) {
+        scale_gyr = (value >> 3) & 0x03;
+        _scale_epoch++;
+      }
       break;
     case RegID::AG_FIFO_SRC:     /* The FIFO status register. */
       break;
@@ -669,7 +681,10 @@ IMUFault LSM9DS1::proc_register_write(RegID idx) {
       break;
 
     case RegID::M_CTRL_REG2:
-      if (((value >> 4) & 0x03) < MAXIMUM_GAIN_INDEX_MAG)  scale_mag = (value >> 5) & 0x03;
+      if (((value >> 4) & 0x03) < MAXIMUM_GAIN_INDEX_MAG) {
+        scale_mag = (value >> 5) & 0x03;
+        _scale_epoch++;
+      }
       if (value & 0x04) { // Did we write here to reset?
         if (!present()) {
           //integrator->init();
@@ -289,7 +289,7 @@ class LSM9DS1 {
     inline bool profile() {         return _check_flags(IMU_COMMON_FLAG_PROFILING);     };
     inline bool cancel_error() {    return _check_flags(IMU_COMMON_FLAG_CANCEL_ERROR);  };
     inline void profile(bool x) {       _alter_flags(x, IMU_COMMON_FLAG_PROFILING);     };
-    inline void cancel_error(bool x) {  _alter_flags(x, IMU_COMMON_FLAG_CANCEL_ERROR);  };
+    inline void cancel_error(bool x) {  _alter_flags(x, IMU_COMMON_FLAG_CANCEL_ERROR);  _scale_epoch++;  };
 
     inline bool autoscale_mag() {   return _check_flags(IMU_COMMON_FLAG_AUTOSCALE_0);   };
     inline void autoscale_mag(bool x) {  _alter_flags(x, IMU_COMMON_FLAG_AUTOSCALE_0);  };
@@ -302,6 +302,9 @@ class LSM9DS1 {
     inline float scaleG() {  return error_map_gyr[scale_gyr].per_lsb;  };
     inline float scaleM() {  return error_map_mag[scale_mag].per_lsb;  };
 
+    /* Bumped when any instance's scale (or error cancellation) changes. */
+    static inline uint32_t scaleEpoch() {  return _scale_epoch;  };
+
     inline float deltaT_I() {  return rate_settings_i[update_rate_i].ts_delta;  };
     inline float deltaT_M() {  return rate_settings_m[update_rate_m].ts_delta;  };
 
@@ -386,6 +389,8 @@ class LSM9DS1 {
     uint8_t   update_rate_i       = 0;     // Index to the update-rate array.
     uint8_t   update_rate_m       = 0;     // Index to the update-rate array.
 
+    static uint32_t _scale_epoch;
+
     IMUFault writeRegister(RegID idx, unsigned int nu_val);
     unsigned int regValue(RegID);
 
@@ -0,0 +1,635 @@
+/*
+File:   FusionFilters.h
+Author: J. Ian Lindsay
+Date:   2017.11.02
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Orientation filters that the Integrator can run for each IMU. Each is a type
+  with only static members, and the Integrator's per-IMU loop is a template
+  over them. So the choice of filter is made once per frame, and never inside
+  the loop. A filter provides...
+
+    static const char* name();
+    static void reset(FusionAux*);
+    static bool update(float* q, FusionAux*, const FusionInput*, const FusionParams*);
+
+  update() advances the orientation q (w, x, y, z) by one sample, and returns
+  true if it used the magnetometer. reset() puts the filter's own per-IMU
+  state (if any) where it starts.
+
+Three filters are here:
+  MadgwickFusion   The gradient-descent filter the Integrator has always run.
+  MahonyFusion     A complementary filter. About a third of the arithmetic.
+  EskfFusion       An error-state Kalman filter over attitude and gyro bias.
+                     The costliest, and the best behaved when the gyro drifts.
+
+All of them take the same conventions as Madgwick's code: q rotates the sensor
+  frame into the Earth frame, and a level sensor at rest reads (0, 0, 1) on its
+  accelerometer.
+*/
+
+#ifndef __DIGITABULUM_FUSION_FILTERS_H__
+#define __DIGITABULUM_FUSION_FILTERS_H__
+
+#include <inttypes.h>
+#include <math.h>
+
+/*
+* The filters, ranked by cost. A legend asks for one of these, and the union of
+*   several legends gets the costliest that any of them asked for. DEFAULT
+*   leaves the choice to the Integrator.
+*/
+enum class FusionFilter : uint8_t {
+  DEFAULT   = 0,
+  MAHONY    = 1,
+  MADGWICK  = 2,
+  ESKF      = 3
+};
+
+
+/*
+* One IMU's sample, as a filter sees it. The accelerometer and magnetometer are
+*   normalized, or zero if they are not to be used.
+*/
+typedef struct {
+  float gx, gy, gz;   // Gyro, in rad/s, less any calibrated bias.
+  float ax, ay, az;   // Accelerometer.
+  float mx, my, mz;   // Magnetometer.
+  float dt;           // Time step, in seconds.
+} FusionInput;
+
+
+/* The filters' gains. One set is shared by all IMUs. */
+typedef struct {
+  float   beta;        // Madgwick: gradient step.
+  float   kp;          // Mahony: proportional gain.
+  float   ki;          // Mahony: integral gain. 0 disables the integrator.
+  float   gyro_noise;  // ESKF: gyro noise, in rad/s.
+  float   bias_walk;   // ESKF: gyro bias random walk, in rad/s per root-second.
+  float   acc_noise;   // ESKF: accelerometer noise, normalized.
+  float   mag_noise;   // ESKF: magnetometer noise, normalized.
+  uint8_t iterations;  // Madgwick: steps per sample.
+} FusionParams;
+
+
+/* Per-IMU state that belongs to a particular filter. */
+typedef struct {
+  float i[3];        // Integral feedback, in rad/s.
+} MahonyAux;
+
+typedef struct {
+  float P[6][6];     // Error covariance. Attitude (rad), then gyro bias (rad/s).
+  float b[3];        // Gyro bias estimate, in rad/s. On top of the calibrated bias.
+} EskfAux;
+
+typedef union {
+  MahonyAux mahony;
+  EskfAux   eskf;
+} FusionAux;
+
+
+/**
+* @param  f  A filter.
+* @return Its name.
+*/
+static inline const char* fusion_filter_name(FusionFilter f) {
+  switch (f) {
+    case FusionFilter::MAHONY:    return "Mahony";
+    case FusionFilter::MADGWICK:  return "Madgwick";
+    case FusionFilter::ESKF:      return "ESKF";
+    default:                      return "default";
+  }
+}
+
+
+/*******************************************************************************
+* Madgwick
+*******************************************************************************/
+
+/**
+* Taken from
+* https://github.com/kriswiner/LSM9DS1/blob/master/Teensy3.1/LSM9DS1-MS5637/quaternionFilters.ino
+*/
+// There is a tradeoff in the beta parameter between accuracy and response speed.
+// In the original Madgwick study, beta of 0.041 (corresponding to GyroMeasError of 2.7 degrees/s) was found to give optimal accuracy.
+// However, with this value, the LSM9SD0 response time is about 10 seconds to a stable initial quaternion.
+// Subsequent changes also require a longish lag time to a stable output, not fast enough for a quadcopter or robot car!
+// By increasing beta (GyroMeasError) by about a factor of fifteen, the response time constant is reduced to ~2 sec
+// I haven't noticed any reduction in solution accuracy. This is essentially the I coefficient in a PID control sense;
+// the bigger the feedback coefficient, the faster the solution converges, usually at the expense of accuracy.
+// In any case, this is the free parameter in the Madgwick filtering and fusion scheme.
+class MadgwickFusion {
+  public:
+    static inline const char* name() {   return "Madgwick";   };
+    static inline void reset(FusionAux*) {};
+
+    static inline bool update(float* q, FusionAux*, const FusionInput* in, const FusionParams* p) {
+      if ((0.0f == in->mx) && (0.0f == in->my) && (0.0f == in->mz)) {
+        for (int i = 0; i < p->iterations; i++) {
+          updateIMU(q, in, p->beta);
+        }
+        return false;
+      }
+      const float gx = in->gx;
+      const float gy = in->gy;
+      const float gz = in->gz;
+      const float ax = in->ax;
+      const float ay = in->ay;
+      const float az = in->az;
+      const float mx = in->mx;
+      const float my = in->my;
+      const float mz = in->mz;
+      const float beta = p->beta;
+      const float d_t  = in->dt;
+      float q0 = q[0];
+      float q1 = q[1];
+      float q2 = q[2];
+      float q3 = q[3];
+
+      float norm;
+      float s0, s1, s2, s3;
+      float qDot1, qDot2, qDot3, qDot4;
+      float hx, hy;
+      float _2q0mx, _2q0my, _2q0mz, _2q1mx, _2bx, _2bz, _4bx, _4bz, _2q0, _2q1, _2q2, _2q3, q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
+
+      for (int i = 0; i < p->iterations; i++) {
+        // Rate of change of quaternion from gyroscope
+        qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+        qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+        qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+        qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+        // If the accelerometer vector is non-zero, integrate it...
+        if ((0.0f != ax) || (0.0f != ay) || (0.0f != az)) {
+          // Auxiliary variables to avoid repeated arithmetic
+          _2q0mx = 2.0f * q0 * mx;
+          _2q0my = 2.0f * q0 * my;
+          _2q0mz = 2.0f * q0 * mz;
+          _2q1mx = 2.0f * q1 * mx;
+          _2q0 = 2.0f * q0;
+          _2q1 = 2.0f * q1;
+          _2q2 = 2.0f * q2;
+          _2q3 = 2.0f * q3;
+          q0q0 = q0 * q0;
+          q0q1 = q0 * q1;
+          q0q2 = q0 * q2;
+          q0q3 = q0 * q3;
+          q1q1 = q1 * q1;
+          q1q2 = q1 * q2;
+          q1q3 = q1 * q3;
+          q2q2 = q2 * q2;
+          q2q3 = q2 * q3;
+          q3q3 = q3 * q3;
+
+          // Reference direction of Earth's magnetic field
+          hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+          hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+          _2bx = sqrt(hx * hx + hy * hy);
+          _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+          _4bx = 2.0f * _2bx;
+          _4bz = 2.0f * _2bz;
+          float _8bx = 2.0f * _4bx;
+          float _8bz = 2.0f * _4bz;
+
+          // Gradient decent algorithm corrective step
+          s0 = -_2q2*(2*(q1q3 - q0q2) - ax) + _2q1*(2*(q0q1 + q2q3) - ay) +  -_4bz*q2*(_4bx*(0.5 - q2q2 - q3q3) + _4bz*(q1q3 - q0q2) - mx)   +   (-_4bx*q3+_4bz*q1)*(_4bx*(q1q2 - q0q3) + _4bz*(q0q1 + q2q3) - my)    +   _4bx*q2*(_4bx*(q0q2 + q1q3) + _4bz*(0.5 - q1q1 - q2q2) - mz);
+          s1 = _2q3*(2*(q1q3 - q0q2) - ax)  + _2q0*(2*(q0q1 + q2q3) - ay) + -4*q1*(2*(0.5 - q1q1 - q2q2) - az)    +   _4bz*q3*(_4bx*(0.5 - q2q2 - q3q3) + _4bz*(q1q3 - q0q2) - mx)   + (_4bx*q2+_4bz*q0)*(_4bx*(q1q2 - q0q3) + _4bz*(q0q1 + q2q3) - my)   +   (_4bx*q3-_8bz*q1)*(_4bx*(q0q2 + q1q3) + _4bz*(0.5 - q1q1 - q2q2) - mz);
+          s2 = -_2q0*(2*(q1q3 - q0q2) - ax) + _2q3*(2*(q0q1 + q2q3) - ay) + (-4*q2)*(2*(0.5 - q1q1 - q2q2) - az) +   (-_8bx*q2-_4bz*q0)*(_4bx*(0.5 - q2q2 - q3q3) + _4bz*(q1q3 - q0q2) - mx)+(_4bx*q1+_4bz*q3)*(_4bx*(q1q2 - q0q3) + _4bz*(q0q1 + q2q3) - my)+(_4bx*q0-_8bz*q2)*(_4bx*(q0q2 + q1q3) + _4bz*(0.5 - q1q1 - q2q2) - mz);
+          s3 = _2q1*(2*(q1q3 - q0q2) - ax)  + _2q2*(2*(q0q1 + q2q3) - ay) + (-_8bx*q3+_4bz*q1)*(_4bx*(0.5 - q2q2 - q3q3) + _4bz*(q1q3 - q0q2) - mx)+(-_4bx*q0+_4bz*q2)*(_4bx*(q1q2 - q0q3) + _4bz*(q0q1 + q2q3) - my)+(_4bx*q1)*(_4bx*(q0q2 + q1q3) + _4bz*(0.5 - q1q1 - q2q2) - mz);
+
+          norm = 1.0f / (float) sqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3); // normalise step magnitude
+
+          // Apply feedback step
+          qDot1 -= beta * (s0 * norm);
+          qDot2 -= beta * (s1 * norm);
+          qDot3 -= beta * (s2 * norm);
+          qDot4 -= beta * (s3 * norm);
+
+          // Integrate rate of change of quaternion to yield quaternion
+          q0 += qDot1 * d_t;
+          q1 += qDot2 * d_t;
+          q2 += qDot3 * d_t;
+          q3 += qDot4 * d_t;
+
+          // Normalise quaternion
+          norm = 1.0f / (float) sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q0 * q0);    // normalise quaternion
+          q0 = q0 * norm;
+          q1 = q1 * norm;
+          q2 = q2 * norm;
+          q3 = q3 * norm;
+        }
+      }
+      q[0] = q0;
+      q[1] = q1;
+      q[2] = q2;
+      q[3] = q3;
+      return true;
+    };
+
+
+    /**
+    * One 6-DOF step. This is the 9-DOF step without the magnetometer terms.
+    *
+    * @param  q     The orientation, updated in place.
+    * @param  in    The sample. Its magnetometer is not used.
+    * @param  beta  The gradient step.
+    */
+    static inline void updateIMU(float* q, const FusionInput* in, float beta) {
+      float norm;
+      float s0, s1, s2, s3;
+      float qDot1, qDot2, qDot3, qDot4;
+      float _2q0, _2q1, _2q2, _2q3, _4q0, _4q1, _4q2 ,_8q1, _8q2, q0q0, q1q1, q2q2, q3q3;
+
+      float q0 = q[0];
+      float q1 = q[1];
+      float q2 = q[2];
+      float q3 = q[3];
+
+      const float gx = in->gx;
+      const float gy = in->gy;
+      const float gz = in->gz;
+      const float d_t = in->dt;
+
+      // Rate of change of quaternion from gyroscope
+      qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+      qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+      qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+      qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+      // If the accelerometer vector is non-zero, integrate it...
+      if ((0.0f != in->ax) || (0.0f != in->ay) || (0.0f != in->az)) {
+        const float ax = in->ax;
+        const float ay = in->ay;
+        const float az = in->az;
+        // Auxiliary variables to avoid repeated arithmetic
+        _2q0 = 2.0f * q0;
+        _2q1 = 2.0f * q1;
+        _2q2 = 2.0f * q2;
+        _2q3 = 2.0f * q3;
+        _4q0 = 4.0f * q0;
+        _4q1 = 4.0f * q1;
+        _4q2 = 4.0f * q2;
+        _8q1 = 8.0f * q1;
+        _8q2 = 8.0f * q2;
+        q0q0 = q0 * q0;
+        q1q1 = q1 * q1;
+        q2q2 = q2 * q2;
+        q3q3 = q3 * q3;
+
+        // Gradient decent algorithm corrective step
+        s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+        norm = 1.0f / (float) sqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3); // normalise step magnitude
+        s0 *= norm;
+        s1 *= norm;
+        s2 *= norm;
+        s3 *= norm;
+
+        // Apply feedback step
+        qDot1 -= beta * s0;
+        qDot2 -= beta * s1;
+        qDot3 -= beta * s2;
+        qDot4 -= beta * s3;
+      }
+
+      // Integrate rate of change of quaternion to yield quaternion
+      q0 += qDot1 * d_t;
+      q1 += qDot2 * d_t;
+      q2 += qDot3 * d_t;
+      q3 += qDot4 * d_t;
+
+      // Normalise quaternion
+      norm = 1.0f / (float) sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q0 * q0);    // normalise quaternion
+      q[0] = q0 * norm;
+      q[1] = q1 * norm;
+      q[2] = q2 * norm;
+      q[3] = q3 * norm;
+    };
+};
+
+
+/*******************************************************************************
+* Mahony
+*******************************************************************************/
+
+/*
+* Mahony's complementary filter. The error between the measured and estimated
+*   directions of gravity (and of the Earth's field, if we have it) is fed back
+*   into the gyro through a PI controller. One pass, no iterations.
+* After Madgwick's C implementation of it (MahonyAHRS.c).
+*/
+class MahonyFusion {
+  public:
+    static inline const char* name() {   return "Mahony";   };
+    static inline void reset(FusionAux* aux) {
+      aux->mahony.i[0] = 0.0f;
+      aux->mahony.i[1] = 0.0f;
+      aux->mahony.i[2] = 0.0f;
+    };
+
+    static inline bool update(float* q, FusionAux* aux, const FusionInput* in, const FusionParams* p) {
+      float q0 = q[0];
+      float q1 = q[1];
+      float q2 = q[2];
+      float q3 = q[3];
+      float gx = in->gx;
+      float gy = in->gy;
+      float gz = in->gz;
+      const bool use_mag = (0.0f != in->mx) || (0.0f != in->my) || (0.0f != in->mz);
+
+      if ((0.0f != in->ax) || (0.0f != in->ay) || (0.0f != in->az)) {
+        const float q0q0 = q0 * q0;
+        const float q0q1 = q0 * q1;
+        const float q0q2 = q0 * q2;
+        const float q1q3 = q1 * q3;
+        const float q2q3 = q2 * q3;
+        const float q3q3 = q3 * q3;
+
+        // Estimated direction of gravity, halved.
+        const float halfvx = q1q3 - q0q2;
+        const float halfvy = q0q1 + q2q3;
+        const float halfvz = q0q0 - 0.5f + q3q3;
+
+        // Error is the cross product of measured and estimated directions.
+        float halfex = (in->ay * halfvz - in->az * halfvy);
+        float halfey = (in->az * halfvx - in->ax * halfvz);
+        float halfez = (in->ax * halfvy - in->ay * halfvx);
+
+        if (use_mag) {
+          const float mx = in->mx;
+          const float my = in->my;
+          const float mz = in->mz;
+          const float q0q3 = q0 * q3;
+          const float q1q1 = q1 * q1;
+          const float q1q2 = q1 * q2;
+          const float q2q2 = q2 * q2;
+
+          // Reference direction of Earth's magnetic field
+          const float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+          const float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+          const float bx = sqrtf(hx * hx + hy * hy);
+          const float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+
+          // Estimated direction of the field, halved.
+          const float halfwx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+          const float halfwy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+          const float halfwz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+
+          halfex += (my * halfwz - mz * halfwy);
+          halfey += (mz * halfwx - mx * halfwz);
+          halfez += (mx * halfwy - my * halfwx);
+        }
+
+        if (p->ki > 0.0f) {
+          float* i = aux->mahony.i;
+          i[0] += 2.0f * p->ki * halfex * in->dt;
+          i[1] += 2.0f * p->ki * halfey * in->dt;
+          i[2] += 2.0f * p->ki * halfez * in->dt;
+          gx += i[0];
+          gy += i[1];
+          gz += i[2];
+        }
+        gx += 2.0f * p->kp * halfex;
+        gy += 2.0f * p->kp * halfey;
+        gz += 2.0f * p->kp * halfez;
+      }
+
+      // Integrate rate of change of quaternion
+      gx *= (0.5f * in->dt);
+      gy *= (0.5f * in->dt);
+      gz *= (0.5f * in->dt);
+      const float qa = q0;
+      const float qb = q1;
+      const float qc = q2;
+      q0 += (-qb * gx - qc * gy - q3 * gz);
+      q1 += (qa * gx + qc * gz - q3 * gy);
+      q2 += (qa * gy - qb * gz + q3 * gx);
+      q3 += (qa * gz + qb * gy - qc * gx);
+
+      const float norm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+      q[0] = q0 * norm;
+      q[1] = q1 * norm;
+      q[2] = q2 * norm;
+      q[3] = q3 * norm;
+      return use_mag;
+    };
+};
+
+
+/*******************************************************************************
+* Error-state Kalman filter
+*******************************************************************************/
+
+/*
+* An error-state (indirect) Kalman filter. The nominal state is the orientation
+*   and a gyro bias. The filter tracks the covariance of a small error in each:
+*   an attitude error (as a rotation vector, in the sensor frame) and a bias
+*   error. The gyro drives the prediction. The accelerometer and magnetometer
+*   are each a measured direction, and correct it.
+* The magnetometer's reference is found from the sample itself, as Madgwick's
+*   filter does. So it mostly corrects heading.
+*/
+class EskfFusion {
+  public:
+    static inline const char* name() {   return "ESKF";   };
+    static inline void reset(FusionAux* aux) {
+      EskfAux* e = &aux->eskf;
+      for (uint8_t r = 0; r < 6; r++) {
+        for (uint8_t c = 0; c < 6; c++) e->P[r][c] = 0.0f;
+      }
+      for (uint8_t r = 0; r < 3; r++) {
+        e->P[r][r]         = 0.1f;     // ~18 degrees.
+        e->P[r + 3][r + 3] = 1e-4f;    // ~0.6 dps.
+        e->b[r]            = 0.0f;
+      }
+    };
+
+    static inline bool update(float* q, FusionAux* aux, const FusionInput* in, const FusionParams* p) {
+      EskfAux* e = &aux->eskf;
+      const float dt = in->dt;
+      const float wx = in->gx - e->b[0];
+      const float wy = in->gy - e->b[1];
+      const float wz = in->gz - e->b[2];
+
+      // Nominal state: integrate the gyro.
+      _rotate(q, 0.5f * wx * dt, 0.5f * wy * dt, 0.5f * wz * dt);
+
+      // Error state: P = F P F' + Q, with F = [I - [w]x dt,  -I dt;  0,  I].
+      float F[6][6];
+      float FP[6][6];
+      for (uint8_t r = 0; r < 6; r++) {
+        for (uint8_t c = 0; c < 6; c++) F[r][c] = (r == c) ? 1.0f : 0.0f;
+      }
+      F[0][1] =  wz * dt;   F[0][2] = -wy * dt;
+      F[1][0] = -wz * dt;   F[1][2] =  wx * dt;
+      F[2][0] =  wy * dt;   F[2][1] = -wx * dt;
+      F[0][3] = -dt;        F[1][4] = -dt;        F[2][5] = -dt;
+      for (uint8_t r = 0; r < 6; r++) {
+        for (uint8_t c = 0; c < 6; c++) {
+          float acc = 0.0f;
+          for (uint8_t k = 0; k < 6; k++) acc += F[r][k] * e->P[k][c];
+          FP[r][c] = acc;
+        }
+      }
+      for (uint8_t r = 0; r < 6; r++) {
+        for (uint8_t c = 0; c < 6; c++) {
+          float acc = 0.0f;
+          for (uint8_t k = 0; k < 6; k++) acc += FP[r][k] * F[c][k];
+          e->P[r][c] = acc;
+        }
+      }
+      const float q_ang  = p->gyro_noise * p->gyro_noise * dt * dt;
+      const float q_bias = p->bias_walk * p->bias_walk * dt;
+      for (uint8_t r = 0; r < 3; r++) {
+        e->P[r][r]         += q_ang;
+        e->P[r + 3][r + 3] += q_bias;
+      }
+
+      float R[3][3];
+      if ((0.0f != in->ax) || (0.0f != in->ay) || (0.0f != in->az)) {
+        // Gravity, as the sensor should see it: R' (0, 0, 1).
+        _rot_matrix(q, R);
+        _correct(q, e, R[2][0], R[2][1], R[2][2], in->ax, in->ay, in->az, p->acc_noise * p->acc_noise);
+      }
+      const bool use_mag = (0.0f != in->mx) || (0.0f != in->my) || (0.0f != in->mz);
+      if (use_mag) {
+        // The field in the Earth frame, with its horizontal part turned north.
+        _rot_matrix(q, R);
+        const float hx = R[0][0] * in->mx + R[0][1] * in->my + R[0][2] * in->mz;
+        const float hy = R[1][0] * in->mx + R[1][1] * in->my + R[1][2] * in->mz;
+        const float bz = R[2][0] * in->mx + R[2][1] * in->my + R[2][2] * in->mz;
+        const float bx = sqrtf(hx * hx + hy * hy);
+        _correct(q, e,
+          R[0][0] * bx + R[2][0] * bz,
+          R[0][1] * bx + R[2][1] * bz,
+          R[0][2] * bx + R[2][2] * bz,
+          in->mx, in->my, in->mz, p->mag_noise * p->mag_noise
+        );
+      }
+      return use_mag;
+    };
+
+
+  private:
+    /* q = q * (1, x, y, z), normalized. A small rotation, in the sensor frame. */
+    static inline void _rotate(float* q, float x, float y, float z) {
+      const float q0 = q[0];
+      const float q1 = q[1];
+      const float q2 = q[2];
+      const float q3 = q[3];
+      float n0 = q0 - q1 * x - q2 * y - q3 * z;
+      float n1 = q1 + q0 * x + q2 * z - q3 * y;
+      float n2 = q2 + q0 * y - q1 * z + q3 * x;
+      float n3 = q3 + q0 * z + q1 * y - q2 * x;
+      const float norm = 1.0f / sqrtf(n0 * n0 + n1 * n1 + n2 * n2 + n3 * n3);
+      q[0] = n0 * norm;
+      q[1] = n1 * norm;
+      q[2] = n2 * norm;
+      q[3] = n3 * norm;
+    };
+
+    /* The rotation matrix of q. Sensor frame to Earth frame. */
+    static inline void _rot_matrix(const float* q, float R[3][3]) {
+      const float q0 = q[0];
+      const float q1 = q[1];
+      const float q2 = q[2];
+      const float q3 = q[3];
+      R[0][0] = q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3;
+      R[0][1] = 2.0f * (q1 * q2 - q0 * q3);
+      R[0][2] = 2.0f * (q1 * q3 + q0 * q2);
+      R[1][0] = 2.0f * (q1 * q2 + q0 * q3);
+      R[1][1] = q0 * q0 - q1 * q1 + q2 * q2 - q3 * q3;
+      R[1][2] = 2.0f * (q2 * q3 - q0 * q1);
+      R[2][0] = 2.0f * (q1 * q3 - q0 * q2);
+      R[2][1] = 2.0f * (q2 * q3 + q0 * q1);
+      R[2][2] = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+    };
+
+    /**
+    * Corrects the state with a measured direction.
+    *
+    * A small attitude error d turns the predicted direction h into h - d x h,
+    *   so the measurement matrix is [ [h]x  0 ].
+    *
+    * @param  q           The orientation, corrected in place.
+    * @param  e           The filter's state, corrected in place.
+    * @param  hx, hy, hz  The direction predicted, in the sensor frame.
+    * @param  zx, zy, zz  The direction measured, in the sensor frame.
+    * @param  r           The measurement's variance, per axis.
+    */
+    static inline void _correct(float* q, EskfAux* e, float hx, float hy, float hz, float zx, float zy, float zz, float r) {
+      const float H[3][3] = {
+        { 0.0f, -hz,   hy  },
+        { hz,    0.0f, -hx },
+        { -hy,   hx,   0.0f}
+      };
+      // PH' (6x3). H's bias columns are zero.
+      float PHt[6][3];
+      for (uint8_t i = 0; i < 6; i++) {
+        for (uint8_t j = 0; j < 3; j++) {
+          PHt[i][j] = e->P[i][0] * H[j][0] + e->P[i][1] * H[j][1] + e->P[i][2] * H[j][2];
+        }
+      }
+      // S = H P H' + rI (3x3, symmetric), and its inverse.
+      float S[3][3];
+      for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < 3; j++) {
+          S[i][j] = H[i][0] * PHt[0][j] + H[i][1] * PHt[1][j] + H[i][2] * PHt[2][j];
+        }
+        S[i][i] += r;
+      }
+      const float c00 = S[1][1] * S[2][2] - S[1][2] * S[2][1];
+      const float c01 = S[1][2] * S[2][0] - S[1][0] * S[2][2];
+      const float c02 = S[1][0] * S[2][1] - S[1][1] * S[2][0];
+      const float det = S[0][0] * c00 + S[0][1] * c01 + S[0][2] * c02;
+      if (0.0f == det) return;
+      const float id = 1.0f / det;
+      const float Si[3][3] = {
+        { c00 * id, (S[0][2] * S[2][1] - S[0][1] * S[2][2]) * id, (S[0][1] * S[1][2] - S[0][2] * S[1][1]) * id },
+        { c01 * id, (S[0][0] * S[2][2] - S[0][2] * S[2][0]) * id, (S[0][2] * S[1][0] - S[0][0] * S[1][2]) * id },
+        { c02 * id, (S[0][1] * S[2][0] - S[0][0] * S[2][1]) * id, (S[0][0] * S[1][1] - S[0][1] * S[1][0]) * id }
+      };
+      // K = PH' S^-1 (6x3), and the error estimate dx = K (z - h).
+      const float y[3] = { zx - hx, zy - hy, zz - hz };
+      float K[6][3];
+      float dx[6];
+      for (uint8_t i = 0; i < 6; i++) {
+        for (uint8_t j = 0; j < 3; j++) {
+          K[i][j] = PHt[i][0] * Si[0][j] + PHt[i][1] * Si[1][j] + PHt[i][2] * Si[2][j];
+        }
+        dx[i] = K[i][0] * y[0] + K[i][1] * y[1] + K[i][2] * y[2];
+      }
+      // P = P - K (PH')', kept symmetric.
+      for (uint8_t i = 0; i < 6; i++) {
+        for (uint8_t j = i; j < 6; j++) {
+          const float v = e->P[i][j] - (K[i][0] * PHt[j][0] + K[i][1] * PHt[j][1] + K[i][2] * PHt[j][2]);
+          e->P[i][j] = v;
+          e->P[j][i] = v;
+        }
+      }
+      // Fold the error into the nominal state.
+      _rotate(q, 0.5f * dx[0], 0.5f * dx[1], 0.5f * dx[2]);
+      e->b[0] += dx[3];
+      e->b[1] += dx[4];
+      e->b[2] += dx[5];
+    };
+};
+
+#endif  // __DIGITABULUM_FUSION_FILTERS_H__
@@ -0,0 +1,186 @@
+/*
+File:   HandSkeleton.h
+Author: J. Ian Lindsay
+Date:   2017.11.05
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+The hand as a chain of rigid bones, for forward kinematics in the Integrator.
+
+Each digit hangs off the palm at its base, and is three segments long, one
+  for each of its IMUs (proximal, intermediate, distal). The thumb's three are
+  its metacarpal and two phalanges. The palm is the metacarpals IMU where
+  there is one, and the IMU on the main PCB otherwise. That IMU also roots the
+  skeleton: positions are from it, in the Earth frame.
+
+Conventions follow FusionFilters.h (q rotates the sensor frame into the Earth
+  frame), and every IMU is taken to be mounted the same way on its bone...
+    +X  Along the bone, toward the fingertip.
+    +Y  Toward the thumb side of a right hand.
+    +Z  Out of the back of the hand.
+  So flexion (curling toward the palm) is positive rotation about Y, and
+  abduction (spreading toward the thumb) is positive rotation about Z. A left
+  hand is mirrored across the XZ plane, so that both signs mean the same
+  anatomically on either hand.
+
+Joint angles are each segment relative to the one before it. They need no
+  common reference, and so don't suffer the heading drift of the IMUs.
+*/
+
+#ifndef __DIGITABULUM_HAND_SKELETON_H__
+#define __DIGITABULUM_HAND_SKELETON_H__
+
+#include <inttypes.h>
+#include <math.h>
+#include <DataStructures/Vector3.h>
+
+#define HAND_DIGIT_COUNT     5
+#define HAND_SEGMENT_COUNT   3    // Per digit.
+
+/*
+* Layout of HandPose::joints. The wrist leads. Then four angles per digit, in
+*   anatomical order (thumb first): abduction at the base, and flexion at
+*   each of the three joints, base first.
+*/
+#define HAND_JOINT_WRIST     0
+#define HAND_JOINT(d, j)     (1 + ((d) * 4) + (j))   // d: digit less one. j: 0 is abduction, 1-3 flexion.
+#define HAND_JOINT_COUNT     (1 + (HAND_DIGIT_COUNT * 4))
+
+#define HAND_RAD_TO_DEG      (180.0f / 3.14159f)
+
+
+/*
+* The lengths and placement of the bones, in meters. Right-handed.
+*/
+typedef struct {
+  float base[HAND_DIGIT_COUNT][3];                  // Base of each digit, from the root IMU, in the palm's frame.
+  float bone[HAND_DIGIT_COUNT][HAND_SEGMENT_COUNT]; // Length of each segment, base first.
+} HandSkeleton;
+
+/*
+* What the skeleton says about the hand in one frame. Digits are in anatomical
+*   order (thumb first).
+*/
+typedef struct {
+  float          joints[HAND_JOINT_COUNT];   // In degrees. See HAND_JOINT().
+  Vector3<float> tip[HAND_DIGIT_COUNT];      // Fingertips, from the root IMU, in the Earth frame. Meters.
+  uint8_t        digits;                     // Bit d set if digit (d + 1) was solved.
+} HandPose;
+
+
+/**
+* Fills the given skeleton with the bones of an average adult hand.
+*
+* @param  s  The skeleton.
+*/
+static inline void hand_skeleton_default(HandSkeleton* s) {
+  static const float BASE[HAND_DIGIT_COUNT][3] = {
+    {0.030f,  0.025f, -0.010f},   // Thumb (carpometacarpal joint)
+    {0.090f,  0.025f,  0.000f},   // Index
+    {0.095f,  0.005f,  0.000f},   // Middle
+    {0.090f, -0.013f,  0.000f},   // Ring
+    {0.080f, -0.030f,  0.000f}    // Pinky
+  };
+  static const float BONE[HAND_DIGIT_COUNT][HAND_SEGMENT_COUNT] = {
+    {0.046f, 0.032f, 0.025f},
+    {0.040f, 0.023f, 0.018f},
+    {0.045f, 0.027f, 0.019f},
+    {0.042f, 0.026f, 0.019f},
+    {0.033f, 0.019f, 0.017f}
+  };
+  for (uint8_t d = 0; d < HAND_DIGIT_COUNT; d++) {
+    for (uint8_t i = 0; i < 3; i++) s->base[d][i] = BASE[d][i];
+    for (uint8_t i = 0; i < HAND_SEGMENT_COUNT; i++) s->bone[d][i] = BONE[d][i];
+  }
+}
+
+
+/**
+* Scales every bone in the skeleton by the same factor.
+*
+* @param  s       The skeleton.
+* @param  factor  1.0 leaves it as it is.
+*/
+static inline void hand_skeleton_scale(HandSkeleton* s, float factor) {
+  for (uint8_t d = 0; d < HAND_DIGIT_COUNT; d++) {
+    for (uint8_t i = 0; i < 3; i++) s->base[d][i] *= factor;
+    for (uint8_t i = 0; i < HAND_SEGMENT_COUNT; i++) s->bone[d][i] *= factor;
+  }
+}
+
+
+/**
+* Rotates a vector by a quaternion. From the sensor frame into the Earth frame.
+*
+* @param  q    The quaternion (w, x, y, z).
+* @param  v    The vector.
+* @param  out  Receives the rotated vector. Must not be v.
+*/
+static inline void hand_rotate(const float* q, const float* v, float* out) {
+  const float w = q[0], x = q[1], y = q[2], z = q[3];
+  out[0] = (1.0f - 2.0f * (y*y + z*z)) * v[0] + 2.0f * (x*y - w*z) * v[1] + 2.0f * (x*z + w*y) * v[2];
+  out[1] = 2.0f * (x*y + w*z) * v[0] + (1.0f - 2.0f * (x*x + z*z)) * v[1] + 2.0f * (y*z - w*x) * v[2];
+  out[2] = 2.0f * (x*z - w*y) * v[0] + 2.0f * (y*z + w*x) * v[1] + (1.0f - 2.0f * (x*x + y*y)) * v[2];
+}
+
+
+/**
+* The inverse of hand_rotate(). From the Earth frame into the sensor frame.
+*
+* @param  q    The quaternion (w, x, y, z).
+* @param  v    The vector.
+* @param  out  Receives the rotated vector. Must not be v.
+*/
+static inline void hand_unrotate(const float* q, const float* v, float* out) {
+  const float w = q[0], x = q[1], y = q[2], z = q[3];
+  out[0] = (1.0f - 2.0f * (y*y + z*z)) * v[0] + 2.0f * (x*y + w*z) * v[1] + 2.0f * (x*z - w*y) * v[2];
+  out[1] = 2.0f * (x*y - w*z) * v[0] + (1.0f - 2.0f * (x*x + z*z)) * v[1] + 2.0f * (y*z + w*x) * v[2];
+  out[2] = 2.0f * (x*z + w*y) * v[0] + 2.0f * (y*z - w*x) * v[1] + (1.0f - 2.0f * (x*x + y*y)) * v[2];
+}
+
+
+/**
+* The direction of a bone (its IMU's +X) in the Earth frame.
+*
+* @param  q    The bone's orientation (w, x, y, z).
+* @param  out  Receives the unit vector.
+*/
+static inline void hand_bone_axis(const float* q, float* out) {
+  out[0] = 1.0f - 2.0f * (q[2]*q[2] + q[3]*q[3]);
+  out[1] = 2.0f * (q[1]*q[2] + q[0]*q[3]);
+  out[2] = 2.0f * (q[1]*q[3] - q[0]*q[2]);
+}
+
+
+/**
+* The angles of the joint between two bones.
+*
+* @param  parent    The orientation of the bone nearer the palm.
+* @param  child     The orientation of the bone past the joint.
+* @param  mirror    -1 for a left hand. 1 otherwise.
+* @param  flex      Receives the flexion, in degrees.
+* @param  abduct    Receives the abduction, in degrees. May be nullptr.
+*/
+static inline void hand_joint(const float* parent, const float* child, float mirror, float* flex, float* abduct) {
+  float axis[3];
+  float u[3];
+  hand_bone_axis(child, axis);
+  hand_unrotate(parent, axis, u);    // The child's bone, as the parent sees it.
+  *flex = atan2f(-u[2], u[0]) * HAND_RAD_TO_DEG;
+  if (nullptr != abduct) *abduct = mirror * atan2f(u[1], u[0]) * HAND_RAD_TO_DEG;
+}
+
+#endif  // __DIGITABULUM_HAND_SKELETON_H__
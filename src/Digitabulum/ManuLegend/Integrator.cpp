@@ -34,7 +34,9 @@ limitations under the License.
 *******************************************************************************/
 
 static const Vector3<float> ZERO_VECTOR;
-float    Integrator::mag_discard_threshold         = 0.8f;  // In Gauss.
+
+/* Frame interval in benchKernels(), in microseconds. */
+#define INTEGRATOR_BENCH_DT_US   10000
 
 
 
@@ -47,16 +49,46 @@ float    Integrator::mag_discard_threshold         = 0.8f;  // In Gauss.
 * Constructors/destructors, class initialization functions and so-forth...
 *******************************************************************************/
 
-Integrator::Integrator() : _complete(CONFIG_INTEGRATOR_Q_DEPTH), _pending(CONFIG_INTEGRATOR_Q_DEPTH) {
+Integrator::Integrator() {
   // Values for 9 DoF fusion and AHRS (Attitude and Heading Reference System)
   //GyroMeasError = 3.1415926535f * (40.0f / 180.0f);  // gyroscope measurement error in rads/s (shown as 3 deg/s)
   GyroMeasDrift = 3.1415926535f * (0.0f / 180.0f);   // gyroscope measurement drift in rad/s/s (shown as 0.0 deg/s/s)
   //beta = 0.866025404f * (3.1415926535f * GyroMeasError);   // compute beta
-  beta = 0.2f;
+  _cfg_k.params.beta       = 0.2f;
+  _cfg_k.params.iterations = 1;     // Madgwick's filter is run this many times per frame.
+  _cfg_k.params.kp         = 1.0f;
+  _cfg_k.params.ki         = 0.2f;
+  _cfg_k.params.gyro_noise = 0.005f;
+  _cfg_k.params.bias_walk  = 1e-4f;
+  _cfg_k.params.acc_noise  = 0.05f;
+  _cfg_k.params.mag_noise  = 0.1f;
+  _cfg_k.filter = FusionFilter::CONFIG_INTEGRATOR_FILTER;
+  _cfg_k.lanes  = MADGWICK_SOA_NATIVE;
+  hand_skeleton_default(&_cfg_k.skel);
+  _cfg_k.flags       = 0;
+  _cfg_k.mag_discard = 0.8f;   // In Gauss.
+  _cfg = _cfg_k;
+  // Until a legend says otherwise, orientation is found for every IMU, and
+  //   nothing more.
+  _demand.orientation = (1UL << INTEGRATOR_IMU_COUNT) - 1;
+  _demand.null_grav   = 0;
+  _demand.velocity    = 0;
+  _demand.position    = 0;
+  _demand.filter      = FusionFilter::DEFAULT;
+  _demand.hand        = false;
+  _demand.left_hand   = false;
+  for (uint8_t d = 0; d < HAND_DIGIT_COUNT; d++) {
+    _demand.digit_port[d] = 0;
+  }
+  _demand_k = _demand;
+  for (uint8_t i = 0; i < INTEGRATOR_IMU_COUNT; i++) {
+    resetState(i);
+  }
 }
 
 
 Integrator::~Integrator() {
+  stopWorker();
 }
 
 
@@ -68,6 +100,161 @@ void Integrator::reset() {
   _grav.set(0.0f, 0.0f, 0.0f);
 
   grav_scalar = 0.0f;
+  for (uint8_t i = 0; i < INTEGRATOR_IMU_COUNT; i++) {
+    resetState(i);
+  }
+}
+
+
+/**
+* Returns the given IMU's filter to where it starts: level, at rest, at the
+*   origin, and with no samples fused. Its gyro bias is kept.
+*
+* @param  imu  The IMU.
+*/
+void Integrator::resetState(uint8_t imu) {
+  FilterState* s = &_state[imu];
+  s->q[0] = 1.0f;
+  s->q[1] = 0.0f;
+  s->q[2] = 0.0f;
+  s->q[3] = 0.0f;
+  s->vel.set(0.0f, 0.0f, 0.0f);
+  s->pos.set(0.0f, 0.0f, 0.0f);
+  s->t_last_us = 0;
+  _reset_aux(imu);
+}
+
+
+/**
+* Puts the given IMU's state for the filter in use where it starts.
+*
+* @param  imu  The IMU.
+*/
+void Integrator::_reset_aux(uint8_t imu) {
+  switch (_filter_live) {
+    case FusionFilter::MAHONY:  MahonyFusion::reset(&_aux[imu]);    break;
+    case FusionFilter::ESKF:    EskfFusion::reset(&_aux[imu]);      break;
+    default:                    MadgwickFusion::reset(&_aux[imu]);  break;
+  }
+}
+
+
+/**
+* Which filter runs on the next frame. The legend's choice, if it made one.
+*   Otherwise, ours.
+*
+* @return The filter.
+*/
+FusionFilter Integrator::activeFilter() {
+  return _filter_for(&_demand_k, &_cfg_k);
+}
+
+
+/**
+* @param  d  A demand.
+* @param  c  A config.
+* @return The filter that runs under them.
+*/
+FusionFilter Integrator::_filter_for(const IntegratorDemand* d, const IntegratorConfig* c) {
+  return (FusionFilter::DEFAULT == d->filter) ? c->filter : d->filter;
+}
+
+
+/**
+* Called by integration only, as it owns the filters' state. When the active
+*   filter changes, the filters' own state is started over. The orientations
+*   are kept.
+*
+* @return The filter to run on this frame.
+*/
+FusionFilter Integrator::_select_filter() {
+  const FusionFilter f = _filter_for(&_demand, &_cfg);
+  if (f != _filter_live) {
+    _filter_live = f;
+    for (uint8_t i = 0; i < INTEGRATOR_IMU_COUNT; i++) _reset_aux(i);
+  }
+  return f;
+}
+
+
+/**
+* Takes what is wanted, which should be the union of what every consumer
+*   wants. Called from the kernel's context. Integration picks it up ahead of
+*   its next frame.
+*
+* @param  d  The demand. Copied.
+* @return 0 on success, -1 if there was no demand.
+*/
+int8_t Integrator::demand(const IntegratorDemand* d) {
+  if (nullptr == d) return -1;
+  _demand_k = *d;
+  _demand_changed();
+  return 0;
+}
+
+
+/**
+* Called from the kernel's context after _demand_k has changed. Passes it along
+*   to integration. If there is no room for it, pushFrame() will try again.
+*   Only the latest demand matters, so nothing is lost by the wait.
+*/
+void Integrator::_demand_changed() {
+  _demand_resend = (0 != _demand_q.insert(_demand_k));
+  if (_demand_resend) return;
+  if (threaded()) {
+    _worker_wake();
+  }
+  else {
+    _take_demand();   // Integration happens in this context. No need to wait.
+  }
+}
+
+
+/**
+* Called by integration only. Takes up whatever demand the kernel has passed
+*   along. An IMU that comes into demand for a stage starts that stage over,
+*   since whatever state it had is stale.
+*/
+void Integrator::_take_demand() {
+  IntegratorDemand nu;
+  while (_demand_q.get(&nu)) {
+    const uint32_t fresh_o = nu.orientation & ~_demand.orientation;
+    const uint32_t fresh_v = nu.velocity & ~(_demand.velocity | fresh_o);
+    const uint32_t fresh_p = nu.position & ~(_demand.position | fresh_o);
+    for (uint32_t m = fresh_o; 0 != m; m &= (m - 1)) resetState((uint8_t) __builtin_ctz(m));
+    for (uint32_t m = fresh_v; 0 != m; m &= (m - 1)) _state[__builtin_ctz(m)].vel.set(0.0f, 0.0f, 0.0f);
+    for (uint32_t m = fresh_p; 0 != m; m &= (m - 1)) _state[__builtin_ctz(m)].pos.set(0.0f, 0.0f, 0.0f);
+    _demand = nu;
+  }
+}
+
+
+/**
+* Called from the kernel's context after _cfg_k has changed. Passes the whole
+*   of it along to integration. If there is no room for it, pushFrame() will
+*   try again.
+*/
+void Integrator::_config_changed() {
+  _cfg_resend = (0 != _cfg_q.insert(_cfg_k));
+  if (_cfg_resend) return;
+  if (threaded()) {
+    _worker_wake();
+  }
+  else {
+    _take_config();   // Integration happens in this context. No need to wait.
+  }
+}
+
+
+/**
+* Called by integration only, between frames. Takes up the kernel's latest
+*   settings.
+*/
+void Integrator::_take_config() {
+  IntegratorConfig nu;
+  while (_cfg_q.get(&nu)) {
+    _cfg = nu;
+  }
 }
 
 
@@ -174,34 +361,73 @@ TODO: DEPRECATED Slow. Too complicated.
 
 /**
 * This is the function that the processing thread (if any) would call repeatedly.
+* Integrates pending frames until there are none, or there is no room for the
+*   results, or a budget is spent. At least one frame is integrated if it can
+*   be, so the time budget is only checked between frames.
 *
+* @param  budget_us   Start no frame after this much time has passed. 0 for no limit.
+* @param  max_frames  Integrate no more than this many frames. 0 for no limit.
 * @return The number of SensorFrames completed.
 */
-int8_t Integrator::churn() {
+int8_t Integrator::churn(uint32_t budget_us, uint8_t max_frames) {
   int8_t return_value = 0;
-  if ((0 < _complete.vacancy()) && MadgwickQuaternionUpdate()) {
+  const uint32_t t0 = micros();
+  if (0 != _churn_t_last) _churn_wall_us += (uint32_t) (t0 - _churn_t_last);
+  _churn_t_last = t0;
+  _churn_calls++;
+  _take_demand();
+  _take_config();
+
+  while (_pending.count() > 0) {
+    if (_complete.count() >= _complete.capacity()) {
+      // Results aren't being collected. Integration waits, and new frames back
+      //   up behind it until the frame policy has to act.
+      _stalls++;
+      break;
+    }
+    if ((0 != max_frames) && (return_value >= max_frames)) break;
+    if ((0 != budget_us) && (0 < return_value) && ((uint32_t) (micros() - t0) >= budget_us)) break;
+    _integrate_next();
     return_value++;
   }
+
+  const uint32_t spent = (uint32_t) (micros() - t0);
+  _churn_busy_us += spent;
+  _churn_frames  += return_value;
+  if ((0 != budget_us) && (spent > budget_us)) _churn_overruns++;
+  if ((uint8_t) return_value > _churn_max_batch) _churn_max_batch = return_value;
   return return_value;
 }
 
 
 bool Integrator::enableProfiling(bool en) {
-  if (enableProfiling() != en) {
-    data_handling_flags = (en) ? (data_handling_flags | IIU_DATA_HANDLING_PROFILING) : (data_handling_flags & ~(IIU_DATA_HANDLING_PROFILING));
-  }
+  _flag(IIU_DATA_HANDLING_PROFILING, en);
   return enableProfiling();
 }
 
 
 bool Integrator::nullGyroError(bool en) {
-  if (nullGyroError() != en) {
-    data_handling_flags = (en) ? (data_handling_flags | IIU_DATA_HANDLING_NULL_GYRO_ERROR) : (data_handling_flags & ~(IIU_DATA_HANDLING_NULL_GYRO_ERROR));
-  }
+  _flag(IIU_DATA_HANDLING_NULL_GYRO_ERROR, en);
   return nullGyroError();
 }
 
 
+/**
+* Called from the kernel's context. Sets or clears a handling flag, and passes
+*   the change along to integration.
+*
+* @param  f   The IIU_DATA_HANDLING_* bit.
+* @param  en  Set it?
+*/
+void Integrator::_flag(uint32_t f, bool en) {
+  const uint32_t nu = (en) ? (_cfg_k.flags | f) : (_cfg_k.flags & ~f);
+  if (nu != _cfg_k.flags) {
+    _cfg_k.flags = nu;
+    _config_changed();
+  }
+}
+
+
 /**
 * Debug support method. This fxn is only present in debug builds.
 *
@@ -211,6 +437,51 @@ void Integrator::printDebug(StringBuilder* output) {
   output->concat("\n-------------------------------------------------------\n--- Integrator\n-------------------------------------------------------\n");
   output->concatf("-- Samples:\t %u\n-- Measurements\n\t_pending:   %u\n\t_complete:  %u\n", _frames_completed, _pending.count(), _complete.count());
   output->concatf("-- delta_t:\t %3fms\n", ((double) delta_t * 1000));
+  output->concatf("-- Filter:\t %s (ours is %s)\n", fusion_filter_name(activeFilter()), fusion_filter_name(_cfg_k.filter));
+  output->concatf("-- IMU updates:\t %u 9-DOF, %u 6-DOF, %u not wanted\n", (unsigned int) _updates_9dof, (unsigned int) _updates_6dof, (unsigned int) _imus_idle);
+  output->concatf("-- Demand:\t orientation 0x%05x  null-grav 0x%05x  velocity 0x%05x  position 0x%05x\n",
+    (unsigned int) _demand_k.orientation,
+    (unsigned int) _demand_k.null_grav,
+    (unsigned int) _demand_k.velocity,
+    (unsigned int) _demand_k.position
+  );
+  if (_demand_k.hand) {
+    output->concatf("-- Skeleton:\t %s hand, digits on ports %u %u %u %u %u\n",
+      (_demand_k.left_hand ? "left" : "right"),
+      _demand_k.digit_port[0], _demand_k.digit_port[1], _demand_k.digit_port[2],
+      _demand_k.digit_port[3], _demand_k.digit_port[4]
+    );
+  }
+  output->concatf("-- Pending high-water: %u of %u\n-- Stalls on results:\t %u\n", _pending.highWater(), _pending.capacity(), (unsigned int) _stalls);
+  if (threaded()) {
+    output->concatf("-- Runs in:\t worker thread (slept %u times)\n", (unsigned int) _worker_sleeps);
+  }
+  else {
+    output->concat("-- Runs in:\t kernel\n");
+  }
+  if (_churn_calls > 0) {
+    output->concatf("-- churn():\t %u calls, %u frames (%.2f per call, at most %u), %u over budget\n",
+      (unsigned int) _churn_calls,
+      (unsigned int) _churn_frames,
+      (double) ((float) _churn_frames / _churn_calls),
+      _churn_max_batch,
+      (unsigned int) _churn_overruns
+    );
+    output->concatf("-- Duty cycle:\t %.2f%%  (%u us busy)\n",
+      (double) ((_churn_wall_us > 0) ? ((100.0f * _churn_busy_us) / _churn_wall_us) : 0.0f),
+      (unsigned int) _churn_busy_us
+    );
+  }
+  if (_jit_n > 0) {
+    output->concatf("-- Frame interval:\t mean %.1fus  stddev %.1fus  min %uus  max %uus  (%u intervals)\n",
+      (double) _jit_mean,
+      (double) ((_jit_n > 1) ? sqrt(_jit_m2 / (_jit_n - 1)) : 0.0f),
+      (unsigned int) _jit_min,
+      (unsigned int) _jit_max,
+      (unsigned int) _jit_n
+    );
+    output->concatf("-- Worst dt error:\t %.1fus\n", (double) _dt_err_max);
+  }
   if (verbosity > 2) {
     if (verbosity > 3) output->concatf("-- GyroMeasDrift:    %.4f\n",  (double) GyroMeasDrift);
     output->concatf("-- Gravity: %.4G (%.4f, %.4f, %.4f)\n", (double) (grav_scalar), (double)(_grav.x), (double)(_grav.y), (double)(_grav.z));
@@ -222,38 +493,318 @@ void Integrator::printDebug(StringBuilder* output) {
   }
   grav_consensus /= 17;
   //output->concatf("-- Gravity consensus:  %.4fg\n",  (double) grav_consensus);
+  if (verbosity > 4) {
+    for (uint8_t i = 0; i < INTEGRATOR_IMU_COUNT; i++) {
+      const FilterState* s = &_state[i];
+      if (0 != s->t_last_us) {
+        output->concatf("-- IMU %2u:  Q(%.4f, %.4f, %.4f, %.4f)  bias(%.3f, %.3f, %.3f)\n", i,
+          (double) s->q[0], (double) s->q[1], (double) s->q[2], (double) s->q[3],
+          (double) s->gyro_bias.x, (double) s->gyro_bias.y, (double) s->gyro_bias.z
+        );
+      }
+    }
+  }
   output->concat("\n");
 }
 
 
+/**
+* Fills a frame with made-up samples for benchKernels(). Every IMU takes part,
+*   save one that sits out every other frame. One has no accelerometer data,
+*   and one has a magnetometer reading too large to be the Earth's.
+*
+* @param  f  The frame to fill.
+* @param  x  xorshift32 state.
+* @param  n  The frame's number in the run.
+*/
+static void _fill_bench_frame(SensorFrame* f, uint32_t* x, uint32_t n) {
+  uint32_t fresh = 0;
+  f->wipe();
+  f->time(INTEGRATOR_BENCH_DT_US * 1e-6f);
+  f->captureTime((uint64_t) (n + 1) * INTEGRATOR_BENCH_DT_US);
+  for (uint8_t i = 0; i < INTEGRATOR_IMU_COUNT; i++) {
+    float v[9];
+    for (uint8_t j = 0; j < 9; j++) {
+      *x ^= *x << 13;  *x ^= *x >> 17;  *x ^= *x << 5;   // xorshift32
+      v[j] = ((int32_t) *x) / 2147483648.0f;
+    }
+    if ((11 == i) && (n & 1)) continue;
+    if (3 == i) {
+      v[0] = 0.0f;
+      v[1] = 0.0f;
+      v[2] = 0.0f;
+    }
+    f->setI(i, v[0] * 2.0f, v[1] * 2.0f, v[2] * 2.0f, v[3] * 200.0f, v[4] * 200.0f, v[5] * 200.0f);
+    if (5 == i) {
+      f->setM(i, 3.0f, 0.0f, 0.0f);
+    }
+    else {
+      f->setM(i, v[6] * 0.6f, v[7] * 0.6f, v[8] * 0.6f);
+    }
+    if (0 == ((n + i) % 3)) fresh |= (1UL << i);
+  }
+  f->magFresh(fresh);
+}
+
+
+/**
+* Runs both kernels over the same run of made-up frames, from the same start,
+*   and reports what each costs per frame and how far apart their results
+*   ended up. The filter's state is put back afterward.
+*
+* @param  frame       A frame to work in. It is clobbered.
+* @param  output      The buffer to receive the results.
+* @param  iterations  How many frames to integrate with each kernel.
+*/
+void Integrator::benchKernels(SensorFrame* frame, StringBuilder* output, uint32_t iterations) {
+  FilterState saved[INTEGRATOR_IMU_COUNT];
+  const uint32_t saved_9dof = _updates_9dof;
+  const uint32_t saved_6dof = _updates_6dof;
+  float    q_out[2][INTEGRATOR_IMU_COUNT][4];
+  uint32_t t_total[2] = {0, 0};
+  if (0 == iterations) return;
+  if (threaded()) {
+    // The worker owns the filter state.
+    output->concat("Kernel benchmark can't run while the integrator's worker does.\n");
+    return;
+  }
+  memcpy(saved, _state, sizeof(_state));
+
+  for (uint8_t k = 0; k < 2; k++) {
+    uint32_t x = 0x2545F491;
+    for (uint8_t i = 0; i < INTEGRATOR_IMU_COUNT; i++) {
+      _state[i].q[0] = 1.0f;
+      _state[i].q[1] = 0.0f;
+      _state[i].q[2] = 0.0f;
+      _state[i].q[3] = 0.0f;
+      _state[i].t_last_us = 0;
+    }
+    for (uint32_t n = 0; n < iterations; n++) {
+      _fill_bench_frame(frame, &x, n);
+      const uint64_t t_prev = (uint64_t) n * INTEGRATOR_BENCH_DT_US;
+      const uint32_t t0 = micros();
+      if (0 == k) {
+        _integrate_with<MadgwickFusion>(frame, frame->imuMask(), t_prev);
+      }
+      else {
+        _integrate_lanes(frame, frame->imuMask(), t_prev);
+      }
+      t_total[k] += micros() - t0;
+    }
+    for (uint8_t i = 0; i < INTEGRATOR_IMU_COUNT; i++) {
+      memcpy(q_out[k][i], _state[i].q, sizeof(_state[i].q));
+    }
+  }
+
+  memcpy(_state, saved, sizeof(_state));
+  _updates_9dof = saved_9dof;
+  _updates_6dof = saved_6dof;
+
+  float worst = 0.0f;
+  for (uint8_t i = 0; i < INTEGRATOR_IMU_COUNT; i++) {
+    for (uint8_t j = 0; j < 4; j++) {
+      const float d = fabsf(q_out[0][i][j] - q_out[1][i][j]);
+      if (d > worst) worst = d;
+    }
+  }
+  output->concatf("Madgwick kernels, %u frames of %u IMUs, %u iterations each:\n",
+    (unsigned int) iterations, INTEGRATOR_IMU_COUNT, _cfg.params.iterations
+  );
+  output->concatf("\tScalar          %u us total  (%u ns/frame)\n", (unsigned int) t_total[0], (unsigned int) (((uint64_t) t_total[0] * 1000) / iterations));
+  output->concatf("\tLanes (%s)\t%u us total  (%u ns/frame)\n", madgwick_soa_isa(), (unsigned int) t_total[1], (unsigned int) (((uint64_t) t_total[1] * 1000) / iterations));
+  output->concatf("\tWorst difference  %.9f\n", (double) worst);
+}
+
+
+/*
+* A filter that does nothing. benchFilters() times it, to find what the
+*   simulation costs without a filter.
+*/
+class NoFusion {
+  public:
+    static inline const char* name() {   return "none";   };
+    static inline void reset(FusionAux*) {};
+    static inline bool update(float*, FusionAux*, const FusionInput*, const FusionParams*) {   return false;   };
+};
+
+
+/* Roughly normal, with unit variance. Sum of four uniforms. */
+static float _bench_noise(uint32_t* x) {
+  float s = 0.0f;
+  for (uint8_t i = 0; i < 4; i++) {
+    *x ^= *x << 13;  *x ^= *x >> 17;  *x ^= *x << 5;   // xorshift32
+    s += ((int32_t) *x) / 2147483648.0f;
+  }
+  return s * 0.866f;
+}
+
 
 /**
-* Taken from
-* https://github.com/kriswiner/LSM9DS1/blob/master/Teensy3.1/LSM9DS1-MS5637/quaternionFilters.ino
+* Runs a filter over a simulated IMU, and measures its error against the truth.
+*   The IMU swings about all three axes at once. Its gyro has a bias and noise,
+*   its accelerometer and magnetometer have noise, and the magnetometer updates
+*   on every fourth sample. The filter starts 30 degrees off.
+*
+* @param  p        The gains.
+* @param  samples  How many samples, at 100Hz.
+* @param  rms      Receives the RMS error over the second half, in degrees.
+* @param  worst    Receives the worst error over the second half, in degrees.
+* @return Microseconds spent, in all.
 */
-// There is a tradeoff in the beta parameter between accuracy and response speed.
-// In the original Madgwick study, beta of 0.041 (corresponding to GyroMeasError of 2.7 degrees/s) was found to give optimal accuracy.
-// However, with this value, the LSM9SD0 response time is about 10 seconds to a stable initial quaternion.
-// Subsequent changes also require a longish lag time to a stable output, not fast enough for a quadcopter or robot car!
-// By increasing beta (GyroMeasError) by about a factor of fifteen, the response time constant is reduced to ~2 sec
-// I haven't noticed any reduction in solution accuracy. This is essentially the I coefficient in a PID control sense;
-// the bigger the feedback coefficient, the faster the solution converges, usually at the expense of accuracy.
-// In any case, this is the free parameter in the Madgwick filtering and fusion scheme.
-//const float Integrator::beta = ((float)sqrt(3.0f / 4.0f)) * Integrator::GyroMeasError;   // compute beta
+template <class F> static uint32_t _bench_filter(const FusionParams* p, uint32_t samples, float* rms, float* worst) {
+  const float dt      = 0.01f;
+  const float bias[3] = {0.01f, -0.008f, 0.005f};  // rad/s
+  const float field[3] = {0.765f, 0.0f, -0.644f};  // Earth frame, normalized.
+  float q_t[4] = {0.9659f, 0.2588f, 0.0f, 0.0f};   // The truth.
+  float q_e[4] = {1.0f, 0.0f, 0.0f, 0.0f};         // The estimate.
+  float se     = 0.0f;
+  uint32_t x   = 0x2545F491;
+  FusionAux   aux;
+  FusionInput in;
+  F::reset(&aux);
+  *worst = 0.0f;
+
+  const uint32_t t0 = micros();
+  for (uint32_t n = 0; n < samples; n++) {
+    const float t = n * dt;
+    const float w[3] = { sinf(2.1f * t), 0.8f * cosf(1.3f * t), 0.6f * sinf(0.7f * t + 1.0f) };
+    for (uint8_t k = 0; k < 10; k++) {
+      const float hx = 0.05f * w[0] * dt;
+      const float hy = 0.05f * w[1] * dt;
+      const float hz = 0.05f * w[2] * dt;
+      const float n0 = q_t[0] - q_t[1] * hx - q_t[2] * hy - q_t[3] * hz;
+      const float n1 = q_t[1] + q_t[0] * hx + q_t[2] * hz - q_t[3] * hy;
+      const float n2 = q_t[2] + q_t[0] * hy - q_t[1] * hz + q_t[3] * hx;
+      const float n3 = q_t[3] + q_t[0] * hz + q_t[1] * hy - q_t[2] * hx;
+      const float norm = 1.0f / sqrtf(n0 * n0 + n1 * n1 + n2 * n2 + n3 * n3);
+      q_t[0] = n0 * norm;
+      q_t[1] = n1 * norm;
+      q_t[2] = n2 * norm;
+      q_t[3] = n3 * norm;
+    }
+    // The first and third rows of the truth's rotation matrix.
+    const float r0[3] = {
+      q_t[0] * q_t[0] + q_t[1] * q_t[1] - q_t[2] * q_t[2] - q_t[3] * q_t[3],
+      2.0f * (q_t[1] * q_t[2] - q_t[0] * q_t[3]),
+      2.0f * (q_t[1] * q_t[3] + q_t[0] * q_t[2])
+    };
+    const float r2[3] = {
+      2.0f * (q_t[1] * q_t[3] - q_t[0] * q_t[2]),
+      2.0f * (q_t[2] * q_t[3] + q_t[0] * q_t[1]),
+      q_t[0] * q_t[0] - q_t[1] * q_t[1] - q_t[2] * q_t[2] + q_t[3] * q_t[3]
+    };
+    in.gx = w[0] + bias[0] + 0.005f * _bench_noise(&x);
+    in.gy = w[1] + bias[1] + 0.005f * _bench_noise(&x);
+    in.gz = w[2] + bias[2] + 0.005f * _bench_noise(&x);
+    Vector3<float> a(r2[0] + 0.02f * _bench_noise(&x), r2[1] + 0.02f * _bench_noise(&x), r2[2] + 0.02f * _bench_noise(&x));
+    a.normalize();
+    in.ax = a.x;
+    in.ay = a.y;
+    in.az = a.z;
+    if (0 == (n & 3)) {
+      Vector3<float> m(
+        r0[0] * field[0] + r2[0] * field[2] + 0.02f * _bench_noise(&x),
+        r0[1] * field[0] + r2[1] * field[2] + 0.02f * _bench_noise(&x),
+        r0[2] * field[0] + r2[2] * field[2] + 0.02f * _bench_noise(&x)
+      );
+      m.normalize();
+      in.mx = m.x;
+      in.my = m.y;
+      in.mz = m.z;
+    }
+    else {
+      in.mx = 0.0f;
+      in.my = 0.0f;
+      in.mz = 0.0f;
+    }
+    in.dt = dt;
+
+    F::update(q_e, &aux, &in, p);
+
+    if (n >= (samples >> 1)) {
+      float d = fabsf(q_e[0] * q_t[0] + q_e[1] * q_t[1] + q_e[2] * q_t[2] + q_e[3] * q_t[3]);
+      if (d > 1.0f) d = 1.0f;
+      const float err = 2.0f * acosf(d) * (180.0f / 3.14159f);
+      se += err * err;
+      if (err > *worst) *worst = err;
+    }
+  }
+  const uint32_t t1 = micros();
+  *rms = sqrtf(se / (samples - (samples >> 1)));
+  return (t1 - t0);
+}
+
+
+/**
+* Runs each filter, with our gains, over the same simulated IMU. Reports what
+*   an update costs, and how far from the truth each filter stays.
+*
+* @param  output   The buffer to receive the results.
+* @param  samples  How many samples to simulate.
+*/
+void Integrator::benchFilters(StringBuilder* output, uint32_t samples) {
+  float rms;
+  float worst;
+  if (2 > samples) return;
+  const uint32_t t_sim = _bench_filter<NoFusion>(&_cfg_k.params, samples, &rms, &worst);
+  output->concatf("Fusion filters, %u simulated samples at 100Hz (%u ns/sample to simulate):\n",
+    (unsigned int) samples, (unsigned int) (((uint64_t) t_sim * 1000) / samples)
+  );
+  for (uint8_t i = 0; i < 3; i++) {
+    uint32_t t_run = 0;
+    const char* name = "";
+    switch (i) {
+      case 0:  t_run = _bench_filter<MadgwickFusion>(&_cfg_k.params, samples, &rms, &worst);  name = MadgwickFusion::name();  break;
+      case 1:  t_run = _bench_filter<MahonyFusion>(&_cfg_k.params, samples, &rms, &worst);    name = MahonyFusion::name();    break;
+      case 2:  t_run = _bench_filter<EskfFusion>(&_cfg_k.params, samples, &rms, &worst);      name = EskfFusion::name();      break;
+    }
+    const uint32_t t_net = (t_run > t_sim) ? (t_run - t_sim) : 0;
+    output->concatf("\t%-9s %5u ns/update   error %.3f deg RMS, %.3f deg worst\n",
+      name,
+      (unsigned int) (((uint64_t) t_net * 1000) / samples),
+      (double) rms, (double) worst
+    );
+  }
+}
+
+
+
+/**
+* Measures the interval between this frame's capture time and the last one,
+*   and how far the frame's dt is from it.
+*
+* @param  frame  The frame about to be integrated.
+*/
+void Integrator::_note_timing(SensorFrame* frame) {
+  const uint64_t t = frame->captureTime();
+  if ((0 != _t_last_us) && (t > _t_last_us)) {
+    const uint32_t iv    = (uint32_t) (t - _t_last_us);
+    const float    delta = iv - _jit_mean;
+    _jit_n++;
+    _jit_mean += delta / _jit_n;
+    _jit_m2   += delta * (iv - _jit_mean);
+    if (iv < _jit_min) _jit_min = iv;
+    if (iv > _jit_max) _jit_max = iv;
+    const float err = fabsf((frame->time() * 1e6f) - iv);
+    if (err > _dt_err_max) _dt_err_max = err;
+  }
+  _t_last_us = t;
+}
 
 
 /**
 * This ought to be the only place where we promote vectors into the last_read position. Otherwise, there
 *   shall be chaos as several different systems rely on that data member being synchronized WRT to the _ptr_quat->
 */
-uint8_t Integrator::MadgwickQuaternionUpdate() {
-  SensorFrame* c_frame = _pending.get();
-  if (c_frame) {
-    float d_t = c_frame->time();
+uint8_t Integrator::_integrate_next() {
+  SensorFrame* c_frame = nullptr;
+  if (_pending.get(&c_frame)) {
+    const uint64_t t_prev = _t_last_us;   // Capture time of the frame before.
+    _note_timing(c_frame);
 
     #if defined(MANUVR_DEBUG)
-    if (verbosity > 6) {
-      local_log.concatf("At delta-t = %f: ", (double)d_t);
+    if ((verbosity > 6) && !threaded()) {
+      local_log.concatf("At delta-t = %f: ", (double) c_frame->time());
         //c_frame->printDebug(&local_log);
         //local_log.concat("\t");
         //c_frame->quats[set_i]->printDebug(&local_log);
@@ -262,258 +813,304 @@ uint8_t Integrator::MadgwickQuaternionUpdate() {
     }
     #endif
 
-    float q0;
-    float q1;
-    float q2;
-    float q3;
-
-    float norm;
-    float s0, s1, s2, s3;
-    float qDot1, qDot2, qDot3, qDot4;
-    float hx, hy;
-    float _2q0mx, _2q0my, _2q0mz, _2q1mx, _2bx, _2bz, _4bx, _4bz, _2q0, _2q1, _2q2, _2q3, q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
-
-    // Normalise mag c_frame
-    float mag_normal;
-
-    // Now we'll start the float churn...
-    for (uint8_t set_i = 0; set_i < LEGEND_DATASET_IIU_COUNT; set_i++) {
-      q0 = c_frame->quat[set_i].w;
-      q1 = c_frame->quat[set_i].x;
-      q2 = c_frame->quat[set_i].y;
-      q3 = c_frame->quat[set_i].z;
-      mag_normal = (c_frame->m_data[set_i]).normalize();
-
-      if (dropObviousBadMag() && (mag_normal >= mag_discard_threshold)) {
-        // We defer to the algorithm that does not use the non-earth mag data.
-        for (int i = 0; i < madgwick_iterations; i++) {
-          MadgwickAHRSupdateIMU(c_frame);
-        }
-      }
-      else if (0.0f == mag_normal) {
-        // We defer to the algorithm that does not use the absent mag data.
-        for (int i = 0; i < madgwick_iterations; i++) {
-          MadgwickAHRSupdateIMU(c_frame);
-        }
-      }
-      else {
-        float gx = (c_frame->g_data[set_i]).x * IIU_DEG_TO_RAD_SCALAR;
-        float gy = (c_frame->g_data[set_i]).y * IIU_DEG_TO_RAD_SCALAR;
-        float gz = (c_frame->g_data[set_i]).z * IIU_DEG_TO_RAD_SCALAR;
-
-        for (int i = 0; i < madgwick_iterations; i++) {
-          // Rate of change of quaternion from gyroscope
-          qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
-          qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
-          qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
-          qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
-
-          // Normalise accelerometer c_frame-> If vector is non-zero, integrate it...
-          if (0.0f != (c_frame->a_data[set_i]).normalize()) {
-            float mx = (c_frame->m_data[set_i]).x;
-            float my = (c_frame->m_data[set_i]).y;
-            float mz = (c_frame->m_data[set_i]).z;
-
-            float ax = (c_frame->a_data[set_i]).x;
-            float ay = (c_frame->a_data[set_i]).y;
-            float az = (c_frame->a_data[set_i]).z;
-
-            // Auxiliary variables to avoid repeated arithmetic
-            _2q0mx = 2.0f * q0 * mx;
-            _2q0my = 2.0f * q0 * my;
-            _2q0mz = 2.0f * q0 * mz;
-            _2q1mx = 2.0f * q1 * mx;
-            _2q0 = 2.0f * q0;
-            _2q1 = 2.0f * q1;
-            _2q2 = 2.0f * q2;
-            _2q3 = 2.0f * q3;
-            q0q0 = q0 * q0;
-            q0q1 = q0 * q1;
-            q0q2 = q0 * q2;
-            q0q3 = q0 * q3;
-            q1q1 = q1 * q1;
-            q1q2 = q1 * q2;
-            q1q3 = q1 * q3;
-            q2q2 = q2 * q2;
-            q2q3 = q2 * q3;
-            q3q3 = q3 * q3;
-
-            // Reference direction of Earth's magnetic field
-            hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
-            hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
-            _2bx = sqrt(hx * hx + hy * hy);
-            _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
-            _4bx = 2.0f * _2bx;
-            _4bz = 2.0f * _2bz;
-            float _8bx = 2.0f * _4bx;
-            float _8bz = 2.0f * _4bz;
-
-            // Gradient decent algorithm corrective step
-            s0 = -_2q2*(2*(q1q3 - q0q2) - ax) + _2q1*(2*(q0q1 + q2q3) - ay) +  -_4bz*q2*(_4bx*(0.5 - q2q2 - q3q3) + _4bz*(q1q3 - q0q2) - mx)   +   (-_4bx*q3+_4bz*q1)*(_4bx*(q1q2 - q0q3) + _4bz*(q0q1 + q2q3) - my)    +   _4bx*q2*(_4bx*(q0q2 + q1q3) + _4bz*(0.5 - q1q1 - q2q2) - mz);
-            s1 = _2q3*(2*(q1q3 - q0q2) - ax)  + _2q0*(2*(q0q1 + q2q3) - ay) + -4*q1*(2*(0.5 - q1q1 - q2q2) - az)    +   _4bz*q3*(_4bx*(0.5 - q2q2 - q3q3) + _4bz*(q1q3 - q0q2) - mx)   + (_4bx*q2+_4bz*q0)*(_4bx*(q1q2 - q0q3) + _4bz*(q0q1 + q2q3) - my)   +   (_4bx*q3-_8bz*q1)*(_4bx*(q0q2 + q1q3) + _4bz*(0.5 - q1q1 - q2q2) - mz);
-            s2 = -_2q0*(2*(q1q3 - q0q2) - ax) + _2q3*(2*(q0q1 + q2q3) - ay) + (-4*q2)*(2*(0.5 - q1q1 - q2q2) - az) +   (-_8bx*q2-_4bz*q0)*(_4bx*(0.5 - q2q2 - q3q3) + _4bz*(q1q3 - q0q2) - mx)+(_4bx*q1+_4bz*q3)*(_4bx*(q1q2 - q0q3) + _4bz*(q0q1 + q2q3) - my)+(_4bx*q0-_8bz*q2)*(_4bx*(q0q2 + q1q3) + _4bz*(0.5 - q1q1 - q2q2) - mz);
-            s3 = _2q1*(2*(q1q3 - q0q2) - ax)  + _2q2*(2*(q0q1 + q2q3) - ay) + (-_8bx*q3+_4bz*q1)*(_4bx*(0.5 - q2q2 - q3q3) + _4bz*(q1q3 - q0q2) - mx)+(-_4bx*q0+_4bz*q2)*(_4bx*(q1q2 - q0q3) + _4bz*(q0q1 + q2q3) - my)+(_4bx*q1)*(_4bx*(q0q2 + q1q3) + _4bz*(0.5 - q1q1 - q2q2) - mz);
-
-            norm = 1.0f / (float) sqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3); // normalise step magnitude
-
-            // Apply feedback step
-            qDot1 -= beta * (s0 * norm);
-            qDot2 -= beta * (s1 * norm);
-            qDot3 -= beta * (s2 * norm);
-            qDot4 -= beta * (s3 * norm);
-
-            // Integrate rate of change of quaternion to yield quaternion
-            q0 += qDot1 * d_t;
-            q1 += qDot2 * d_t;
-            q2 += qDot3 * d_t;
-            q3 += qDot4 * d_t;
-
-            // Normalise quaternion
-            norm = 1.0f / (float) sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q0 * q0);    // normalise quaternion
-            q0 = q0 * norm;
-            q1 = q1 * norm;
-            q2 = q2 * norm;
-            q3 = q3 * norm;
-
-            c_frame->setO(set_i, q0, q1, q2, q3);
+    // Only the IMUs that are both in the frame, and wanted.
+    const uint32_t imus = c_frame->imuMask() & _demand.orientation;
+    _imus_idle += __builtin_popcount(c_frame->imuMask() & ~imus);
+    if (0 != imus) {
+      switch (_select_filter()) {
+        case FusionFilter::MAHONY:
+          _integrate_with<MahonyFusion>(c_frame, imus, t_prev);
+          break;
+        case FusionFilter::ESKF:
+          _integrate_with<EskfFusion>(c_frame, imus, t_prev);
+          break;
+        default:
+          if (_cfg.lanes) {
+            _integrate_lanes(c_frame, imus, t_prev);
           }
-        }
-      }
-
-      if (c_frame->accNullGravity(set_i)) {
-        /* If we are going to cancel gravity, we should do so now. */
-        _grav.x = (2 * (q1 * q3 - q0 * q2));
-        _grav.y = (2 * (q0 * q1 + q2 * q3));
-        _grav.z = (q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3);
-
-        c_frame->setN(set_i,
-          (c_frame->a_data[set_i]).x - _grav.x,
-          (c_frame->a_data[set_i]).y - _grav.y,
-          (c_frame->a_data[set_i]).z - _grav.z
-        );
-
-        if (c_frame->velocity(set_i)) {
-          // Are we finding velocity?
-          c_frame->setV(set_i,
-            c_frame->n_data[set_i].x * d_t,
-            c_frame->n_data[set_i].y * d_t,
-            c_frame->n_data[set_i].z * d_t
-          );
-
-          if (c_frame->position(set_i)) {
-            // Track position....
-            c_frame->setP(set_i,
-              c_frame->v_data[set_i].x * d_t,
-              c_frame->v_data[set_i].y * d_t,
-              c_frame->v_data[set_i].z * d_t
-            );
+          else {
+            _integrate_with<MadgwickFusion>(c_frame, imus, t_prev);
           }
-        }
+          break;
+      }
+      if (_demand.hand) {
+        _solve_hand(c_frame);
       }
     }
     c_frame->markComplete();
-    if (_complete.insert(c_frame)) {
-      local_log.concat("Dropped a frame in the integrator. This is probably a leak.\n");
-    }
+    // churn() only integrates when there is room in _complete.
+    _complete.insert(c_frame);
     _frames_completed++;
   }
 
-  if (local_log.length() > 0) Kernel::log(&local_log);
+  // The kernel's log isn't ours to touch from the worker.
+  if ((local_log.length() > 0) && !threaded()) Kernel::log(&local_log);
   return 1;
 }
 
-//---------------------------------------------------------------------------------------------------
-// IMU algorithm update
-
-void Integrator::MadgwickAHRSupdateIMU(SensorFrame* c_frame) {
-  float norm;
-  float s0, s1, s2, s3;
-  float qDot1, qDot2, qDot3, qDot4;
-  float _2q0, _2q1, _2q2, _2q3, _4q0, _4q1, _4q2 ,_8q1, _8q2, q0q0, q1q1, q2q2, q3q3;
-
-  float q0;
-  float q1;
-  float q2;
-  float q3;
-
-  float gx;
-  float gy;
-  float gz;
-
-  for (int set_i = 0; set_i < LEGEND_DATASET_IIU_COUNT; set_i++) {
-    q0 = c_frame->quat[set_i].w;
-    q1 = c_frame->quat[set_i].x;
-    q2 = c_frame->quat[set_i].y,
-    q3 = c_frame->quat[set_i].z;
-
-    gx = (c_frame->g_data[set_i]).x * IIU_DEG_TO_RAD_SCALAR;
-    gy = (c_frame->g_data[set_i]).y * IIU_DEG_TO_RAD_SCALAR;
-    gz = (c_frame->g_data[set_i]).z * IIU_DEG_TO_RAD_SCALAR;
-    float d_t = c_frame->time();
-
-    // Rate of change of quaternion from gyroscope
-    qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
-    qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
-    qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
-    qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
-
-    // Normalise accelerometer c_frame-> If vector is non-zero, integrate it...
-    if (0.0f != (c_frame->a_data[set_i]).normalize()) {
-      float ax = (c_frame->a_data[set_i]).x;
-      float ay = (c_frame->a_data[set_i]).y;
-      float az = (c_frame->a_data[set_i]).z;
-      // Auxiliary variables to avoid repeated arithmetic
-      _2q0 = 2.0f * q0;
-      _2q1 = 2.0f * q1;
-      _2q2 = 2.0f * q2;
-      _2q3 = 2.0f * q3;
-      _4q0 = 4.0f * q0;
-      _4q1 = 4.0f * q1;
-      _4q2 = 4.0f * q2;
-      _8q1 = 8.0f * q1;
-      _8q2 = 8.0f * q2;
-      q0q0 = q0 * q0;
-      q1q1 = q1 * q1;
-      q2q2 = q2 * q2;
-      q3q3 = q3 * q3;
-
-      // Gradient decent algorithm corrective step
-      s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
-      s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
-      s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
-      s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
-
-      norm = 1.0f / (float) sqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3); // normalise step magnitude
-      s0 *= norm;
-      s1 *= norm;
-      s2 *= norm;
-      s3 *= norm;
-
-      // Apply feedback step
-      qDot1 -= beta * s0;
-      qDot2 -= beta * s1;
-      qDot3 -= beta * s2;
-      qDot4 -= beta * s3;
+
+/**
+* The time step for one IMU in this frame. An IMU that sat out the frames since
+*   its last sample is owed more than the frame's own dt. Its own timestamps
+*   say how much.
+*
+* @param  c_frame  The frame being integrated.
+* @param  s        The IMU's filter state.
+* @param  t_prev   Capture time of the frame before this one.
+* @return The time step, in seconds.
+*/
+float Integrator::_imu_dt(SensorFrame* c_frame, const FilterState* s, uint64_t t_prev) {
+  if ((0 != s->t_last_us) && (s->t_last_us != t_prev) && (c_frame->captureTime() > s->t_last_us)) {
+    return (c_frame->captureTime() - s->t_last_us) * 1e-6f;
+  }
+  return c_frame->time();
+}
+
+
+/**
+* Integrates a frame one IMU at a time, with the given filter. The frame's
+*   accelerometer samples (and fresh magnetometer samples) are left normalized.
+*
+* @param  c_frame  The frame to integrate.
+* @param  imus     The IMUs to integrate. Only ones the frame carries.
+* @param  t_prev   Capture time of the frame before this one.
+*/
+template <class F> void Integrator::_integrate_with(SensorFrame* c_frame, uint32_t imus, uint64_t t_prev) {
+  FusionInput in;
+  for (; 0 != imus; imus &= (imus - 1)) {
+    const uint8_t set_i = (uint8_t) __builtin_ctz(imus);
+    FilterState* s = &_state[set_i];
+    const Vector3<float>& g = c_frame->gyro(set_i);
+    Vector3<float>& a = c_frame->acc(set_i);
+    in.gx = (g.x - s->gyro_bias.x) * IIU_DEG_TO_RAD_SCALAR;
+    in.gy = (g.y - s->gyro_bias.y) * IIU_DEG_TO_RAD_SCALAR;
+    in.gz = (g.z - s->gyro_bias.z) * IIU_DEG_TO_RAD_SCALAR;
+    a.normalize();
+    in.ax = a.x;
+    in.ay = a.y;
+    in.az = a.z;
+
+    // A held magnetometer sample has already been fused. Fusing it again
+    //   would only cost time, and weight it unduly. So it is treated as absent.
+    //   So is one too large to be the Earth's field, if we are asked to drop those.
+    const float mag_normal = c_frame->magFresh(set_i) ? c_frame->mag(set_i).normalize() : 0.0f;
+    if ((0.0f == mag_normal) || ((_cfg.flags & IIU_DATA_HANDLING_SMART_MAG_DROP) && (mag_normal >= _cfg.mag_discard))) {
+      in.mx = 0.0f;
+      in.my = 0.0f;
+      in.mz = 0.0f;
+    }
+    else {
+      const Vector3<float>& m = c_frame->mag(set_i);
+      in.mx = m.x;
+      in.my = m.y;
+      in.mz = m.z;
+    }
+    in.dt = _imu_dt(c_frame, s, t_prev);
+
+    if (F::update(s->q, &_aux[set_i], &in, &_cfg.params)) {
+      _updates_9dof++;
+    }
+    else {
+      _updates_6dof++;
+    }
+    _post_update(c_frame, set_i, in.dt);
+  }
+}
+
+
+/**
+* Integrates a frame with all of its IMUs in lanes, four at a time. The IMUs
+*   are packed into consecutive lanes, so a frame with few IMUs costs few
+*   groups. Madgwick's filter only. The results match MadgwickFusion, to rounding.
+*
+* @param  c_frame  The frame to integrate.
+* @param  imus     The IMUs to integrate. Only ones the frame carries.
+* @param  t_prev   Capture time of the frame before this one.
+*/
+void Integrator::_integrate_lanes(SensorFrame* c_frame, uint32_t imus, uint64_t t_prev) {
+  uint8_t n = 0;
+  for (; 0 != imus; imus &= (imus - 1)) {
+    const uint8_t set_i = (uint8_t) __builtin_ctz(imus);
+    const FilterState* s = &_state[set_i];
+    const Vector3<float>& g = c_frame->gyro(set_i);
+    const Vector3<float>& a = c_frame->acc(set_i);
+    _lane_imu[n] = set_i;
+    _lanes.q0[n] = s->q[0];
+    _lanes.q1[n] = s->q[1];
+    _lanes.q2[n] = s->q[2];
+    _lanes.q3[n] = s->q[3];
+    _lanes.gx[n] = (g.x - s->gyro_bias.x) * IIU_DEG_TO_RAD_SCALAR;
+    _lanes.gy[n] = (g.y - s->gyro_bias.y) * IIU_DEG_TO_RAD_SCALAR;
+    _lanes.gz[n] = (g.z - s->gyro_bias.z) * IIU_DEG_TO_RAD_SCALAR;
+    _lanes.ax[n] = a.x;
+    _lanes.ay[n] = a.y;
+    _lanes.az[n] = a.z;
+    if (c_frame->magFresh(set_i)) {
+      const Vector3<float>& m = c_frame->mag(set_i);
+      _lanes.mx[n] = m.x;
+      _lanes.my[n] = m.y;
+      _lanes.mz[n] = m.z;
+      _lanes.fresh[n] = 1.0f;
+    }
+    else {
+      // A held sample has already been fused. See _integrate_with().
+      _lanes.mx[n] = 0.0f;
+      _lanes.my[n] = 0.0f;
+      _lanes.mz[n] = 0.0f;
+      _lanes.fresh[n] = 0.0f;
+    }
+    _lanes.dt[n] = _imu_dt(c_frame, s, t_prev);
+    n++;
+  }
+  if (0 == n) return;
+  for (uint8_t i = n; 0 != (i & 3); i++) madgwick_soa_pad(&_lanes, i);
+
+  madgwick_soa(&_lanes, n, _cfg.params.beta, _cfg.params.iterations, (_cfg.flags & IIU_DATA_HANDLING_SMART_MAG_DROP), _cfg.mag_discard);
+
+  for (uint8_t i = 0; i < n; i++) {
+    const uint8_t set_i = _lane_imu[i];
+    FilterState* s = &_state[set_i];
+    s->q[0] = _lanes.q0[i];
+    s->q[1] = _lanes.q1[i];
+    s->q[2] = _lanes.q2[i];
+    s->q[3] = _lanes.q3[i];
+    // The scalar code leaves the samples normalized in the frame. So do we.
+    c_frame->acc(set_i)(_lanes.ax[i], _lanes.ay[i], _lanes.az[i]);
+    if (0.0f != _lanes.fresh[i]) {
+      c_frame->mag(set_i)(_lanes.mx[i], _lanes.my[i], _lanes.mz[i]);
+    }
+    if (0.0f != _lanes.nine[i]) {
+      _updates_9dof++;
     }
+    else {
+      _updates_6dof++;
+    }
+    _post_update(c_frame, set_i, _lanes.dt[i]);
+  }
+}
 
-    // Integrate rate of change of quaternion to yield quaternion
-    q0 += qDot1 * d_t;
-    q1 += qDot2 * d_t;
-    q2 += qDot3 * d_t;
-    q3 += qDot4 * d_t;
 
-    // Normalise quaternion
-    norm = 1.0f / (float) sqrt(q1 * q1 + q2 * q2 + q3 * q3 + q0 * q0);    // normalise quaternion
-    q0 = q0 * norm;
-    q1 = q1 * norm;
-    q2 = q2 * norm;
-    q3 = q3 * norm;
+/**
+* After an IMU's orientation is updated: leave a snapshot of it in the frame,
+*   and find whatever is in demand that follows from it.
+*
+* @param  c_frame  The frame being integrated.
+* @param  set_i    The IMU.
+* @param  d_t      The time step the IMU was integrated over, in seconds.
+*/
+void Integrator::_post_update(SensorFrame* c_frame, uint8_t set_i, float d_t) {
+  FilterState* s = &_state[set_i];
+  const float q0 = s->q[0];
+  const float q1 = s->q[1];
+  const float q2 = s->q[2];
+  const float q3 = s->q[3];
+  c_frame->setO(set_i, q0, q1, q2, q3);
+  s->t_last_us = c_frame->captureTime();
+
+  const uint32_t bit = (1UL << set_i);
+  if (_demand.null_grav & bit) {
+    /* If we are going to cancel gravity, we should do so now. */
+    _grav.x = (2 * (q1 * q3 - q0 * q2));
+    _grav.y = (2 * (q0 * q1 + q2 * q3));
+    _grav.z = (q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3);
+
+    c_frame->setN(set_i,
+      c_frame->acc(set_i).x - _grav.x,
+      c_frame->acc(set_i).y - _grav.y,
+      c_frame->acc(set_i).z - _grav.z
+    );
+
+    if (_demand.velocity & bit) {
+      // Are we finding velocity?
+      s->vel.x += c_frame->nullGrav(set_i).x * d_t;
+      s->vel.y += c_frame->nullGrav(set_i).y * d_t;
+      s->vel.z += c_frame->nullGrav(set_i).z * d_t;
+
+      if (_demand.position & bit) {
+        // Track position....
+        s->pos.x += s->vel.x * d_t;
+        s->pos.y += s->vel.y * d_t;
+        s->pos.z += s->vel.z * d_t;
+      }
+    }
+  }
+}
+
+
+/**
+* Forward kinematics. Walks each digit out from the palm, bone by bone, to find
+*   its fingertip, and the angles of the joints along the way. See
+*   HandSkeleton.h for the conventions.
+* Uses the latest orientation of each IMU, whether or not it was in this frame.
+*   Digits without a known port, or without all three IMUs, are left out.
+*
+* @param  c_frame  The frame to write the pose into.
+*/
+void Integrator::_solve_hand(SensorFrame* c_frame) {
+  HandPose* pose = &c_frame->hand;
+  const HandSkeleton* skel = &_cfg.skel;
+  const float mirror = _demand.left_hand ? -1.0f : 1.0f;
+  const FilterState* root = &_state[0];
+  // The metacarpals IMU makes the better palm, if it is there.
+  const FilterState* palm = ((_demand.orientation & 0x02) && (0 != _state[1].t_last_us)) ? &_state[1] : root;
+
+  c_frame->hand_position(root->pos.x, root->pos.y, root->pos.z);
+  pose->digits = 0;
+  for (uint8_t j = 0; j < HAND_JOINT_COUNT; j++) {
+    pose->joints[j] = 0.0f;
+  }
+  for (uint8_t d = 0; d < HAND_DIGIT_COUNT; d++) {
+    pose->tip[d](0.0f, 0.0f, 0.0f);
+  }
+  if (palm != root) {
+    hand_joint(root->q, palm->q, mirror, &pose->joints[HAND_JOINT_WRIST], nullptr);
+  }
 
-    c_frame->setO(set_i, q0, q1, q2, q3);
+  for (uint8_t d = 0; d < HAND_DIGIT_COUNT; d++) {
+    const uint8_t port = _demand.digit_port[d];
+    if ((0 == port) || (HAND_DIGIT_COUNT < port)) continue;
+    const uint8_t imu = 2 + (3 * (port - 1));   // The digit's proximal IMU.
+    if (0x07 != ((_demand.orientation >> imu) & 0x07)) continue;
+    if ((0 == _state[imu].t_last_us) || (0 == _state[imu+1].t_last_us) || (0 == _state[imu+2].t_last_us)) continue;
+
+    const float base[3] = {skel->base[d][0], mirror * skel->base[d][1], skel->base[d][2]};
+    float tip[3];
+    hand_rotate(palm->q, base, tip);
+    const float* parent = palm->q;
+    for (uint8_t s = 0; s < HAND_SEGMENT_COUNT; s++) {
+      const float* q = _state[imu + s].q;
+      float axis[3];
+      hand_bone_axis(q, axis);
+      tip[0] += axis[0] * skel->bone[d][s];
+      tip[1] += axis[1] * skel->bone[d][s];
+      tip[2] += axis[2] * skel->bone[d][s];
+      // Abduction is only had at the base of the digit.
+      hand_joint(parent, q, mirror, &pose->joints[HAND_JOINT(d, s + 1)], ((0 == s) ? &pose->joints[HAND_JOINT(d, 0)] : nullptr));
+      parent = q;
+    }
+    pose->tip[d](root->pos.x + tip[0], root->pos.y + tip[1], root->pos.z + tip[2]);
+    pose->digits |= (1 << d);
   }
 }
 
 
+/**
+* Debug support method. Prints the bones of the skeleton.
+*
+* @param   StringBuilder* The buffer into which this fxn should write its output.
+*/
+void Integrator::printSkeleton(StringBuilder* output) {
+  const HandSkeleton* skel = &_cfg_k.skel;
+  output->concat("-- Hand skeleton (mm)\n\tDigit  Base                     Bones\n");
+  for (uint8_t d = 0; d < HAND_DIGIT_COUNT; d++) {
+    output->concatf("\t%u      (%6.1f, %6.1f, %6.1f)   %5.1f %5.1f %5.1f\n",
+      d + 1,
+      (double) (skel->base[d][0] * 1000), (double) (skel->base[d][1] * 1000), (double) (skel->base[d][2] * 1000),
+      (double) (skel->bone[d][0] * 1000), (double) (skel->bone[d][1] * 1000), (double) (skel->bone[d][2] * 1000)
+    );
+  }
+}
+
 int8_t Integrator::calibrate_from_data_ag() {
   //// Average vectors....
   //Vector3<int32_t> avg;
@@ -52,11 +52,16 @@ Error should be integrated here as well to form a set of limit error values for
 #define __INTEGRATOR_CLASS_H__
 
 #include <Platform/Platform.h>
+#include <DataStructures/Vector3.h>
 #include <DataStructures/Quaternion.h>
-#include <DataStructures/RingBuffer.h>
+#include "../SPSCRing.h"
+#include "MadgwickSoA.h"
+#include "FusionFilters.h"
+#include "HandSkeleton.h"
 
 // Forward dec
 class SensorFrame;
+class ManuLegend;
 
 
 #define IIU_DATA_HANDLING_UNITS_METRIC     0x01000000
@@ -68,6 +73,67 @@ class SensorFrame;
 #define IIU_DATA_HANDLING_SMART_MAG_DROP   0x40000000  // If enabled, causes a large magnetometer reading to be DQ'd from AHRS.
 #define IIU_DATA_HANDLING_CLEAN_MAG_ZERO   0x80000000  //
 
+// The orientation filter to run, unless a legend asks for another. Any of the
+//   FusionFilter names.
+#ifndef CONFIG_INTEGRATOR_FILTER
+  #define CONFIG_INTEGRATOR_FILTER  MADGWICK
+#endif
+
+// How many frames each of the Integrator's queues holds. The rings behind them
+//   keep one slot empty, so this must be one less than a power of two.
+#ifndef CONFIG_INTEGRATOR_Q_DEPTH
+  #define CONFIG_INTEGRATOR_Q_DEPTH  7
+#endif
+
+// How many IMUs the Integrator keeps state for. Matches LEGEND_DATASET_IIU_COUNT,
+//   which this header is included ahead of.
+#define INTEGRATOR_IMU_COUNT     17
+
+/*
+* Everything the filter carries from one frame to the next, for one IMU. The
+*   Integrator owns these, one per IMU, in one contiguous array. Frames are only
+*   its inputs, and snapshots of its output.
+* Each block starts on a cache line (32 bytes on the Cortex-M7), and takes two.
+*/
+typedef struct __attribute__ ((aligned (32))) {
+  float          q[4];        // Orientation (w, x, y, z).
+  Vector3<float> gyro_bias;   // Subtracted from the gyro, in its units (dps).
+  Vector3<float> vel;         // Only accumulated if the legend asks.
+  Vector3<float> pos;         // Only accumulated if the legend asks.
+  uint64_t       t_last_us;   // Capture time of the last sample fused. 0 if none.
+} FilterState;
+
+/*
+* Which IMUs need each of the Integrator's stages, so that some consumer gets
+*   what it asked for. Each mask has a bit per IMU. A stage's mask is a subset
+*   of the mask of the stage it follows from. See ManuLegend::compileDemand().
+*/
+typedef struct {
+  uint32_t     orientation;   // Run the orientation filter.
+  uint32_t     null_grav;     // Cancel gravity from the accelerometer.
+  uint32_t     velocity;      // Accumulate velocity.
+  uint32_t     position;      // Accumulate position.
+  FusionFilter filter;        // The filter asked for. DEFAULT if nobody cares.
+  bool         hand;          // Solve the hand skeleton.
+  bool         left_hand;     // Mirror the skeleton.
+  uint8_t      digit_port[HAND_DIGIT_COUNT];  // The port of each digit, thumb first. 0 if unknown.
+} IntegratorDemand;
+
+/*
+* How integration is to be done. The kernel changes its own copy, and the whole
+*   of it is passed along to integration, which takes it up between frames.
+*   So no frame is integrated with half of a change.
+*/
+typedef struct {
+  FusionParams params;        // The filters' gains.
+  FusionFilter filter;        // Unless a legend says otherwise.
+  bool         lanes;         // Integrate with the lane kernel?
+  HandSkeleton skel;          // The bones of the hand.
+  uint32_t     flags;         // IIU_DATA_HANDLING_* bits.
+  float        mag_discard;   // Mag samples this strong are dropped, in Gauss. See SMART_MAG_DROP.
+} IntegratorConfig;
+
+
 // This is Earth's gravity at sea-level, in m/s^2
 #define IIU_STANDARD_GRAVITY     9.80665f
 #define IIU_DEG_TO_RAD_SCALAR   (3.14159f / 180.0f)
@@ -88,7 +154,6 @@ enum class SampleType : uint8_t {
 
 class Integrator {
   public:
-    float beta;
     float grav_scalar = 0.0f;
 
     Integrator();
@@ -100,6 +165,13 @@ class Integrator {
 
     int8_t init();
     void reset();
+    void resetState(uint8_t imu);
+
+    /* The filter's state for the given IMU. */
+    inline const FilterState* state(uint8_t imu) {   return &_state[imu];   };
+    inline void gyroBias(uint8_t imu, float x, float y, float z) {
+      _state[imu].gyro_bias.set(x, y, z);
+    };
 
     /**
     * @return How many frames the integrator has processed.
@@ -107,89 +179,162 @@ class Integrator {
     inline uint32_t totalFrames() {  return _frames_completed;  };
 
     /**
+    * Only the kernel's context may push frames.
+    *
     * @param SensorFrame* The frame to be integrated.
     * @return non-zero on error.
     */
-    inline int8_t pushFrame(SensorFrame* x) {  return _pending.insert(x);  };
+    inline int8_t pushFrame(SensorFrame* x) {
+      if (_cfg_resend)    _config_changed();
+      if (_demand_resend) _demand_changed();
+      const int8_t ret = _pending.insert(x);
+      if (0 == ret) _worker_wake();
+      return ret;
+    };
+    inline bool         canAccept() {   return (_pending.count() < _pending.capacity());  };
+
+    /* Which inferred data to compute. See ManuLegend::compileDemand(). */
+    int8_t demand(const IntegratorDemand*);
+    inline const IntegratorDemand* demand() {   return &_demand_k;   };
+
+    /* The bones of the hand. Changes are taken up between frames. */
+    inline const HandSkeleton* skeleton() {          return &_cfg_k.skel;   };
+    inline void skeleton(const HandSkeleton* s) {    _cfg_k.skel = *s;  _config_changed();   };
+    void printSkeleton(StringBuilder*);
     /**
+    * Only the kernel's context may take results.
+    *
     * @return nullptr when empty.
     */
-    inline SensorFrame* takeResult() {         return _complete.get();        };
+    inline SensorFrame* takeResult() {
+      SensorFrame* ret = nullptr;
+      if (_complete.get(&ret)) _worker_wake();   // There is room for another.
+      return ret;
+    };
     inline unsigned int resultsWaiting() {     return _complete.count();      };
     inline bool         has_quats_left() {     return (_pending.count() > 0); };
-    int8_t churn();
+    int8_t churn(uint32_t budget_us, uint8_t max_frames);
+
+    /*
+    * The worker thread. While it runs, frames are integrated there, and churn()
+    *   must not be called from anywhere else.
+    */
+    int8_t startWorker();
+    int8_t stopWorker();
+    void   workerLoop();    // The worker's body. Not to be called otherwise.
+    inline bool threaded() {   return _worker_run.load(std::memory_order_acquire);   };
 
 
     /*
     * Accessors for profiling.
     * TODO: Inline these
     */
-    inline bool enableProfiling() {        return (data_handling_flags & IIU_DATA_HANDLING_PROFILING);  }
+    inline bool enableProfiling() {        return (_cfg_k.flags & IIU_DATA_HANDLING_PROFILING);  }
     bool enableProfiling(bool en);
 
     /*
     * Accessors for quaternion processing.
     */
-    inline bool nullGyroError() {         return (data_handling_flags & IIU_DATA_HANDLING_NULL_GYRO_ERROR);  }
+    inline bool nullGyroError() {         return (_cfg_k.flags & IIU_DATA_HANDLING_NULL_GYRO_ERROR);  }
     bool nullGyroError(bool en);
 
     /*
     * Accessors for range-binding output.
     */
-    inline bool rangeBind() {         return (data_handling_flags & IIU_DATA_HANDLING_RANGE_BIND);  }
+    inline bool rangeBind() {         return (_cfg_k.flags & IIU_DATA_HANDLING_RANGE_BIND);  }
     inline void rangeBind(bool en) {
-      data_handling_flags = (en) ? (data_handling_flags | IIU_DATA_HANDLING_RANGE_BIND) : (data_handling_flags & ~(IIU_DATA_HANDLING_RANGE_BIND));
+      _flag(IIU_DATA_HANDLING_RANGE_BIND, en);
     }
 
     /*
     * Accessors for magnetometer drop.
     */
-    inline bool dropObviousBadMag() {         return (data_handling_flags & IIU_DATA_HANDLING_SMART_MAG_DROP);  }
+    inline bool dropObviousBadMag() {         return (_cfg_k.flags & IIU_DATA_HANDLING_SMART_MAG_DROP);  }
     inline void dropObviousBadMag(bool en) {
-      data_handling_flags = (en) ? (data_handling_flags | IIU_DATA_HANDLING_SMART_MAG_DROP) : (data_handling_flags & ~(IIU_DATA_HANDLING_SMART_MAG_DROP));
+      _flag(IIU_DATA_HANDLING_SMART_MAG_DROP, en);
     }
 
     /*
     * Accessors for magnetometer bearing nullification.
     */
-    inline bool nullifyBearing() {         return (data_handling_flags & IIU_DATA_HANDLING_MAG_NULL_BEARING);  }
+    inline bool nullifyBearing() {         return (_cfg_k.flags & IIU_DATA_HANDLING_MAG_NULL_BEARING);  }
     inline void nullifyBearing(bool en) {
-      data_handling_flags = (en) ? (data_handling_flags | IIU_DATA_HANDLING_MAG_NULL_BEARING) : (data_handling_flags & ~(IIU_DATA_HANDLING_MAG_NULL_BEARING));
+      _flag(IIU_DATA_HANDLING_MAG_NULL_BEARING, en);
     }
 
     /*
     * Accessors for magnetometer spherical abberation correction.
     */
-    inline bool correctSphericalAbberation() {         return (data_handling_flags & IIU_DATA_HANDLING_MAG_CORRECT_SPH);  }
+    inline bool correctSphericalAbberation() {         return (_cfg_k.flags & IIU_DATA_HANDLING_MAG_CORRECT_SPH);  }
     inline void correctSphericalAbberation(bool en) {
-      data_handling_flags = (en) ? (data_handling_flags | IIU_DATA_HANDLING_MAG_CORRECT_SPH) : (data_handling_flags & ~(IIU_DATA_HANDLING_MAG_CORRECT_SPH));
+      _flag(IIU_DATA_HANDLING_MAG_CORRECT_SPH, en);
     }
 
     /*
     * Accessors for magnetometer drop.
     */
-    inline bool cleanMagZero() {         return (data_handling_flags & IIU_DATA_HANDLING_CLEAN_MAG_ZERO);  }
+    inline bool cleanMagZero() {         return (_cfg_k.flags & IIU_DATA_HANDLING_CLEAN_MAG_ZERO);  }
     inline void cleanMagZero(bool en) {
-      data_handling_flags = (en) ? (data_handling_flags | IIU_DATA_HANDLING_CLEAN_MAG_ZERO) : (data_handling_flags & ~(IIU_DATA_HANDLING_CLEAN_MAG_ZERO));
+      _flag(IIU_DATA_HANDLING_CLEAN_MAG_ZERO, en);
     }
 
     /*
     * Accessors for setting and discovering the iteration count of the Madgwick filter.
     */
-    inline uint8_t madgwickIterations() {         return madgwick_iterations;  }
+    inline uint8_t madgwickIterations() {         return _cfg_k.params.iterations;  }
     inline void madgwickIterations(uint8_t nu) {
-      if (nu < 10) madgwick_iterations = nu;
+      if (nu < 10) {
+        _cfg_k.params.iterations = nu;
+        _config_changed();
+      }
     }
 
+    /*
+    * Accessors for the Madgwick filter's gain.
+    */
+    inline float beta() {             return _cfg_k.params.beta;   };
+    inline void  beta(float nu) {     _cfg_k.params.beta = nu;  _config_changed();   };
+
+    /* The gains of all the filters. */
+    inline const FusionParams* fusionParams() {        return &_cfg_k.params;   };
+    inline void fusionParams(const FusionParams* p) {  _cfg_k.params = *p;  _config_changed();   };
+
+    /*
+    * Accessors for the orientation filter. A legend that asks for one overrides
+    *   this choice.
+    */
+    inline FusionFilter filter() {                 return _cfg_k.filter;   };
+    inline void         filter(FusionFilter nu) {
+      if (FusionFilter::DEFAULT != nu) {
+        _cfg_k.filter = nu;
+        _config_changed();
+      }
+    };
+    FusionFilter        activeFilter();
+
+    void benchFilters(StringBuilder*, uint32_t samples);
+
+    /*
+    * Accessors for the lane kernel, which runs Madgwick's filter on all of a
+    *   frame's IMUs together. See MadgwickSoA.h.
+    */
+    inline bool laneKernel() {          return _cfg_k.lanes;   };
+    inline void laneKernel(bool en) {   _cfg_k.lanes = en;  _config_changed();   };
+
+    void benchKernels(SensorFrame*, StringBuilder*, uint32_t iterations);
+
 
-    static float    mag_discard_threshold;
+    /* Magnitude past which a mag sample is dropped, if dropObviousBadMag(). */
+    inline float magDiscardThreshold() {          return _cfg_k.mag_discard;   };
+    inline void  magDiscardThreshold(float nu) {  _cfg_k.mag_discard = nu;  _config_changed();   };
 
 
 
   private:
-    // Queues for cycling frames.
-    RingBuffer<SensorFrame*> _complete;
-    RingBuffer<SensorFrame*> _pending;
+    // Queues for cycling frames. The kernel produces into _pending, and
+    //   consumes from _complete. Integration is the other end of each.
+    SPSCRing<SensorFrame*, (CONFIG_INTEGRATOR_Q_DEPTH + 1)> _complete;
+    SPSCRing<SensorFrame*, (CONFIG_INTEGRATOR_Q_DEPTH + 1)> _pending;
     StringBuilder local_log;
 
     float delta_t      = 0.0f;
@@ -198,12 +343,46 @@ class Integrator {
     float GyroMeasDrift;
 
     Vector3<float> _grav;   // The Integrator maintains an empirical value for gravity.
+    FilterState       _state[INTEGRATOR_IMU_COUNT];  // Per-IMU filter state.
+    FusionAux      _aux[INTEGRATOR_IMU_COUNT];    // Per-IMU state of the filter in use.
+    IntegratorConfig _cfg;        // What integration runs with now.
+    IntegratorConfig _cfg_k;      // The kernel's settings.
+    SPSCRing<IntegratorConfig, 4> _cfg_q;      // From _cfg_k to _cfg.
+    bool           _cfg_resend = false;         // _cfg_q was full. Send _cfg_k again.
+    IntegratorDemand _demand;     // What integration is doing now.
+    IntegratorDemand _demand_k;   // The kernel's latest word on it.
+    SPSCRing<IntegratorDemand, 4> _demand_q;   // From _demand_k to _demand.
+    bool           _demand_resend = false;      // _demand_q was full. Send _demand_k again.
+    MadgwickLanes  _lanes;                      // Staging for the lane kernel.
+    uint8_t        _lane_imu[MADGWICK_SOA_LANES];  // The IMU in each lane.
 
-    // A Legend might instruct us to handle our data in a certain way...
-    uint32_t data_handling_flags = 0;
     uint32_t _frames_completed   = 0;    // Profiling member.
+    uint32_t _updates_9dof       = 0;    // IMU updates that fused a fresh mag sample.
+    uint32_t _updates_6dof       = 0;    // IMU updates that did without.
+    uint32_t _imus_idle          = 0;    // IMUs in frames that nobody wanted fused.
+
+    /* Frame timing. Intervals are between consecutive capture times. */
+    uint64_t _t_last_us          = 0;    // Capture time of the last frame.
+    uint32_t _jit_n              = 0;    // Intervals measured.
+    float    _jit_mean           = 0.0f; // Running mean interval, in us.
+    float    _jit_m2             = 0.0f; // Running sum of squared deviations (Welford).
+    uint32_t _jit_min            = 0xFFFFFFFF;
+    uint32_t _jit_max            = 0;
+    float    _dt_err_max         = 0.0f; // Worst |dt - interval|, in us.
+    uint32_t _stalls             = 0;    // churn() calls held up because results weren't collected.
+
+    /* What churn() costs, and how much of the time it takes. */
+    uint64_t _churn_busy_us      = 0;    // Time spent in churn().
+    uint64_t _churn_wall_us      = 0;    // Time since the first call to churn().
+    uint32_t _churn_t_last       = 0;    // micros() at the last call.
+    uint32_t _churn_calls        = 0;
+    uint32_t _churn_frames       = 0;
+    uint32_t _churn_overruns     = 0;    // Calls that ran past their time budget.
+    uint8_t  _churn_max_batch    = 0;    // Most frames integrated in one call.
+    uint32_t _worker_sleeps      = 0;    // Times the worker ran out of work.
     int8_t   verbosity           = 3;    //
-    uint8_t  madgwick_iterations = 1;    // Madgwick's filter is run this many times per frame.
+    std::atomic<bool> _worker_run{false};   // Is integration happening in the worker?
+    FusionFilter _filter_live = FusionFilter::DEFAULT;  // The filter _aux is set up for.
 
 
     //// We probably want this fxn to return ms, and not s.
@@ -213,9 +392,23 @@ class Integrator {
     //  return (now >= op_ts) ? (delta_t + ((now - op_ts) / 1000.0)) : (delta_t + (((0xFFFFFFFF - op_ts) - now) / 1000.0));
     //}
 
-    uint8_t MadgwickQuaternionUpdate();
-    // This is a privately-scoped override that does not consider the magnetometer.
-    void MadgwickAHRSupdateIMU(SensorFrame*);
+    uint8_t _integrate_next();
+    FusionFilter _select_filter();
+    FusionFilter _filter_for(const IntegratorDemand*, const IntegratorConfig*);
+    void    _demand_changed();
+    void    _take_demand();
+    void    _config_changed();
+    void    _take_config();
+    void    _flag(uint32_t, bool);
+    void    _worker_wait();
+    void    _worker_wake();
+    void    _note_timing(SensorFrame*);
+    float   _imu_dt(SensorFrame*, const FilterState*, uint64_t t_prev);
+    template <class F> void _integrate_with(SensorFrame*, uint32_t imus, uint64_t t_prev);
+    void    _integrate_lanes(SensorFrame*, uint32_t imus, uint64_t t_prev);
+    void    _post_update(SensorFrame*, uint8_t set_i, float d_t);
+    void    _solve_hand(SensorFrame*);
+    void    _reset_aux(uint8_t imu);
 
     int8_t calibrate_from_data_mag();
     int8_t calibrate_from_data_ag();
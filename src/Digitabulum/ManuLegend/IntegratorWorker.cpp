@@ -0,0 +1,218 @@
+/*
+File:   IntegratorWorker.cpp
+Author: J. Ian Lindsay
+Date:   2017.11.04
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+The Integrator's own thread, on platforms that have them. Everything here that
+  differs by platform is in this file.
+
+On linux, the worker is a pthread. On the ESP32, it is a task pinned to the
+  APP core, leaving the PRO core to the kernel. On other FreeRTOS builds, it is
+  a task at a priority above the kernel's.
+
+Frames arrive over _pending and leave over _complete. Both are SPSCRings with
+  the kernel on one end and the worker on the other, so neither side ever
+  waits on the other to move a frame. The worker sleeps when it has nothing it
+  can do, and the kernel wakes it when that might have changed: when it pushes
+  a frame, or takes a result. A wake that comes before the worker is asleep is
+  not lost. It just costs one empty pass through churn().
+
+There is one worker per program. It should only be started once the Integrator
+  has been placed, and stopped before it is destroyed.
+*/
+
+#include "Integrator.h"
+
+#if defined(__MANUVR_LINUX)
+  #include <pthread.h>
+#elif defined(__MANUVR_ESP32)
+  #include "freertos/FreeRTOS.h"
+  #include "freertos/task.h"
+#elif defined(__BUILD_HAS_FREERTOS)
+  #include "FreeRTOS.h"
+  #include "task.h"
+#endif
+
+
+/*******************************************************************************
+*      _______.___________.    ___   .___________. __    ______     _______.
+*     /       |           |   /   \  |           ||  |  /      |   /       |
+*    |   (----`---|  |----`  /  ^  \ `---|  |----`|  | |  ,----'  |   (----`
+*     \   \       |  |      /  /_\  \    |  |     |  | |  |        \   \
+* .----)   |      |  |     /  _____  \   |  |     |  | |  `----.----)   |
+* |_______/       |__|    /__/     \__\  |__|     |__|  \______|_______/
+*
+* Static members and initializers should be located here.
+*******************************************************************************/
+
+#ifndef CONFIG_INTEGRATOR_STACK
+  #define CONFIG_INTEGRATOR_STACK  4096   // The worker's stack, in bytes.
+#endif
+
+#if defined(__MANUVR_LINUX)
+  static pthread_t       _worker_thread;
+  static pthread_mutex_t _worker_mutex = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t  _worker_cond  = PTHREAD_COND_INITIALIZER;
+  static bool            _worker_poke  = false;   // Guarded by _worker_mutex.
+
+  static void* _worker_entry(void* arg) {
+    ((Integrator*) arg)->workerLoop();
+    return nullptr;
+  }
+
+#elif defined(__MANUVR_ESP32) || defined(__BUILD_HAS_FREERTOS)
+  #ifndef CONFIG_INTEGRATOR_PRIORITY
+    // The kernel's task is at (tskIDLE_PRIORITY + 2).
+    #define CONFIG_INTEGRATOR_PRIORITY  (tskIDLE_PRIORITY + 3)
+  #endif
+
+  static TaskHandle_t      _worker_task = nullptr;
+  static std::atomic<bool> _worker_alive{false};   // Cleared as the task exits.
+
+  static void _worker_entry(void* arg) {
+    ((Integrator*) arg)->workerLoop();
+    _worker_alive.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+  }
+#endif
+
+
+/*******************************************************************************
+* Worker lifecycle. Called from the kernel's context.                          *
+*******************************************************************************/
+
+/**
+* Moves integration out of the kernel, and into the worker. Once this returns,
+*   the kernel must not call churn().
+*
+* @return 0 on success (or if already running), -1 if there is no worker here.
+*/
+int8_t Integrator::startWorker() {
+  if (threaded()) return 0;
+  #if defined(__MANUVR_ESP32) || defined(__BUILD_HAS_FREERTOS)
+    // A task made before the scheduler runs would sit unscheduled, and
+    //   nothing would integrate. Stay in the kernel's context instead.
+    if (taskSCHEDULER_RUNNING != xTaskGetSchedulerState()) return -1;
+  #endif
+  _worker_run.store(true, std::memory_order_release);
+
+  #if defined(__MANUVR_LINUX)
+    _worker_poke = true;    // Take anything already pending.
+    if (0 == pthread_create(&_worker_thread, nullptr, _worker_entry, (void*) this)) {
+      return 0;
+    }
+  #elif defined(__MANUVR_ESP32) || defined(__BUILD_HAS_FREERTOS)
+    _worker_alive.store(true, std::memory_order_release);
+    #if defined(__MANUVR_ESP32)
+      const BaseType_t ret = xTaskCreatePinnedToCore(_worker_entry, "_integrator", CONFIG_INTEGRATOR_STACK, (void*) this, CONFIG_INTEGRATOR_PRIORITY, &_worker_task, 1);
+    #else
+      const BaseType_t ret = xTaskCreate(_worker_entry, "_integrator", (CONFIG_INTEGRATOR_STACK / sizeof(StackType_t)), (void*) this, CONFIG_INTEGRATOR_PRIORITY, &_worker_task);
+    #endif
+    if (pdPASS == ret) {
+      return 0;
+    }
+    _worker_task = nullptr;
+    _worker_alive.store(false, std::memory_order_release);
+  #endif
+
+  _worker_run.store(false, std::memory_order_release);
+  return -1;
+}
+
+
+/**
+* Brings integration back into the kernel. Returns after the worker has
+*   finished the frame it was on, and exited. Frames still pending are left
+*   for churn().
+*
+* @return 0 on success (or if not running), -1 on failure.
+*/
+int8_t Integrator::stopWorker() {
+  if (!threaded()) return 0;
+  _worker_run.store(false, std::memory_order_release);
+  int8_t ret = 0;
+
+  #if defined(__MANUVR_LINUX)
+    pthread_mutex_lock(&_worker_mutex);
+    _worker_poke = true;
+    pthread_cond_signal(&_worker_cond);
+    pthread_mutex_unlock(&_worker_mutex);
+    ret = (0 == pthread_join(_worker_thread, nullptr)) ? 0 : -1;
+  #elif defined(__MANUVR_ESP32) || defined(__BUILD_HAS_FREERTOS)
+    xTaskNotifyGive(_worker_task);
+    while (_worker_alive.load(std::memory_order_acquire)) {
+      vTaskDelay(1);
+    }
+    _worker_task = nullptr;
+  #endif
+  return ret;
+}
+
+
+/*******************************************************************************
+* The worker's side.                                                           *
+*******************************************************************************/
+
+/**
+* The body of the worker. Integrates whatever it can, and sleeps when it can't.
+*   Runs until stopWorker() is called.
+*/
+void Integrator::workerLoop() {
+  while (threaded()) {
+    if (0 >= churn(0, 0)) {
+      // Nothing pending, or no room for results.
+      _worker_sleeps++;
+      _worker_wait();
+    }
+  }
+}
+
+
+/**
+* Blocks the worker until the kernel calls _worker_wake(), if it hasn't since
+*   the last time this returned.
+*/
+void Integrator::_worker_wait() {
+  #if defined(__MANUVR_LINUX)
+    pthread_mutex_lock(&_worker_mutex);
+    while (!_worker_poke) {
+      pthread_cond_wait(&_worker_cond, &_worker_mutex);
+    }
+    _worker_poke = false;
+    pthread_mutex_unlock(&_worker_mutex);
+  #elif defined(__MANUVR_ESP32) || defined(__BUILD_HAS_FREERTOS)
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  #endif
+}
+
+
+/**
+* Tells the worker that there may be something for it to do. Costs nothing but
+*   a load when there is no worker.
+*/
+void Integrator::_worker_wake() {
+  if (!threaded()) return;
+  #if defined(__MANUVR_LINUX)
+    pthread_mutex_lock(&_worker_mutex);
+    _worker_poke = true;
+    pthread_cond_signal(&_worker_cond);
+    pthread_mutex_unlock(&_worker_mutex);
+  #elif defined(__MANUVR_ESP32) || defined(__BUILD_HAS_FREERTOS)
+    xTaskNotifyGive(_worker_task);
+  #endif
+}
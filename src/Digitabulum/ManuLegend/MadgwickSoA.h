@@ -0,0 +1,361 @@
+/*
+File:   MadgwickSoA.h
+Author: J. Ian Lindsay
+Date:   2017.10.30
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Madgwick's filter, for many IMUs at once. The IMUs' inputs and state are laid
+  out as a structure of arrays, one lane per IMU, and four lanes are run in
+  step.
+
+The 6-DOF update is the 9-DOF update with the magnetometer zeroed. (Expand
+  the 9-DOF gradient with m = 0, and the 6-DOF gradient is what remains.) So
+  rather than branch on which update an IMU needs, each lane's magnetometer
+  is masked to zero where it should not be fused. The other branches in the
+  scalar code (no accelerometer data, a bad magnetometer sample) are masks in
+  the same way.
+
+Lanes are four floats: SSE2 on x86, NEON on 64-bit ARM. Elsewhere (EG, the
+  Cortex-M7) they are plain arrays of four, which is also the reference that
+  the vector paths can be checked against.
+*/
+
+#ifndef __DIGITABULUM_MADGWICK_SOA_H__
+#define __DIGITABULUM_MADGWICK_SOA_H__
+
+#include <inttypes.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+  #define MADGWICK_SOA_NATIVE  true
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+  #include <arm_neon.h>
+  #define __MADGWICK_SOA_NEON
+  #define MADGWICK_SOA_NATIVE  true
+#else
+  // Without vector units, the lanes save nothing over the scalar code.
+  #define MADGWICK_SOA_NATIVE  false
+#endif
+
+/* 17 IMUs, rounded up to whole groups of four lanes. */
+#define MADGWICK_SOA_LANES   20
+
+
+/*
+* The IMUs' inputs and state, one lane each. Lanes past the last IMU in use are
+*   padding, and must hold harmless values (see madgwick_soa_pad()).
+*/
+typedef struct {
+  float q0[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));  // Orientation. In and out.
+  float q1[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float q2[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float q3[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float gx[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));  // Gyro, in rad/s, less bias.
+  float gy[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float gz[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float ax[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));  // Accelerometer. Normalized in place.
+  float ay[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float az[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float mx[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));  // Magnetometer. Normalized in place, if fresh.
+  float my[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float mz[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));
+  float dt[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));  // Time step, in seconds.
+  float fresh[MADGWICK_SOA_LANES] __attribute__ ((aligned (16)));  // 1.0 if the mag sample is fresh.
+  float nine[MADGWICK_SOA_LANES]  __attribute__ ((aligned (16)));  // Out: 1.0 if the mag was fused.
+} MadgwickLanes;
+
+
+/*******************************************************************************
+* Four-lane arithmetic. Masks are all-ones or all-zeros per lane.
+*******************************************************************************/
+#if defined(__SSE2__)
+  typedef __m128 mv4;
+  typedef __m128 mm4;
+  static inline mv4 mv_set1(float x) {            return _mm_set1_ps(x);       }
+  static inline mv4 mv_load(const float* p) {     return _mm_load_ps(p);       }
+  static inline void mv_store(float* p, mv4 a) {  _mm_store_ps(p, a);          }
+  static inline mv4 mv_add(mv4 a, mv4 b) {        return _mm_add_ps(a, b);     }
+  static inline mv4 mv_sub(mv4 a, mv4 b) {        return _mm_sub_ps(a, b);     }
+  static inline mv4 mv_mul(mv4 a, mv4 b) {        return _mm_mul_ps(a, b);     }
+  static inline mv4 mv_div(mv4 a, mv4 b) {        return _mm_div_ps(a, b);     }
+  static inline mv4 mv_sqrt(mv4 a) {              return _mm_sqrt_ps(a);       }
+  static inline mm4 mv_ne(mv4 a, mv4 b) {         return _mm_cmpneq_ps(a, b);  }
+  static inline mm4 mv_ge(mv4 a, mv4 b) {         return _mm_cmpge_ps(a, b);   }
+  static inline mm4 mm_and(mm4 a, mm4 b) {        return _mm_and_ps(a, b);     }
+  static inline mm4 mm_or(mm4 a, mm4 b) {         return _mm_or_ps(a, b);      }
+  static inline mm4 mm_andnot(mm4 a, mm4 b) {     return _mm_andnot_ps(a, b);  }   // ~a & b
+  static inline mm4 mm_set(bool x) {              return _mm_castsi128_ps(_mm_set1_epi32(x ? -1 : 0));  }
+  static inline mv4 mv_sel(mm4 m, mv4 a, mv4 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));  }
+#elif defined(__MADGWICK_SOA_NEON)
+  typedef float32x4_t mv4;
+  typedef uint32x4_t  mm4;
+  static inline mv4 mv_set1(float x) {            return vdupq_n_f32(x);       }
+  static inline mv4 mv_load(const float* p) {     return vld1q_f32(p);         }
+  static inline void mv_store(float* p, mv4 a) {  vst1q_f32(p, a);             }
+  static inline mv4 mv_add(mv4 a, mv4 b) {        return vaddq_f32(a, b);      }
+  static inline mv4 mv_sub(mv4 a, mv4 b) {        return vsubq_f32(a, b);      }
+  static inline mv4 mv_mul(mv4 a, mv4 b) {        return vmulq_f32(a, b);      }
+  static inline mv4 mv_div(mv4 a, mv4 b) {        return vdivq_f32(a, b);      }
+  static inline mv4 mv_sqrt(mv4 a) {              return vsqrtq_f32(a);        }
+  static inline mm4 mv_ne(mv4 a, mv4 b) {         return vmvnq_u32(vceqq_f32(a, b));  }
+  static inline mm4 mv_ge(mv4 a, mv4 b) {         return vcgeq_f32(a, b);      }
+  static inline mm4 mm_and(mm4 a, mm4 b) {        return vandq_u32(a, b);      }
+  static inline mm4 mm_or(mm4 a, mm4 b) {         return vorrq_u32(a, b);      }
+  static inline mm4 mm_andnot(mm4 a, mm4 b) {     return vbicq_u32(b, a);      }   // ~a & b
+  static inline mm4 mm_set(bool x) {              return vdupq_n_u32(x ? 0xFFFFFFFF : 0);  }
+  static inline mv4 mv_sel(mm4 m, mv4 a, mv4 b) { return vbslq_f32(m, a, b);   }
+#else
+  typedef struct { float    v[4]; } mv4;
+  typedef struct { uint32_t v[4]; } mm4;
+  #define __MV4_LOOP(expr)  for (int _l = 0; _l < 4; _l++) { expr; }
+  static inline mv4 mv_set1(float x) {            mv4 r; __MV4_LOOP(r.v[_l] = x);  return r;  }
+  static inline mv4 mv_load(const float* p) {     mv4 r; __MV4_LOOP(r.v[_l] = p[_l]);  return r;  }
+  static inline void mv_store(float* p, mv4 a) {  __MV4_LOOP(p[_l] = a.v[_l]);  }
+  static inline mv4 mv_add(mv4 a, mv4 b) {        mv4 r; __MV4_LOOP(r.v[_l] = a.v[_l] + b.v[_l]);  return r;  }
+  static inline mv4 mv_sub(mv4 a, mv4 b) {        mv4 r; __MV4_LOOP(r.v[_l] = a.v[_l] - b.v[_l]);  return r;  }
+  static inline mv4 mv_mul(mv4 a, mv4 b) {        mv4 r; __MV4_LOOP(r.v[_l] = a.v[_l] * b.v[_l]);  return r;  }
+  static inline mv4 mv_div(mv4 a, mv4 b) {        mv4 r; __MV4_LOOP(r.v[_l] = a.v[_l] / b.v[_l]);  return r;  }
+  static inline mv4 mv_sqrt(mv4 a) {              mv4 r; __MV4_LOOP(r.v[_l] = sqrtf(a.v[_l]));  return r;  }
+  static inline mm4 mv_ne(mv4 a, mv4 b) {         mm4 r; __MV4_LOOP(r.v[_l] = (a.v[_l] != b.v[_l]) ? 0xFFFFFFFF : 0);  return r;  }
+  static inline mm4 mv_ge(mv4 a, mv4 b) {         mm4 r; __MV4_LOOP(r.v[_l] = (a.v[_l] >= b.v[_l]) ? 0xFFFFFFFF : 0);  return r;  }
+  static inline mm4 mm_and(mm4 a, mm4 b) {        mm4 r; __MV4_LOOP(r.v[_l] = a.v[_l] & b.v[_l]);  return r;  }
+  static inline mm4 mm_or(mm4 a, mm4 b) {         mm4 r; __MV4_LOOP(r.v[_l] = a.v[_l] | b.v[_l]);  return r;  }
+  static inline mm4 mm_andnot(mm4 a, mm4 b) {     mm4 r; __MV4_LOOP(r.v[_l] = ~a.v[_l] & b.v[_l]);  return r;  }
+  static inline mm4 mm_set(bool x) {              mm4 r; __MV4_LOOP(r.v[_l] = x ? 0xFFFFFFFF : 0);  return r;  }
+  static inline mv4 mv_sel(mm4 m, mv4 a, mv4 b) { mv4 r; __MV4_LOOP(r.v[_l] = m.v[_l] ? a.v[_l] : b.v[_l]);  return r;  }
+  #undef __MV4_LOOP
+#endif
+
+
+/**
+* @return The name of the lane implementation in this build.
+*/
+static inline const char* madgwick_soa_isa() {
+  #if defined(__SSE2__)
+    return "SSE2";
+  #elif defined(__MADGWICK_SOA_NEON)
+    return "NEON";
+  #else
+    return "portable";
+  #endif
+}
+
+
+/**
+* Fills lane i with values that integrate to nothing: an identity orientation
+*   with no motion and no data.
+*
+* @param  L  The lanes.
+* @param  i  The lane to pad.
+*/
+static inline void madgwick_soa_pad(MadgwickLanes* L, unsigned int i) {
+  L->q0[i] = 1.0f;
+  L->q1[i] = 0.0f;  L->q2[i] = 0.0f;  L->q3[i] = 0.0f;
+  L->gx[i] = 0.0f;  L->gy[i] = 0.0f;  L->gz[i] = 0.0f;
+  L->ax[i] = 0.0f;  L->ay[i] = 0.0f;  L->az[i] = 0.0f;
+  L->mx[i] = 0.0f;  L->my[i] = 0.0f;  L->mz[i] = 0.0f;
+  L->dt[i] = 0.0f;
+  L->fresh[i] = 0.0f;
+}
+
+
+/**
+* Runs Madgwick's filter over lanes [0, n), rounded up to a whole group of
+*   four. Each lane takes the 9-DOF update if its magnetometer sample is fresh,
+*   non-zero and (if drop_bad_mag) below mag_thresh. Otherwise, the 6-DOF one.
+*   As in the scalar code, a 9-DOF lane with no accelerometer data is left
+*   as it was, and a 6-DOF lane still integrates its gyro.
+*
+* @param  L             The lanes.
+* @param  n             Lanes in use.
+* @param  beta          The filter gain.
+* @param  iterations    Filter steps per call.
+* @param  drop_bad_mag  Refuse mag samples at or above mag_thresh?
+* @param  mag_thresh    See drop_bad_mag.
+*/
+static inline void madgwick_soa(MadgwickLanes* L, unsigned int n, float beta, uint8_t iterations, bool drop_bad_mag, float mag_thresh) {
+  const mv4 zero  = mv_set1(0.0f);
+  const mv4 one   = mv_set1(1.0f);
+  const mv4 half  = mv_set1(0.5f);
+  const mv4 two   = mv_set1(2.0f);
+  const mv4 four  = mv_set1(4.0f);
+  const mv4 v_b   = mv_set1(beta);
+  const mv4 v_thr = mv_set1(mag_thresh);
+  const mm4 drop  = mm_set(drop_bad_mag);
+
+  for (unsigned int i = 0; i < n; i += 4) {
+    mv4 q0 = mv_load(&L->q0[i]);
+    mv4 q1 = mv_load(&L->q1[i]);
+    mv4 q2 = mv_load(&L->q2[i]);
+    mv4 q3 = mv_load(&L->q3[i]);
+    const mv4 gx = mv_load(&L->gx[i]);
+    const mv4 gy = mv_load(&L->gy[i]);
+    const mv4 gz = mv_load(&L->gz[i]);
+    const mv4 dt = mv_load(&L->dt[i]);
+
+    // Normalise the accelerometer, where it is non-zero.
+    mv4 ax = mv_load(&L->ax[i]);
+    mv4 ay = mv_load(&L->ay[i]);
+    mv4 az = mv_load(&L->az[i]);
+    const mv4 a_len  = mv_sqrt(mv_add(mv_add(mv_mul(ax, ax), mv_mul(ay, ay)), mv_mul(az, az)));
+    const mm4 acc_ok = mv_ne(a_len, zero);
+    const mv4 a_inv  = mv_sel(acc_ok, mv_div(one, mv_sel(acc_ok, a_len, one)), zero);
+    ax = mv_mul(ax, a_inv);
+    ay = mv_mul(ay, a_inv);
+    az = mv_mul(az, a_inv);
+    mv_store(&L->ax[i], ax);
+    mv_store(&L->ay[i], ay);
+    mv_store(&L->az[i], az);
+
+    // Normalise the magnetometer, where it is fresh. Fuse it only where it is
+    //   also non-zero, and not refused.
+    mv4 mx = mv_load(&L->mx[i]);
+    mv4 my = mv_load(&L->my[i]);
+    mv4 mz = mv_load(&L->mz[i]);
+    const mm4 fresh  = mv_ne(mv_load(&L->fresh[i]), zero);
+    const mv4 m_len  = mv_sel(fresh, mv_sqrt(mv_add(mv_add(mv_mul(mx, mx), mv_mul(my, my)), mv_mul(mz, mz))), zero);
+    const mm4 m_ok   = mv_ne(m_len, zero);
+    const mm4 nine   = mm_andnot(mm_and(drop, mv_ge(m_len, v_thr)), m_ok);
+    const mv4 m_inv  = mv_sel(m_ok, mv_div(one, mv_sel(m_ok, m_len, one)), zero);
+    mx = mv_sel(m_ok, mv_mul(mx, m_inv), mx);
+    my = mv_sel(m_ok, mv_mul(my, m_inv), my);
+    mz = mv_sel(m_ok, mv_mul(mz, m_inv), mz);
+    mv_store(&L->mx[i], mx);
+    mv_store(&L->my[i], my);
+    mv_store(&L->mz[i], mz);
+    mv_store(&L->nine[i], mv_sel(nine, one, zero));
+    mx = mv_sel(nine, mx, zero);
+    my = mv_sel(nine, my, zero);
+    mz = mv_sel(nine, mz, zero);
+
+    // The 9-DOF update does nothing at all without the accelerometer.
+    const mm4 moves = mm_or(acc_ok, mm_andnot(nine, mm_set(true)));
+
+    for (uint8_t it = 0; it < iterations; it++) {
+      // Rate of change of quaternion from gyroscope
+      mv4 qDot1 = mv_mul(half, mv_sub(mv_sub(zero, mv_mul(q1, gx)), mv_add(mv_mul(q2, gy), mv_mul(q3, gz))));
+      mv4 qDot2 = mv_mul(half, mv_sub(mv_add(mv_mul(q0, gx), mv_mul(q2, gz)), mv_mul(q3, gy)));
+      mv4 qDot3 = mv_mul(half, mv_add(mv_sub(mv_mul(q0, gy), mv_mul(q1, gz)), mv_mul(q3, gx)));
+      mv4 qDot4 = mv_mul(half, mv_sub(mv_add(mv_mul(q0, gz), mv_mul(q1, gy)), mv_mul(q2, gx)));
+
+      // Auxiliary variables to avoid repeated arithmetic
+      const mv4 _2q0mx = mv_mul(mv_mul(two, q0), mx);
+      const mv4 _2q0my = mv_mul(mv_mul(two, q0), my);
+      const mv4 _2q0mz = mv_mul(mv_mul(two, q0), mz);
+      const mv4 _2q1mx = mv_mul(mv_mul(two, q1), mx);
+      const mv4 _2q0 = mv_mul(two, q0);
+      const mv4 _2q1 = mv_mul(two, q1);
+      const mv4 _2q2 = mv_mul(two, q2);
+      const mv4 _2q3 = mv_mul(two, q3);
+      const mv4 q0q0 = mv_mul(q0, q0);
+      const mv4 q0q1 = mv_mul(q0, q1);
+      const mv4 q0q2 = mv_mul(q0, q2);
+      const mv4 q0q3 = mv_mul(q0, q3);
+      const mv4 q1q1 = mv_mul(q1, q1);
+      const mv4 q1q2 = mv_mul(q1, q2);
+      const mv4 q1q3 = mv_mul(q1, q3);
+      const mv4 q2q2 = mv_mul(q2, q2);
+      const mv4 q2q3 = mv_mul(q2, q3);
+      const mv4 q3q3 = mv_mul(q3, q3);
+
+      // Reference direction of Earth's magnetic field. Zero in 6-DOF lanes.
+      mv4 hx = mv_mul(mx, q0q0);
+      hx = mv_sub(hx, mv_mul(_2q0my, q3));
+      hx = mv_add(hx, mv_mul(_2q0mz, q2));
+      hx = mv_add(hx, mv_mul(mx, q1q1));
+      hx = mv_add(hx, mv_mul(mv_mul(_2q1, my), q2));
+      hx = mv_add(hx, mv_mul(mv_mul(_2q1, mz), q3));
+      hx = mv_sub(hx, mv_mul(mx, q2q2));
+      hx = mv_sub(hx, mv_mul(mx, q3q3));
+      mv4 hy = mv_mul(_2q0mx, q3);
+      hy = mv_add(hy, mv_mul(my, q0q0));
+      hy = mv_sub(hy, mv_mul(_2q0mz, q1));
+      hy = mv_add(hy, mv_mul(_2q1mx, q2));
+      hy = mv_sub(hy, mv_mul(my, q1q1));
+      hy = mv_add(hy, mv_mul(my, q2q2));
+      hy = mv_add(hy, mv_mul(mv_mul(_2q2, mz), q3));
+      hy = mv_sub(hy, mv_mul(my, q3q3));
+      const mv4 _2bx = mv_sqrt(mv_add(mv_mul(hx, hx), mv_mul(hy, hy)));
+      mv4 _2bz = mv_sub(mv_mul(_2q0my, q1), mv_mul(_2q0mx, q2));
+      _2bz = mv_add(_2bz, mv_mul(mz, q0q0));
+      _2bz = mv_add(_2bz, mv_mul(_2q1mx, q3));
+      _2bz = mv_sub(_2bz, mv_mul(mz, q1q1));
+      _2bz = mv_add(_2bz, mv_mul(mv_mul(_2q2, my), q3));
+      _2bz = mv_sub(_2bz, mv_mul(mz, q2q2));
+      _2bz = mv_add(_2bz, mv_mul(mz, q3q3));
+      const mv4 _4bx = mv_mul(two, _2bx);
+      const mv4 _4bz = mv_mul(two, _2bz);
+      const mv4 _8bx = mv_mul(two, _4bx);
+      const mv4 _8bz = mv_mul(two, _4bz);
+
+      // The residuals of the objective function. Those for the magnetometer
+      //   are zero in 6-DOF lanes, along with their weights.
+      const mv4 f_ax = mv_sub(mv_mul(two, mv_sub(q1q3, q0q2)), ax);
+      const mv4 f_ay = mv_sub(mv_mul(two, mv_add(q0q1, q2q3)), ay);
+      const mv4 f_az = mv_sub(mv_mul(two, mv_sub(mv_sub(half, q1q1), q2q2)), az);
+      const mv4 f_mx = mv_sub(mv_add(mv_mul(_4bx, mv_sub(mv_sub(half, q2q2), q3q3)), mv_mul(_4bz, mv_sub(q1q3, q0q2))), mx);
+      const mv4 f_my = mv_sub(mv_add(mv_mul(_4bx, mv_sub(q1q2, q0q3)), mv_mul(_4bz, mv_add(q0q1, q2q3))), my);
+      const mv4 f_mz = mv_sub(mv_add(mv_mul(_4bx, mv_add(q0q2, q1q3)), mv_mul(_4bz, mv_sub(mv_sub(half, q1q1), q2q2))), mz);
+
+      // Gradient decent algorithm corrective step
+      mv4 s0 = mv_add(mv_add(mv_add(mv_sub(mv_mul(_2q1, f_ay), mv_mul(_2q2, f_ax)),
+        mv_mul(mv_sub(zero, mv_mul(_4bz, q2)), f_mx)),
+        mv_mul(mv_sub(mv_mul(_4bz, q1), mv_mul(_4bx, q3)), f_my)),
+        mv_mul(mv_mul(_4bx, q2), f_mz));
+      mv4 s1 = mv_add(mv_add(mv_add(mv_sub(mv_add(mv_mul(_2q3, f_ax), mv_mul(_2q0, f_ay)), mv_mul(mv_mul(four, q1), f_az)),
+        mv_mul(mv_mul(_4bz, q3), f_mx)),
+        mv_mul(mv_add(mv_mul(_4bx, q2), mv_mul(_4bz, q0)), f_my)),
+        mv_mul(mv_sub(mv_mul(_4bx, q3), mv_mul(_8bz, q1)), f_mz));
+      mv4 s2 = mv_add(mv_add(mv_add(mv_sub(mv_sub(mv_mul(_2q3, f_ay), mv_mul(_2q0, f_ax)), mv_mul(mv_mul(four, q2), f_az)),
+        mv_mul(mv_sub(zero, mv_add(mv_mul(_8bx, q2), mv_mul(_4bz, q0))), f_mx)),
+        mv_mul(mv_add(mv_mul(_4bx, q1), mv_mul(_4bz, q3)), f_my)),
+        mv_mul(mv_sub(mv_mul(_4bx, q0), mv_mul(_8bz, q2)), f_mz));
+      mv4 s3 = mv_add(mv_add(mv_add(mv_add(mv_mul(_2q1, f_ax), mv_mul(_2q2, f_ay)),
+        mv_mul(mv_add(mv_sub(zero, mv_mul(_8bx, q3)), mv_mul(_4bz, q1)), f_mx)),
+        mv_mul(mv_add(mv_sub(zero, mv_mul(_4bx, q0)), mv_mul(_4bz, q2)), f_my)),
+        mv_mul(mv_mul(_4bx, q1), f_mz));
+
+      // Normalise step magnitude, and apply feedback where there is any.
+      const mv4 s_len = mv_sqrt(mv_add(mv_add(mv_mul(s0, s0), mv_mul(s1, s1)), mv_add(mv_mul(s2, s2), mv_mul(s3, s3))));
+      const mv4 s_inv = mv_sel(acc_ok, mv_div(v_b, mv_sel(acc_ok, s_len, one)), zero);
+      qDot1 = mv_sub(qDot1, mv_mul(s0, s_inv));
+      qDot2 = mv_sub(qDot2, mv_mul(s1, s_inv));
+      qDot3 = mv_sub(qDot3, mv_mul(s2, s_inv));
+      qDot4 = mv_sub(qDot4, mv_mul(s3, s_inv));
+
+      // Integrate rate of change of quaternion to yield quaternion
+      mv4 n0 = mv_add(q0, mv_mul(qDot1, dt));
+      mv4 n1 = mv_add(q1, mv_mul(qDot2, dt));
+      mv4 n2 = mv_add(q2, mv_mul(qDot3, dt));
+      mv4 n3 = mv_add(q3, mv_mul(qDot4, dt));
+
+      // Normalise quaternion
+      const mv4 q_inv = mv_div(one, mv_sqrt(mv_add(mv_add(mv_mul(n1, n1), mv_mul(n2, n2)), mv_add(mv_mul(n3, n3), mv_mul(n0, n0)))));
+      q0 = mv_sel(moves, mv_mul(n0, q_inv), q0);
+      q1 = mv_sel(moves, mv_mul(n1, q_inv), q1);
+      q2 = mv_sel(moves, mv_mul(n2, q_inv), q2);
+      q3 = mv_sel(moves, mv_mul(n3, q_inv), q3);
+    }
+    mv_store(&L->q0[i], q0);
+    mv_store(&L->q1[i], q1);
+    mv_store(&L->q2[i], q2);
+    mv_store(&L->q3[i], q3);
+  }
+}
+
+#endif  // __DIGITABULUM_MADGWICK_SOA_H__
@@ -83,6 +83,8 @@ uint16_t ManuLegend::datasetSize() {
   for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) if (samplesMag(idx))         return_value += sizeof(uint32_t);
   for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) if (samplesTemperature(idx)) return_value += sizeof(uint32_t);
   if (handPosition()) return_value += sizeof(Vector3<float>);
+  if (jointAngles())  return_value += sizeof(float) * HAND_JOINT_COUNT;
+  if (fingertips())   return_value += sizeof(Vector3<float>) * HAND_DIGIT_COUNT;
   if (sequence())     return_value += sizeof(uint32_t);
   if (deltaT())       return_value += sizeof(float);
 
@@ -180,7 +182,12 @@ int8_t ManuLegend::setLegendString(StringBuilder* input) {
 * @return true if so.
 */
 bool ManuLegend::satisfiedBy(ManuLegend* test) {
-  if (frame_data != (frame_data & test->frame_data)) {
+  const uint8_t flags = frame_data & ~(DATA_LEGEND_FLAGS_FILTER_MASK);
+  if (flags != (flags & test->frame_data)) {
+    return false;
+  }
+  if ((uint8_t) fusionFilter() > (uint8_t) test->fusionFilter()) {
+    // The filters are ranked. A costlier one than we asked for will do.
     return false;
   }
   for (int i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
@@ -194,7 +201,8 @@ bool ManuLegend::satisfiedBy(ManuLegend* test) {
 
 /**
 * Put ourselves into a state where we satisfy the given Legend.
-* Note that this function never unsets data demand.
+* Note that this function never unsets data demand. Of the two filters asked
+*   for, the costlier is kept.
 *
 * @param test is the ManuLegend that sets the baseline.
 * @return True if we changed our own Legend.
@@ -202,7 +210,10 @@ bool ManuLegend::satisfiedBy(ManuLegend* test) {
 bool ManuLegend::stackLegend(ManuLegend* test) {
   bool return_value = false;
   if (frame_data != test->frame_data) {
-    frame_data   = frame_data | test->frame_data;
+    const uint8_t f_mask = DATA_LEGEND_FLAGS_FILTER_MASK;
+    const uint8_t ours   = frame_data & f_mask;
+    const uint8_t theirs = test->frame_data & f_mask;
+    frame_data   = ((frame_data | test->frame_data) & ~f_mask) | ((ours > theirs) ? ours : theirs);
     return_value = true;
   }
   for (int i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
@@ -247,9 +258,9 @@ bool ManuLegend::zeroLegend() {
 bool ManuLegend::fillLegendGaps() {
   bool return_value = false;
   for (uint8_t i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
-    if (handPosition() || position(i)) {
+    if ((handPosition() && (0 == i)) || position(i)) {
       // Asking for IMU position is asking for everything from the data pipeline
-      // for that IMU. Hand position demands that position be enabled for all IMUs.
+      // for that IMU. Hand position is the position of the skeleton's root.
       if (DATA_LEGEND_FLAGS_IIU_REQ_POSITION != (per_iiu_data[i] & DATA_LEGEND_FLAGS_IIU_REQ_POSITION)) {
         per_iiu_data[i] = DATA_LEGEND_FLAGS_IIU_REQ_POSITION;
         return_value = true;
@@ -269,8 +280,9 @@ bool ManuLegend::fillLegendGaps() {
         return_value = true;
       }
     }
-    else if (orientation(i)) {
+    else if (handSkeleton() || orientation(i)) {
       // To find orientation, we need all the inertial data at minimum. Probably mag too.
+      // The skeleton is solved from the orientations of all IMUs.
       if (DATA_LEGEND_FLAGS_IIU_REQ_ORIENTATION != (per_iiu_data[i] & DATA_LEGEND_FLAGS_IIU_REQ_ORIENTATION)) {
         per_iiu_data[i] = DATA_LEGEND_FLAGS_IIU_REQ_ORIENTATION;
         return_value = true;
@@ -281,12 +293,54 @@ bool ManuLegend::fillLegendGaps() {
 }
 
 
+/**
+* Works out which of the Integrator's stages each IMU needs, so that this
+*   legend gets what it asks for. Follows the same dependencies as
+*   fillLegendGaps(), but leaves the legend as it is. So it is safe to use on
+*   a ManuLegendPipe.
+*
+* @param  d  The demand to fill out.
+*/
+void ManuLegend::compileDemand(IntegratorDemand* d) {
+  d->orientation = 0;
+  d->null_grav   = 0;
+  d->velocity    = 0;
+  d->position    = 0;
+  d->filter      = fusionFilter();
+  d->hand        = handSkeleton();
+  for (uint8_t i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
+    uint16_t req = 0;
+    if ((handPosition() && (0 == i)) || position(i)) {
+      // Hand position is the position of the skeleton's root.
+      req = DATA_LEGEND_FLAGS_IIU_REQ_POSITION;
+    }
+    else if (velocity(i)) {
+      req = DATA_LEGEND_FLAGS_IIU_REQ_VELOCITY;
+    }
+    else if (accNullGravity(i)) {
+      req = DATA_LEGEND_FLAGS_IIU_REQ_NULL_GRAV;
+    }
+    else if (handSkeleton() || orientation(i)) {
+      req = DATA_LEGEND_FLAGS_IIU_REQ_ORIENTATION;
+    }
+    const uint32_t bit = (1UL << i);
+    if (req & DATA_LEGEND_FLAGS_IIU_ORIENTATION) d->orientation |= bit;
+    if (req & DATA_LEGEND_FLAGS_IIU_NULL_GRAV)   d->null_grav   |= bit;
+    if (req & DATA_LEGEND_FLAGS_IIU_VELOCITY)    d->velocity    |= bit;
+    if (req & DATA_LEGEND_FLAGS_IIU_POSITION)    d->position    |= bit;
+  }
+}
+
+
 void ManuLegend::printManuLegend(StringBuilder* output) {
   output->concat("-- ManuLegend\n-----------------------------------\n");
   output->concatf("-- dataset_size   \t%u\n", (unsigned long) ds_size);
   output->concat("-- Enabled data:\n");
   output->concatf("\t handPosition   \t%c\n", handPosition() ? 'y' : 'n');
+  output->concatf("\t Joint angles   \t%c\n", jointAngles() ? 'y' : 'n');
+  output->concatf("\t Fingertips     \t%c\n", fingertips() ? 'y' : 'n');
   output->concatf("\t Delta-T        \t%c\n", deltaT() ? 'y' : 'n');
+  output->concatf("\t Filter         \t%s\n", fusion_filter_name(fusionFilter()));
 
   char* cap_str = (char*) alloca(13);
   *(cap_str+12) = 0;
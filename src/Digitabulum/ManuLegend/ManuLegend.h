@@ -49,7 +49,11 @@ In Digitabulum r0, this class held 17 instances of the IIU class, each of which
 */
 #define  DATA_LEGEND_FLAGS_REPORT_SEQUENCE    0x01   // ManuLegend will append a seq number.
 #define  DATA_LEGEND_FLAGS_REPORT_DELTA_T     0x02   // Report the time between frames.
-#define  DATA_LEGEND_FLAGS_REPORT_GLOBAL_POS  0x04   // Report a summed position vecotr for the entire glove.
+#define  DATA_LEGEND_FLAGS_REPORT_GLOBAL_POS  0x04   // Report the position of the hand (the root of the skeleton).
+#define  DATA_LEGEND_FLAGS_FILTER_MASK        0x18   // Orientation filter wanted. A FusionFilter.
+#define  DATA_LEGEND_FLAGS_FILTER_SHIFT       3
+#define  DATA_LEGEND_FLAGS_REPORT_JOINTS      0x20   // Report the joint angles of the hand skeleton.
+#define  DATA_LEGEND_FLAGS_REPORT_FINGERTIPS  0x40   // Report the fingertips of the hand skeleton.
 
 /*
 * Bitmask flags for IMU data that makes its way into the map. This is the ManuLegend spec.
@@ -186,10 +190,23 @@ class ManuLegend {
     inline bool handPosition() {  return (frame_data & DATA_LEGEND_FLAGS_REPORT_GLOBAL_POS); };     // Global data: Should we return a global hand position?
     inline bool sequence() {      return (frame_data & DATA_LEGEND_FLAGS_REPORT_SEQUENCE);   };     // Global data: Should we return a sequence number?
     inline bool deltaT() {        return (frame_data & DATA_LEGEND_FLAGS_REPORT_DELTA_T);    };     // Global data: Should we return a deltaT since last frame?
+    inline bool jointAngles() {   return (frame_data & DATA_LEGEND_FLAGS_REPORT_JOINTS);     };     // Global data: Should we return the hand's joint angles?
+    inline bool fingertips() {    return (frame_data & DATA_LEGEND_FLAGS_REPORT_FINGERTIPS); };     // Global data: Should we return the fingertip positions?
 
     inline void handPosition(bool en) {  frame_data = (en) ? (frame_data | DATA_LEGEND_FLAGS_REPORT_GLOBAL_POS) : (frame_data & ~(DATA_LEGEND_FLAGS_REPORT_GLOBAL_POS));  };
     inline void sequence(bool en) {      frame_data = (en) ? (frame_data | DATA_LEGEND_FLAGS_REPORT_SEQUENCE)   : (frame_data & ~(DATA_LEGEND_FLAGS_REPORT_SEQUENCE));    };
     inline void deltaT(bool en) {        frame_data = (en) ? (frame_data | DATA_LEGEND_FLAGS_REPORT_DELTA_T)    : (frame_data & ~(DATA_LEGEND_FLAGS_REPORT_DELTA_T));     };
+    inline void jointAngles(bool en) {   frame_data = (en) ? (frame_data | DATA_LEGEND_FLAGS_REPORT_JOINTS)     : (frame_data & ~(DATA_LEGEND_FLAGS_REPORT_JOINTS));      };
+    inline void fingertips(bool en) {    frame_data = (en) ? (frame_data | DATA_LEGEND_FLAGS_REPORT_FINGERTIPS) : (frame_data & ~(DATA_LEGEND_FLAGS_REPORT_FINGERTIPS));  };
+
+    /* Any of the data that comes from the hand skeleton. */
+    inline bool handSkeleton() {  return (frame_data & (DATA_LEGEND_FLAGS_REPORT_GLOBAL_POS | DATA_LEGEND_FLAGS_REPORT_JOINTS | DATA_LEGEND_FLAGS_REPORT_FINGERTIPS));  };
+
+    /* The orientation filter this legend wants. DEFAULT if it doesn't care. */
+    inline FusionFilter fusionFilter() {  return (FusionFilter) ((frame_data & DATA_LEGEND_FLAGS_FILTER_MASK) >> DATA_LEGEND_FLAGS_FILTER_SHIFT);  };
+    inline void fusionFilter(FusionFilter f) {
+      frame_data = (frame_data & ~(DATA_LEGEND_FLAGS_FILTER_MASK)) | ((((uint8_t) f) << DATA_LEGEND_FLAGS_FILTER_SHIFT) & DATA_LEGEND_FLAGS_FILTER_MASK);
+    };
 
     /* This is per-sensor data. */
     inline uint16_t iiu_data_opts(uint8_t idx) {   return (per_iiu_data[idx % LEGEND_DATASET_IIU_COUNT]);   };
@@ -237,6 +254,7 @@ class ManuLegend {
     bool stackLegend(ManuLegend*);
     bool zeroLegend();
     bool fillLegendGaps();
+    void compileDemand(IntegratorDemand*);
 
 
   private:
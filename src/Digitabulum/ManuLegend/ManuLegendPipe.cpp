@@ -167,36 +167,53 @@ int8_t ManuLegendPipe::offer(SensorFrame* frame) {
               encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(TCode::VECT_3_FLOAT));
               encoder.write_bytes((uint8_t*) &(frame->hand_position), 12);
             }
+            if (jointAngles()) {
+              encoder.write_map(1);
+              encoder.write_string("jnt");
+              encoder.write_array(HAND_JOINT_COUNT);
+              for (uint8_t j = 0; j < HAND_JOINT_COUNT; j++) {
+                encoder.write_float(frame->hand.joints[j]);
+              }
+            }
+            if (fingertips()) {
+              encoder.write_map(1);
+              encoder.write_string("tip");
+              encoder.write_array(HAND_DIGIT_COUNT);
+              for (uint8_t d = 0; d < HAND_DIGIT_COUNT; d++) {
+                encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(TCode::VECT_3_FLOAT));
+                encoder.write_bytes((uint8_t*) &(frame->hand.tip[d]), 12);
+              }
+            }
             for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) {
               if (orientation(idx)) {
                 encoder.write_map(1);
                 encoder.write_string("ori");
                 encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(TCode::VECT_4_FLOAT));
-                encoder.write_bytes((uint8_t*) &(frame->quat[idx]), 16);
+                encoder.write_bytes((uint8_t*) &(frame->quat(idx)), 16);
               }
               if (accNullGravity(idx)) {
                 encoder.write_map(1);
                 encoder.write_string("ang");
                 encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(TCode::VECT_3_FLOAT));
-                encoder.write_bytes((uint8_t*) &(frame->n_data[idx]), 12);
+                encoder.write_bytes((uint8_t*) &(frame->nullGrav(idx)), 12);
               }
               if (accRaw(idx)) {
                 encoder.write_map(1);
                 encoder.write_string("acc");
                 encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(TCode::VECT_3_FLOAT));
-                encoder.write_bytes((uint8_t*) &(frame->a_data[idx]), 12);
+                encoder.write_bytes((uint8_t*) &(frame->acc(idx)), 12);
               }
               if (gyro(idx)) {
                 encoder.write_map(1);
                 encoder.write_string("gyr");
                 encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(TCode::VECT_3_FLOAT));
-                encoder.write_bytes((uint8_t*) &(frame->g_data[idx]), 12);
+                encoder.write_bytes((uint8_t*) &(frame->gyro(idx)), 12);
               }
               if (mag(idx)) {
                 encoder.write_map(1);
                 encoder.write_string("mag");
                 encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(TCode::VECT_3_FLOAT));
-                encoder.write_bytes((uint8_t*) &(frame->m_data[idx]), 12);
+                encoder.write_bytes((uint8_t*) &(frame->mag(idx)), 12);
               }
               if (velocity(idx)) {
               }
@@ -205,7 +222,7 @@ int8_t ManuLegendPipe::offer(SensorFrame* frame) {
               if (temperature(idx)) {
                 encoder.write_map(1);
                 encoder.write_string("tmp");
-                encoder.write_float(frame->temperature[idx]);
+                encoder.write_float(frame->temperature(idx));
               }
               if (samplesAcc(idx)) {
               }
@@ -260,6 +277,30 @@ int8_t ManuLegendPipe::offer(SensorFrame* frame) {
                 ret = nu;
               }
             }
+            if (jointAngles()) {
+              for (uint8_t j = 0; j < HAND_JOINT_COUNT; j++) {
+                Argument* nu = new Argument(frame->hand.joints[j]);
+                nu->setKey("jnt");
+                if (ret) {
+                  ret->link(nu);
+                }
+                else {
+                  ret = nu;
+                }
+              }
+            }
+            if (fingertips()) {
+              for (uint8_t d = 0; d < HAND_DIGIT_COUNT; d++) {
+                Argument* nu = new Argument(&(frame->hand.tip[d]));
+                nu->setKey("tip");
+                if (ret) {
+                  ret->link(nu);
+                }
+                else {
+                  ret = nu;
+                }
+              }
+            }
 
             for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) {
               Argument* imu_arg = nullptr;
@@ -278,7 +319,7 @@ int8_t ManuLegendPipe::offer(SensorFrame* frame) {
               if (position(idx)) {
               }
               if (temperature(idx)) {
-                Argument* nu = new Argument(frame->temperature[idx]);
+                Argument* nu = new Argument(frame->temperature(idx));
                 nu->setKey("temp");
                 if (ret) {
                   ret->link(nu);
@@ -323,6 +364,10 @@ int8_t ManuLegendPipe::offer(SensorFrame* frame) {
             }
             if (handPosition()) {
             }
+            if (jointAngles()) {
+            }
+            if (fingertips()) {
+            }
             for (uint8_t idx = 0; idx < LEGEND_DATASET_IIU_COUNT; idx++) {
               if (orientation(idx)) {
               }
@@ -353,7 +398,7 @@ int8_t ManuLegendPipe::offer(SensorFrame* frame) {
           break;
 
         case ManuEncoding::LOG:
-          frame->printManuLegend(&log);
+          printManuLegend(&log);
           return_value = 0;
           break;
       }
@@ -21,6 +21,7 @@ limitations under the License.
 */
 
 #include "ManuManager.h"
+#include "RawScale.h"
 
 
 /*******************************************************************************
@@ -36,14 +37,19 @@ limitations under the License.
 
 SPIBusOp ManuManager::_preformed_read_i;
 SPIBusOp ManuManager::_preformed_read_m;
+SPIBusChain ManuManager::_frame_chain(&ManuManager::_preformed_read_i);
+SPIBusChain ManuManager::_mag_chain(&ManuManager::_preformed_read_m);
 SPIBusOp ManuManager::_preformed_read_temp;
 SPIBusOp ManuManager::_preformed_fifo_read;
+SPIBusOp ManuManager::_preformed_burst_i;
+SPIBusChain ManuManager::_burst_chain(&ManuManager::_preformed_burst_i);
 
 static Vector3<int16_t> reflection_mag;
 static Vector3<int16_t> reflection_acc;
 static Vector3<int16_t> reflection_gyr;
 
 static SensorFrame _frame_pool_mem[PREALLOCD_IMU_FRAMES];
+static RawFrame    _raw_pool_mem[PREALLOCD_RAW_FRAMES];
 
 
 /*------------------------------------------------------------------------------
@@ -55,13 +61,62 @@ static SensorFrame _frame_pool_mem[PREALLOCD_IMU_FRAMES];
 
 /* Inertial data,
     x2 because Acc+Gyr
-    x2 because double-buffered
     x3 because 3-space vectors (of 16-bit ints)
     X17 because that many sensors
-    = 204 int16's
-    = 408 bytes
+    = 102 int16's
+  ...followed by room for the magnetometer data,
+    x3 because 3-space vectors (of 16-bit ints)
+    X17 because that many sensors
+    = 51 int16's (plus one, to keep the half 4-byte aligned for DMA)
+  x2 because double-buffered
+    = 308 int16's
+    = 616 bytes
+  _preformed_read_i alternates between the two halves. While the bus fills one,
+    the other is stable, and is what gets scaled into floats. When the read is
+    chained, the magnetometer segments land right behind the inertial data, so
+    each half holds a whole A/G/M frame.
+  Every IMU has a fixed slot in each half, whether or not it is read. The read
+    plan only fills the slots of the IMUs that are wanted and present.
+*/
+#define MANU_FRAME_BUF_I_AG    (2 * 3 * LEGEND_DATASET_IIU_COUNT)   // int16's of A/G per half.
+#define MANU_FRAME_BUF_I_HALF  ((MANU_FRAME_BUF_I_AG + (3 * LEGEND_DATASET_IIU_COUNT) + 1) & ~1)
+int16_t __attribute__ ((aligned (4))) _frame_buf_i[2 * MANU_FRAME_BUF_I_HALF];
+
+/* Conversion tables. Each is laid out like the raw data it applies to, so the
+    whole frame can be scaled in one pass. See RawScale.h.
+  Rebuilt by _refresh_cal() when a scale, calibration, or reflection changes.
+*/
+static float __attribute__ ((aligned (16))) _cal_off_i[MANU_FRAME_BUF_I_AG];
+static float __attribute__ ((aligned (16))) _cal_gain_i[MANU_FRAME_BUF_I_AG];
+static float __attribute__ ((aligned (16))) _cal_off_m[3 * LEGEND_DATASET_IIU_COUNT];
+static float __attribute__ ((aligned (16))) _cal_gain_m[3 * LEGEND_DATASET_IIU_COUNT];
+static float __attribute__ ((aligned (16))) _scaled_i[MANU_FRAME_BUF_I_AG];
+static float __attribute__ ((aligned (16))) _scaled_m[3 * LEGEND_DATASET_IIU_COUNT];
+
+/**
+* @param  ptr  Anywhere in _frame_buf_i.
+* @return The start of the half that holds it.
+*/
+static inline uint8_t* _frame_half_of(uint8_t* ptr) {
+  return (ptr < (uint8_t*) &_frame_buf_i[MANU_FRAME_BUF_I_HALF]) ? (uint8_t*) _frame_buf_i : (uint8_t*) &_frame_buf_i[MANU_FRAME_BUF_I_HALF];
+}
+
+/* FIFO burst data. Single buffered.
+  Each IMU's slot holds the burst's samples of A/G, oldest first. So for a
+    burst of n samples, IMU i's slot starts at int16 (6 * n * i).
+  The magnetometer slots follow at a fixed offset, as in _frame_buf_i.
 */
-int16_t __attribute__ ((aligned (4))) _frame_buf_i[2 * 2 * 3 * LEGEND_DATASET_IIU_COUNT];
+#define MANU_BURST_BUF_AG  (6 * MANU_FIFO_BURST_MAX * LEGEND_DATASET_IIU_COUNT)
+int16_t __attribute__ ((aligned (4))) _burst_buf[MANU_BURST_BUF_AG + (3 * LEGEND_DATASET_IIU_COUNT) + 1];
+
+#define MANU_PLAN_STALE_I  0x01   // _preformed_read_i hasn't taken the plan.
+#define MANU_PLAN_STALE_M  0x02   // _preformed_read_m hasn't taken the plan.
+
+/* Drift tracking. Measured periods outside these ratios to nominal are not
+    folded in. */
+#define MANU_DRIFT_ALPHA      0.01f
+#define MANU_DRIFT_RATIO_MIN  0.8f
+#define MANU_DRIFT_RATIO_MAX  1.25f
 
 /* Temperature data. Single buffered. */
 // TODO: Might consolidate temp into inertial. Sensor and CPLD allow for it.
@@ -289,6 +344,17 @@ const char* ManuManager::getManuStateString(ManuState x) {
   return "UNKNOWN";
 }
 
+const char* ManuManager::getFramePolicyString(FramePolicy x) {
+  switch (x) {
+    case FramePolicy::DROP_NEWEST:   return "DROP_NEWEST";
+    case FramePolicy::DROP_OLDEST:   return "DROP_OLDEST";
+    case FramePolicy::DECIMATE:      return "DECIMATE";
+    default:
+      break;
+  }
+  return "UNKNOWN";
+}
+
 
 
 /*******************************************************************************
@@ -299,7 +365,7 @@ const char* ManuManager::getManuStateString(ManuState x) {
 *                                          |_|
 * Constructors/destructors, class initialization functions and so-forth...
 *******************************************************************************/
-ManuManager::ManuManager(CPLDDriver* bus) : EventReceiver("ManuMgmt"), _bus(bus), _frame_pool(PREALLOCD_IMU_FRAMES, &_frame_pool_mem[0]) {
+ManuManager::ManuManager(CPLDDriver* bus) : EventReceiver("ManuMgmt"), _bus(bus), _frame_pool(PREALLOCD_IMU_FRAMES, &_frame_pool_mem[0]), _raw_pool(PREALLOCD_RAW_FRAMES, &_raw_pool_mem[0]), _raw_queue(PREALLOCD_RAW_FRAMES) {
   _bus->setManuManager(this);  // Introduce ourselves immediately.
 
   reflection_gyr(1, 1, 1);
@@ -310,32 +376,41 @@ ManuManager::ManuManager(CPLDDriver* bus) : EventReceiver("ManuMgmt"), _bus(bus)
   for (uint16_t i = 0; i < PREALLOCD_IMU_FRAMES; i++) {
     _frame_pool_mem[i].wipe();
   }
+  for (uint8_t i = 0; i < MANU_DROP_STAGES; i++) {
+    _frame_drops[i] = 0;
+  }
+  _root_leg.sequence(true);
+  _root_leg.deltaT(true);
+  //_root_leg.accNullGravity(true);
+  _root_leg.accRaw(true);
+  _root_leg.gyro(true);
+  _root_leg.mag(true);
+  _root_leg.orientation(true);
+  _root_leg.temperature(true);
+  _push_demand();
 
-  _preformed_read_i.shouldReap(false);
-  _preformed_read_i.devRegisterAdvance(true);
-  _preformed_read_i.set_opcode(BusOpcode::RX);
-  _preformed_read_i.callback = (BusOpCallback*) this;
-  // Starting from the first accelerometer...
-  // Read 12 bytes...  (A and G vectors)
-  // ...across 17 sensors...
-  // ...from this base address...
-  _preformed_read_i.setParams(CPLD_REG_IMU_DM_P_I|0x80, 12, 17, RegPtrMap::regAddr(RegID::A_DATA_X)|0x80);
-  // ...and drop the results here.
-  _preformed_read_i.buf      = (uint8_t*) _frame_buf_i;
-  _preformed_read_i.buf_len  = 204;
+  // The inertial read carries the magnetometer read along with it, unless
+  //   told otherwise. Both chains stay registered. What they carry is up to
+  //   the read plan.
+  _er_set_flag(LEGEND_MGR_FLAGS_CHAINED_FRAMES);
+  _bus->registerChain(&_frame_chain);
+  _bus->registerChain(&_mag_chain);
+  _plan_reads();
+
+  _init_read_i((uint8_t*) _frame_buf_i);
 
   _preformed_read_m.shouldReap(false);
   _preformed_read_m.devRegisterAdvance(true);
   _preformed_read_m.set_opcode(BusOpcode::RX);
   _preformed_read_m.callback = (BusOpCallback*) this;
-  // Starting from the first magnetometer...
-  // Read 6 bytes...
-  // ...across 17 sensors...
-  // ...from this base address...
-  _preformed_read_m.setParams(CPLD_REG_IMU_DM_P_M|0x80, 6, 17, RegPtrMap::regAddr(RegID::M_DATA_X)|0xC0);
-  // ...and drop the results here.
-  _preformed_read_m.buf      = (uint8_t*) _reg_block_m_data;
-  _preformed_read_m.buf_len  = 102;
+  _apply_plan_m();
+  _refresh_bus_demand();
+
+  // Sensor reads go in the bus's real-time lane. Only the inertial stream has
+  //   a deadline, which tracks the sample rate once it is known.
+  _bus->setRealtime(&_preformed_read_i, 0);
+  _bus->setRealtime(&_preformed_read_m, 0);
+  _bus->setRealtime(&_preformed_fifo_read, 0);
 
   _preformed_fifo_read.shouldReap(false);
   _preformed_fifo_read.devRegisterAdvance(false);
@@ -350,6 +425,14 @@ ManuManager::ManuManager(CPLDDriver* bus) : EventReceiver("ManuMgmt"), _bus(bus)
   _preformed_fifo_read.buf      = (uint8_t*) __fifo_levels;
   _preformed_fifo_read.buf_len  = 17;
 
+  // The burst read is shaped by _read_fifo_burst() each time it is used.
+  _preformed_burst_i.shouldReap(false);
+  _preformed_burst_i.devRegisterAdvance(true);
+  _preformed_burst_i.set_opcode(BusOpcode::RX);
+  _preformed_burst_i.callback = (BusOpCallback*) this;
+  _bus->registerChain(&_burst_chain);
+  _bus->setRealtime(&_preformed_burst_i, 0);
+
   _preformed_read_temp.shouldReap(false);
   _preformed_read_temp.devRegisterAdvance(true);
   _preformed_read_temp.set_opcode(BusOpcode::RX);
@@ -373,15 +456,6 @@ ManuManager::ManuManager(CPLDDriver* bus) : EventReceiver("ManuMgmt"), _bus(bus)
   _ptr_delta_t  = (float*)    (__dataset + LEGEND_DATASET_OFFSET_DELTA_T/4);
 
   *(_ptr_sequence) = 0;
-
-  _root_leg.sequence(true);
-  _root_leg.deltaT(true);
-  //_root_leg.accNullGravity(true);
-  _root_leg.accRaw(true);
-  _root_leg.gyro(true);
-  _root_leg.mag(true);
-  _root_leg.orientation(true);
-  _root_leg.temperature(true);
 }
 
 
@@ -391,6 +465,278 @@ ManuManager::~ManuManager() {
 }
 
 
+/**
+* Sets up the preformed inertial read. Called on construction, and to re-arm
+*   the read after the bus has aborted it.
+*
+* @param  half  The half of _frame_buf_i to read into.
+*/
+void ManuManager::_init_read_i(uint8_t* half) {
+  _preformed_read_i.wipe();
+  _preformed_read_i.shouldReap(false);
+  _preformed_read_i.devRegisterAdvance(true);
+  _preformed_read_i.set_opcode(BusOpcode::RX);
+  _preformed_read_i.callback = (BusOpCallback*) this;
+  // Which sensors are read, and where their data lands, is the plan's call.
+  _apply_plan_i(half);
+}
+
+
+/**
+* Finds the runs of consecutive IMUs in a mask, and merges neighboring runs
+*   until there are no more than max_runs. Runs separated by merge_gap IMUs or
+*   fewer are merged regardless, since reading through the gap costs less than
+*   another transaction.
+*
+* @param  mask       Bit n set means IMU n is wanted.
+* @param  runs       Receives the runs, in address order.
+* @param  max_runs   How many runs there is room for.
+* @param  merge_gap  The widest gap (in IMUs) that is always read through.
+* @return The number of runs.
+*/
+static uint8_t _imu_runs(uint32_t mask, IMURun* runs, uint8_t max_runs, uint8_t merge_gap) {
+  IMURun  tmp[LEGEND_DATASET_IIU_COUNT];
+  uint8_t n = 0;
+  while (mask) {
+    const uint8_t first = (uint8_t) __builtin_ctz(mask);
+    const uint8_t count = (uint8_t) __builtin_ctz(~(mask >> first));
+    mask &= ~(((1UL << count) - 1) << first);
+    if ((n > 0) && ((first - (tmp[n-1].first + tmp[n-1].count)) <= merge_gap)) {
+      tmp[n-1].count = (first + count) - tmp[n-1].first;
+    }
+    else {
+      tmp[n].first = first;
+      tmp[n].count = count;
+      n++;
+    }
+  }
+  while (n > max_runs) {
+    // Too many transactions. Read through the narrowest gap.
+    uint8_t best     = 1;
+    uint8_t best_gap = 0xFF;
+    for (uint8_t i = 1; i < n; i++) {
+      const uint8_t gap = tmp[i].first - (tmp[i-1].first + tmp[i-1].count);
+      if (gap < best_gap) {
+        best     = i;
+        best_gap = gap;
+      }
+    }
+    tmp[best-1].count = (tmp[best].first + tmp[best].count) - tmp[best-1].first;
+    for (uint8_t i = best; i < (n - 1); i++) tmp[i] = tmp[i+1];
+    n--;
+  }
+  for (uint8_t i = 0; i < n; i++) runs[i] = tmp[i];
+  return n;
+}
+
+
+/**
+* Works out which sensors the preformed reads should cover. An IMU is read if
+*   the root legend wants anything from it, and its digit is present. Its
+*   magnetometer is read if the legend wants magnetic data, or something
+*   inferred from it.
+* Doesn't touch the ops. That happens as each one comes off the bus.
+*/
+void ManuManager::_plan_reads() {
+  uint32_t present = 0x00000001;   // The PCB IMU is always there.
+  if (_bus->digitExists(DigitPort::MC)) present |= 0x00000002;
+  for (uint8_t p = 1; p < 6; p++) {
+    if (_bus->digitExists((DigitPort) p)) present |= (0x07UL << (2 + (3 * (p - 1))));
+  }
+
+  // Any IMU the Integrator fuses needs both reads.
+  IntegratorDemand demand;
+  _root_leg.compileDemand(&demand);
+  uint32_t want_i = demand.orientation;
+  uint32_t want_m = demand.orientation;
+  for (uint8_t i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
+    if (_root_leg.iiu_data_opts(i)) want_i |= (1UL << i);
+    if (_root_leg.mag(i) || _root_leg.samplesMag(i)) want_m |= (1UL << i);
+  }
+  _plan.mask_i = want_i & present;
+  _plan.mask_m = want_m & present;
+  // The inertial read paces the stream, so it never reads nothing.
+  if (0 == _plan.mask_i) _plan.mask_i = 0x00000001;
+
+  // If the reads are chained, the two share one chain's worth of transactions.
+  const uint8_t max_i = (chainedFrames() && _plan.mask_m) ? (MANU_READ_MAX_RUNS / 2) : MANU_READ_MAX_RUNS;
+  _plan.runs_i = _imu_runs(_plan.mask_i, _plan.run_i, max_i, MANU_READ_RUN_OVERHEAD / 12);
+  const uint8_t max_m = chainedFrames() ? (MANU_READ_MAX_RUNS - _plan.runs_i) : MANU_READ_MAX_RUNS;
+  _plan.runs_m = _imu_runs(_plan.mask_m, _plan.run_m, max_m, MANU_READ_RUN_OVERHEAD / 6);
+
+  _plan.bytes_i = 0;
+  _plan.bytes_m = 0;
+  for (uint8_t i = 0; i < _plan.runs_i; i++) _plan.bytes_i += _plan.run_i[i].count * 12;
+  for (uint8_t i = 0; i < _plan.runs_m; i++) _plan.bytes_m += _plan.run_m[i].count * 6;
+  _plan_rebuilds++;
+}
+
+
+/**
+* Shapes an inertial read after the plan. The op must be off the bus.
+* The first inertial run is the op's own segment. The rest follow in the
+*   chain, each skipping over the slots of the IMUs it doesn't read. If asked,
+*   the magnetometer runs come last, landing in their own slots.
+*
+* @param  op     The op to shape.
+* @param  chain  The op's chain.
+* @param  base   The start of IMU 0's slot.
+* @param  n      Samples to take from each IMU. Each slot is (12 * n) bytes.
+* @param  mag    The start of IMU 0's magnetometer slot. nullptr to leave out
+*                  the magnetometers.
+* @return The offset from base of the op's own buffer.
+*/
+uint16_t ManuManager::_shape_read_i(SPIBusOp* op, SPIBusChain* chain, uint8_t* base, uint8_t n, uint8_t* mag) {
+  const uint8_t reg_i = RegPtrMap::regAddr(RegID::A_DATA_X) | 0x80;
+  const uint8_t reg_m = RegPtrMap::regAddr(RegID::M_DATA_X) | 0xC0;
+  const uint8_t slot  = 12 * n;
+  IMURun* r = &_plan.run_i[0];
+  chain->dropSegments();
+
+  // Starting from the run's first accelerometer...
+  // Read 12 bytes per sample...  (A and G vectors)
+  // ...across the run...
+  // ...from this base address...
+  op->setParams((CPLD_REG_IMU_DM_P_I + r->first) | 0x80, slot, r->count, reg_i);
+  // ...and drop the results into their slots.
+  const uint16_t offset = r->first * slot;
+  op->buf     = base + offset;
+  op->buf_len = r->count * slot;
+
+  uint16_t end = (r->first + r->count) * slot;
+  for (uint8_t i = 1; i < _plan.runs_i; i++) {
+    r = &_plan.run_i[i];
+    chain->addSegment((CPLD_REG_IMU_DM_P_I + r->first) | 0x80, slot, r->count, reg_i, nullptr, r->count * slot, (r->first * slot) - end);
+    end = (r->first + r->count) * slot;
+  }
+  if (nullptr != mag) {
+    const uint16_t mag_base = (uint16_t) (mag - base);
+    for (uint8_t i = 0; i < _plan.runs_m; i++) {
+      r = &_plan.run_m[i];
+      const uint16_t pos = mag_base + (r->first * 6);
+      chain->addSegment((CPLD_REG_IMU_DM_P_M + r->first) | 0x80, 6, r->count, reg_m, nullptr, r->count * 6, pos - end);
+      end = pos + (r->count * 6);
+    }
+  }
+  return offset;
+}
+
+
+/**
+* Shapes _preformed_read_i (and its chain) after the plan. The op must be off
+*   the bus. If the reads are chained, the magnetometer data lands right
+*   behind the inertial data.
+*
+* @param  half  The half of _frame_buf_i to read into.
+*/
+void ManuManager::_apply_plan_i(uint8_t* half) {
+  _read_i_offset = _shape_read_i(
+    &_preformed_read_i, &_frame_chain, half, 1,
+    chainedFrames() ? (half + (MANU_FRAME_BUF_I_AG * 2)) : nullptr
+  );
+  _plan_stale &= ~MANU_PLAN_STALE_I;
+}
+
+
+/**
+* Shapes _preformed_read_m (and its chain) after the plan. The op must be off
+*   the bus. If the reads are chained, or no magnetometers are wanted, the op
+*   is left alone and won't be queued.
+*/
+void ManuManager::_apply_plan_m() {
+  const uint8_t reg_m = RegPtrMap::regAddr(RegID::M_DATA_X) | 0xC0;
+  _mag_chain.dropSegments();
+  if (!chainedFrames() && (_plan.runs_m > 0)) {
+    IMURun* r = &_plan.run_m[0];
+    // Starting from the run's first magnetometer...
+    // Read 6 bytes...
+    // ...across the run...
+    // ...from this base address...
+    _preformed_read_m.setParams((CPLD_REG_IMU_DM_P_M + r->first) | 0x80, 6, r->count, reg_m);
+    // ...and drop the results into their slots.
+    _preformed_read_m.buf     = ((uint8_t*) _reg_block_m_data) + (r->first * 6);
+    _preformed_read_m.buf_len = r->count * 6;
+
+    uint16_t end = (r->first + r->count) * 6;
+    for (uint8_t i = 1; i < _plan.runs_m; i++) {
+      r = &_plan.run_m[i];
+      _mag_chain.addSegment((CPLD_REG_IMU_DM_P_M + r->first) | 0x80, 6, r->count, reg_m, nullptr, r->count * 6, (r->first * 6) - end);
+      end = (r->first + r->count) * 6;
+    }
+  }
+  _plan_stale &= ~MANU_PLAN_STALE_M;
+}
+
+
+/**
+* Called when the legend, the set of present digits, or the chaining might
+*   have changed. The new plan is given to each preformed read that is off the
+*   bus. The others take it in their own callbacks.
+*/
+void ManuManager::_demand_changed() {
+  if (0 != _push_demand()) {
+    local_log.concat("Integrator didn't take the new demand.\n");
+  }
+  _plan_reads();
+  _plan_stale = MANU_PLAN_STALE_I | MANU_PLAN_STALE_M;
+  if (XferState::IDLE == _preformed_read_i.get_state()) {
+    _apply_plan_i(_frame_half_of(_preformed_read_i.buf));
+  }
+  if (XferState::IDLE == _preformed_read_m.get_state()) {
+    _apply_plan_m();
+  }
+  _refresh_bus_demand();
+}
+
+
+/**
+* Tells the Integrator what the root legend needs from it, and where the
+*   digits of the hand are.
+*
+* @return 0 on success, -1 if the Integrator didn't take it.
+*/
+int8_t ManuManager::_push_demand() {
+  IntegratorDemand d;
+  _root_leg.compileDemand(&d);
+  d.left_hand = _er_flag(LEGEND_MGR_FLAGS_CHIRALITY_LEFT);
+  for (uint8_t i = 0; i < HAND_DIGIT_COUNT; i++) {
+    d.digit_port[i] = 0;
+  }
+  for (uint8_t p = (uint8_t) DigitPort::PORT_1; p <= (uint8_t) DigitPort::PORT_5; p++) {
+    // Until chirality is known, only the middle finger can be placed.
+    const Anatomical digit = get_digit_given_port((DigitPort) p);
+    if ((digit >= Anatomical::DIGIT_1) && (digit <= Anatomical::DIGIT_5)) {
+      d.digit_port[(uint8_t) digit - (uint8_t) Anatomical::DIGIT_1] = p;
+    }
+  }
+  return integrator.demand(&d);
+}
+
+
+/**
+* Called by the CPLDDriver when a digit's presence signal changes.
+*/
+void ManuManager::digitPresenceChanged() {
+  _demand_changed();
+}
+
+
+/**
+* An inertial read that waits on the bus for longer than two sample periods
+*   would return a newer sample than the one it was queued for, and the read
+*   behind it would return the same one again. So the bus is told to skip it.
+* Called once per inertial frame. Only talks to the bus if the rate changed.
+*/
+void ManuManager::_refresh_read_deadline() {
+  const float period = imus[0].deltaT_I();
+  const uint32_t deadline_us = (uint32_t) (period * 2000000.0f);
+  if (deadline_us != _read_deadline_us) {
+    _read_deadline_us = deadline_us;
+    _bus->setRealtime(&_preformed_read_i, deadline_us);
+  }
+}
+
+
 /*
 * Return a ref to the indicated IIU, instantiating and validating it, if necessary.
 * Assuming the caller passes an unsigned int in the range [0, 17), this fxn has
@@ -414,7 +760,8 @@ int8_t ManuManager::setLegend(ManuLegend* nu_legend) {
   //   the frame broadcast until the callback for this event happens. This assures that the message
   //   order to anyone listening is what we intend.
   if (_root_leg.stackLegend(nu_legend)) {
-    // TODO: If our root legend changed because of this addition, do we need to take action?
+    // Our root legend changed. The sensor reads follow it.
+    _demand_changed();
   }
   return 0;
 }
@@ -468,6 +815,7 @@ int ManuManager::set_chirality(Chirality c) {
     case Chirality::RIGHT:   break;
   }
   _er_set_flag(x);
+  _push_demand();   // The skeleton's digits have moved.
   return 0;
 }
 
@@ -520,7 +868,17 @@ Anatomical ManuManager::get_digit_given_port(DigitPort port) {
 }
 
 
-int8_t ManuManager::deliverIRQ(DigitPort port, uint8_t imu_idx, uint8_t svc, uint8_t data) {
+/**
+* Called by the CPLD driver for each IRQ edge on an IMU's lines.
+*
+* @param  port     The digit the IMU is on.
+* @param  imu_idx  The IMU.
+* @param  data     The IMU's four IRQ lines, as of this edge.
+* @param  svc      Which of the four lines changed.
+* @param  t_us     When the edge arrived, in micros().
+* @return 0 always.
+*/
+int8_t ManuManager::deliverIRQ(DigitPort port, uint8_t imu_idx, uint8_t data, uint8_t svc, uint32_t t_us) {
   if (getVerbosity() > 4) {
     const char* pos_str;
     switch (imu_idx) {
@@ -552,14 +910,29 @@ int8_t ManuManager::deliverIRQ(DigitPort port, uint8_t imu_idx, uint8_t svc, uin
         break;
     }
     local_log.concatf(
-      "deliverIRQ(%s, %u, %s): 0x%x 0x%x\n",
+      "deliverIRQ(%s, %u, %s): 0x%x 0x%x @%u\n",
       CPLDDriver::getDigitPortString(port),
       imu_idx,
       pos_str,
       svc,
-      data
+      data,
+      (unsigned int) t_us
     );
   }
+  if ((0x01 == svc) && (data & svc) && (_plan.mask_m & (1UL << imu_idx))) {
+    // DRDY_M is the magnetometer's data-ready. (INTM is its threshold
+    //   interrupt, and is no use here.) Magnetometers are read at their
+    //   own rate, rather than every inertial frame. When the reads are
+    //   chained, the next inertial read will collect the sample.
+    _mag_ready |= (1UL << imu_idx);
+    read_mag_frame();
+  }
+  if (fifoBurst() && (0x08 == svc) && (data & svc) && (_plan.mask_i & (1UL << imu_idx))) {
+    // INT2 is the FIFO watermark. Find out how much can be taken.
+    if ((XferState::IDLE == _preformed_fifo_read.get_state()) && (XferState::IDLE == _preformed_burst_i.get_state())) {
+      read_fifo_depth();
+    }
+  }
   flushLocalLog();
   return 0;
 }
@@ -860,6 +1233,422 @@ int8_t ManuManager::io_op_callahead(BusOp* _op) {
 }
 
 
+/**
+* Rebuilds the conversion tables from the IMUs' present scales, the noise
+*   floors (for IMUs that cancel error), and the reflection vectors.
+*/
+void ManuManager::_refresh_cal() {
+  for (int i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
+    const float scalar_a = imus[i].scaleA();
+    const float scalar_g = imus[i].scaleG();
+    const float scalar_m = imus[i].scaleM();
+    const bool  cancel   = imus[i].cancel_error();
+    float* off  = &_cal_off_i[i * 6];
+    float* gain = &_cal_gain_i[i * 6];
+    off[0]  = cancel ? noise_floor_acc[i].x : 0.0f;
+    off[1]  = cancel ? noise_floor_acc[i].y : 0.0f;
+    off[2]  = cancel ? noise_floor_acc[i].z : 0.0f;
+    off[3]  = cancel ? noise_floor_gyr[i].x : 0.0f;
+    off[4]  = cancel ? noise_floor_gyr[i].y : 0.0f;
+    off[5]  = cancel ? noise_floor_gyr[i].z : 0.0f;
+    gain[0] = reflection_acc.x * scalar_a;
+    gain[1] = reflection_acc.y * scalar_a;
+    gain[2] = reflection_acc.z * scalar_a;
+    gain[3] = reflection_gyr.x * scalar_g;
+    gain[4] = reflection_gyr.y * scalar_g;
+    gain[5] = reflection_gyr.z * scalar_g;
+    _cal_off_m[i*3 + 0]  = 0.0f;
+    _cal_off_m[i*3 + 1]  = 0.0f;
+    _cal_off_m[i*3 + 2]  = 0.0f;
+    _cal_gain_m[i*3 + 0] = reflection_mag.x * scalar_m;
+    _cal_gain_m[i*3 + 1] = reflection_mag.y * scalar_m;
+    _cal_gain_m[i*3 + 2] = reflection_mag.z * scalar_m;
+  }
+  _cal_epoch = LSM9DS1::scaleEpoch();
+  _cal_stale = false;
+  _cal_refreshes++;
+}
+
+
+/**
+* Scales one raw frame into the given SensorFrame. Only the IMUs the raw frame
+*   carries are written. The others are left as the wiped frame has them.
+*
+* @param  frame   The frame to fill.
+* @param  raw     The raw frame.
+*/
+void ManuManager::_scale_frame_i(SensorFrame* frame, RawFrame* raw) {
+  if (_cal_stale || (_cal_epoch != LSM9DS1::scaleEpoch())) {
+    _refresh_cal();
+  }
+  raw_scale_s16(raw->ag, _cal_off_i, _cal_gain_i, _scaled_i, MANU_FRAME_BUF_I_AG);
+  raw_scale_s16(raw->m,  _cal_off_m, _cal_gain_m, _scaled_m, 3 * LEGEND_DATASET_IIU_COUNT);
+
+  for (uint32_t m = raw->mask_i; 0 != m; m &= (m - 1)) {
+    const int i = __builtin_ctz(m);
+    const float* v = &_scaled_i[i * 6];
+    frame->setI(i, v[0], v[1], v[2], v[3], v[4], v[5]);
+  }
+  for (uint32_t m = raw->mask_m; 0 != m; m &= (m - 1)) {
+    // Magnetometer data is held between samples, so every frame carries the
+    //   last one. Only the new ones are marked fresh.
+    const int i = __builtin_ctz(m);
+    frame->setM(i, _scaled_m[i*3 + 0], _scaled_m[i*3 + 1], _scaled_m[i*3 + 2]);
+  }
+  frame->magFresh(raw->mag_fresh);
+  frame->time(raw->dt);
+  frame->captureTime(raw->t_us);
+}
+
+
+/**
+* Extends a micros() value to 64 bits, so that capture times never wrap. The
+*   values given need not arrive in order, but each must be within 2^31us of
+*   the latest one seen.
+*
+* @param  t  A micros() value.
+* @return The same time, in 64 bits.
+*/
+uint64_t ManuManager::_clock_us(uint32_t t) {
+  if (0 == _us_clock) {
+    _us_clock = t;
+    return t;
+  }
+  const uint64_t ext = _us_clock + (int32_t) (t - (uint32_t) _us_clock);
+  if (ext > _us_clock) _us_clock = ext;
+  return ext;
+}
+
+
+/**
+* Folds a measured span of samples into the drift estimate. The IMUs' clocks
+*   are not the MCU's, so the true sample period is a few percent off the
+*   nominal one, and wanders with temperature.
+*
+* @param  span_us  Time between the last sample before the span and its last.
+* @param  samples  Samples in the span.
+*/
+void ManuManager::_track_drift(uint64_t span_us, uint8_t samples) {
+  const float nominal = imus[0].deltaT_I();
+  if ((0 == span_us) || (0 == samples) || (nominal <= 0.0f)) return;
+  const float ratio = (span_us * 1e-6f) / (nominal * samples);
+  // A missed or doubled sample is not drift.
+  if ((ratio > MANU_DRIFT_RATIO_MIN) && (ratio < MANU_DRIFT_RATIO_MAX)) {
+    _odr_drift += (ratio - _odr_drift) * MANU_DRIFT_ALPHA;
+  }
+}
+
+
+/**
+* @return The IMUs' nominal sample period, corrected for drift, in seconds.
+*/
+float ManuManager::_sample_period() {
+  return imus[0].deltaT_I() * _odr_drift;
+}
+
+
+/**
+* Copies one raw inertial sample into a RawFrame, and queues it for scaling.
+*   This is all that happens on the intake path. Scaling waits until there
+*   is a result frame and room in the integrator for it. See _scale_pending().
+*
+* @param  buf     The raw sample. One half of _frame_buf_i, for the preformed read.
+* @param  mag     The raw magnetometer data to go with it.
+* @param  stride  int16's from one IMU's inertial data to the next.
+* @param  t_us    The sample's capture time. See _clock_us().
+* @param  dt      The sample's time step. If not positive, it is derived from
+*                   t_us or the ODR, as dtFromODR() says.
+* @return 0 on success.
+*/
+int8_t ManuManager::_intake_frame_i(int16_t* buf, int16_t* mag, uint16_t stride, uint64_t t_us, float dt) {
+  RawFrame* raw = _take_raw();
+  if (nullptr == raw) {
+    // The frame policy chose to lose this sample. The next frame's time step
+    //   will cover it.
+    _lost_run++;
+    return -1;
+  }
+  if (dt <= 0.0f) {
+    const uint64_t span = ((0 != _frame_t_us) && (t_us > _frame_t_us)) ? (t_us - _frame_t_us) : 0;
+    _track_drift(span, 1 + _lost_run);
+    dt = dtFromODR() ? (_sample_period() * (1 + _lost_run)) : (span * 1e-6f);
+  }
+  else {
+    dt *= (1 + _lost_run);
+  }
+  if (6 == stride) {
+    memcpy(raw->ag, buf, sizeof(raw->ag));
+  }
+  else {
+    // Burst data is interleaved by sample. Pull this sample together.
+    for (int i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
+      memcpy(&raw->ag[i * 6], buf + (i * stride), 12);
+    }
+  }
+  memcpy(raw->m, mag, sizeof(raw->m));
+  raw->t_us      = t_us;
+  raw->dt        = dt;
+  raw->mask_i    = _plan.mask_i;
+  raw->mask_m    = _plan.mask_m;
+  raw->mag_fresh = _mag_fresh & _plan.mask_m;
+  _mag_fresh_count += __builtin_popcount(raw->mag_fresh);
+  _mag_fresh = 0;
+  // The queue is as deep as the raw pool, so this cannot fail.
+  _raw_queue.insert(raw);
+  _frame_t_us = t_us;
+  _lost_run   = 0;
+  sample_count++;
+  return 0;
+}
+
+
+/**
+* Scales queued raw frames into result frames, and sends them to the
+*   integrator, for as long as it has room and there are result frames free.
+*   Does no more than max_quats_per_event (if that isn't zero).
+*
+* @return The number of frames sent.
+*/
+int8_t ManuManager::_scale_pending() {
+  int8_t sent = 0;
+  while (((0 == max_quats_per_event) || (sent < max_quats_per_event)) && (0 < _raw_queue.count()) && integrator.canAccept()) {
+    SensorFrame* frame = _take_frame();
+    if (nullptr == frame) {
+      // Results are still out with the pipe. The raw frame waits.
+      _result_stalls++;
+      break;
+    }
+    RawFrame* raw = _raw_queue.get();
+    raw->dt        += _raw_carry_dt;
+    raw->mag_fresh |= _raw_carry_fresh & raw->mask_m;
+    _raw_carry_dt    = 0.0f;
+    _raw_carry_fresh = 0;
+    _scale_frame_i(frame, raw);
+    _give_raw(raw);
+    integrator.pushFrame(frame);  // canAccept() said there was room.
+    sent++;
+  }
+  return sent;
+}
+
+
+/**
+* Takes a raw frame from the pool for a new sample, according to the frame
+*   policy. Whatever the policy, this never blocks, and the result must be
+*   checked.
+*
+* @return A raw frame, or nullptr if the sample is to be lost.
+*/
+RawFrame* ManuManager::_take_raw() {
+  if (FramePolicy::DECIMATE == _frame_policy) {
+    // Pressure comes on with a quarter of the pool free, and goes off at half.
+    const uint16_t free_frames = PREALLOCD_RAW_FRAMES - _raws_out;
+    if (free_frames <= (PREALLOCD_RAW_FRAMES / 4)) {
+      _decimating = true;
+    }
+    else if (free_frames >= (PREALLOCD_RAW_FRAMES / 2)) {
+      _decimating = false;
+    }
+    if (_decimating && (0 != (_decimate_phase++ % _decimate_n))) {
+      _frame_drops[MANU_DROP_DECIMATED]++;
+      return nullptr;
+    }
+  }
+  RawFrame* raw = _raw_pool.take();
+  if ((nullptr == raw) && (FramePolicy::DROP_OLDEST == _frame_policy)) {
+    raw = _raw_queue.get();
+    if (nullptr != raw) {
+      // The oldest sample gives way. Its time step, and any fresh mag
+      //   samples it held, go to the next one scaled. It never went back to
+      //   the pool, so it is still counted as out.
+      _frame_drops[MANU_DROP_PENDING]++;
+      _raw_carry_dt    += raw->dt;
+      _raw_carry_fresh |= raw->mag_fresh;
+      return raw;
+    }
+  }
+  if (nullptr == raw) {
+    if (!_starving) {
+      _starving = true;
+      _starve_since_us = micros();
+    }
+    _frame_drops[MANU_DROP_POOL]++;
+    return nullptr;
+  }
+  if (_starving) {
+    _starving = false;
+    _starved_us += micros() - _starve_since_us;
+  }
+  _raws_out++;
+  if (_raws_out > _raws_out_max) _raws_out_max = _raws_out;
+  return raw;
+}
+
+
+/**
+* Returns a raw frame to the pool. Raw frames are overwritten whole on intake,
+*   so there is nothing to wipe.
+*
+* @param  raw  The raw frame. Must have come from _take_raw().
+*/
+void ManuManager::_give_raw(RawFrame* raw) {
+  _raw_pool.give(raw);
+  if (_raws_out > 0) _raws_out--;
+}
+
+
+/**
+* Takes a result frame from the pool.
+*
+* @return A wiped frame, or nullptr if the pool is empty.
+*/
+SensorFrame* ManuManager::_take_frame() {
+  SensorFrame* frame = _frame_pool.take();
+  if (nullptr != frame) {
+    _frames_out++;
+    if (_frames_out > _frames_out_max) _frames_out_max = _frames_out;
+  }
+  return frame;
+}
+
+
+/**
+* Returns a frame to the pool.
+*
+* @param  frame  The frame. Must have come from _take_frame().
+*/
+void ManuManager::reclaimMeasurement(SensorFrame* frame) {
+  frame->wipe();
+  _frame_pool.give(frame);
+  if (_frames_out > 0) _frames_out--;
+}
+
+
+/**
+* Sets the policy for when samples arrive faster than they can be handled.
+*
+* @param  p           The policy.
+* @param  decimation  Under DECIMATE, keep one sample in this many. At least 2.
+*/
+void ManuManager::framePolicy(FramePolicy p, uint8_t decimation) {
+  _frame_policy   = p;
+  _decimate_n     = (decimation < 2) ? 2 : decimation;
+  _decimate_phase = 0;
+  _decimating     = false;
+}
+
+
+/**
+* The conversion as it was done before the tables, one IMU at a time. Kept
+*   as the reference for _bench_conversion().
+*/
+static void _scale_frame_reference(SensorFrame* frame, int16_t* buf, int16_t* mag) {
+  int16_t* offset = buf;
+  for (int i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
+    float scalar_a = imus[i].scaleA();
+    float scalar_g = imus[i].scaleG();
+    float ax, ay, az, gx, gy, gz;
+    if (imus[i].cancel_error()) {
+      ax = ((((int16_t) *(offset + 0)) - noise_floor_acc[i].x) * reflection_acc.x * scalar_a);
+      ay = ((((int16_t) *(offset + 1)) - noise_floor_acc[i].y) * reflection_acc.y * scalar_a);
+      az = ((((int16_t) *(offset + 2)) - noise_floor_acc[i].z) * reflection_acc.z * scalar_a);
+      gx = ((((int16_t) *(offset + 3)) - noise_floor_gyr[i].x) * reflection_gyr.x * scalar_g);
+      gy = ((((int16_t) *(offset + 4)) - noise_floor_gyr[i].y) * reflection_gyr.y * scalar_g);
+      gz = ((((int16_t) *(offset + 5)) - noise_floor_gyr[i].z) * reflection_gyr.z * scalar_g);
+    }
+    else {
+      ax = (((int16_t) *(offset + 0)) * reflection_acc.x * scalar_a);
+      ay = (((int16_t) *(offset + 1)) * reflection_acc.y * scalar_a);
+      az = (((int16_t) *(offset + 2)) * reflection_acc.z * scalar_a);
+      gx = (((int16_t) *(offset + 3)) * reflection_gyr.x * scalar_g);
+      gy = (((int16_t) *(offset + 4)) * reflection_gyr.y * scalar_g);
+      gz = (((int16_t) *(offset + 5)) * reflection_gyr.z * scalar_g);
+    }
+    frame->setI(i, ax, ay, az, gx, gy, gz);
+    float scalar_m = imus[i].scaleM();
+    frame->setM(
+      i,
+      (mag[i*3 + 0] * reflection_mag.x * scalar_m),
+      (mag[i*3 + 1] * reflection_mag.y * scalar_m),
+      (mag[i*3 + 2] * reflection_mag.z * scalar_m)
+    );
+    offset += 6;
+  }
+}
+
+
+/**
+* Times the table-driven conversion against the reference loop, over a frame
+*   of made-up data, and checks that they agree. Every IMU is converted, as
+*   if all were in the plan.
+*
+* @param  output      The buffer to receive the results.
+* @param  iterations  How many frames to convert with each method.
+*/
+void ManuManager::_bench_conversion(StringBuilder* output, uint32_t iterations) {
+  SensorFrame* f_ref = _take_frame();
+  SensorFrame* f_tab = _take_frame();
+  RawFrame*    raw   = _raw_pool.take();
+  if ((nullptr == f_ref) || (nullptr == f_tab) || (nullptr == raw)) {
+    output->concat("Conversion benchmark needs two free frames, and a raw one.\n");
+    if (f_ref) returnFrame(f_ref);
+    if (f_tab) returnFrame(f_tab);
+    if (raw)   _raw_pool.give(raw);
+    return;
+  }
+  uint32_t x = 0x2545F491;
+  for (int i = 0; i < MANU_FRAME_BUF_I_AG; i++) {
+    x ^= x << 13;  x ^= x >> 17;  x ^= x << 5;   // xorshift32
+    raw->ag[i] = (int16_t) x;
+  }
+  for (int i = 0; i < (3 * LEGEND_DATASET_IIU_COUNT); i++) {
+    x ^= x << 13;  x ^= x >> 17;  x ^= x << 5;
+    raw->m[i] = (int16_t) x;
+  }
+  raw->t_us      = 0;
+  raw->dt        = 0.0f;
+  raw->mask_i    = (1UL << LEGEND_DATASET_IIU_COUNT) - 1;
+  raw->mask_m    = (1UL << LEGEND_DATASET_IIU_COUNT) - 1;
+  raw->mag_fresh = 0;
+
+  uint32_t t0 = micros();
+  for (uint32_t n = 0; n < iterations; n++) _scale_frame_reference(f_ref, raw->ag, raw->m);
+  uint32_t t1 = micros();
+  for (uint32_t n = 0; n < iterations; n++) _scale_frame_i(f_tab, raw);
+  uint32_t t2 = micros();
+  _raw_pool.give(raw);
+
+  float worst = 0.0f;
+  for (int i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
+    const float d[9] = {
+      f_ref->acc(i).x - f_tab->acc(i).x, f_ref->acc(i).y - f_tab->acc(i).y, f_ref->acc(i).z - f_tab->acc(i).z,
+      f_ref->gyro(i).x - f_tab->gyro(i).x, f_ref->gyro(i).y - f_tab->gyro(i).y, f_ref->gyro(i).z - f_tab->gyro(i).z,
+      f_ref->mag(i).x - f_tab->mag(i).x, f_ref->mag(i).y - f_tab->mag(i).y, f_ref->mag(i).z - f_tab->mag(i).z
+    };
+    for (int j = 0; j < 9; j++) {
+      const float a = (d[j] < 0.0f) ? -d[j] : d[j];
+      if (a > worst) worst = a;
+    }
+  }
+  returnFrame(f_ref);
+  returnFrame(f_tab);
+
+  output->concatf("Frame conversion, %u iterations (%s):\n",
+    (unsigned int) iterations,
+    #if defined(__SSE2__)
+      "SSE2"
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      "NEON"
+    #else
+      "portable"
+    #endif
+  );
+  output->concatf("\tReference loop  %u us total  (%u ns/frame)\n", (unsigned int) (t1 - t0), (unsigned int) (((uint64_t) (t1 - t0) * 1000) / iterations));
+  output->concatf("\tTables          %u us total  (%u ns/frame)\n", (unsigned int) (t2 - t1), (unsigned int) (((uint64_t) (t2 - t1) * 1000) / iterations));
+  output->concatf("\tWorst difference  %.9f\n", (double) worst);
+}
+
+
 /**
 * When a bus operation completes, it is passed back to its issuing class.
 * Unlike r0, all IMU traffic calls back to this function, and not the individual
@@ -871,7 +1660,20 @@ int8_t ManuManager::io_op_callahead(BusOp* _op) {
 int8_t ManuManager::io_op_callback(BusOp* _op) {
   SPIBusOp* op = (SPIBusOp*) _op;
   int8_t return_value = SPI_CALLBACK_NOMINAL;
+  if ((op == &_preformed_read_i) && (XferFault::TIMEOUT == op->getFault())) {
+    // The bus skipped (or gave up on) the inertial read. The stream lives by
+    //   recycling this op, so re-arm it and go again for a fresh sample.
+    _frame_skips_i++;
+    _init_read_i(_frame_half_of(op->buf));
+    // Unless the FIFO bursts have the stream. fifoBurst(false) will re-arm it.
+    return fifoBurst() ? SPI_CALLBACK_NOMINAL : SPI_CALLBACK_RECYCLE;
+  }
   if (op->hasFault()) {
+    if (op == &_preformed_read_m) {
+      // Those samples are still waiting. The next DRDY_M will retry.
+      _mag_ready   |= _mag_inflight;
+      _mag_inflight = 0;
+    }
     if (getVerbosity() > 3) {
       local_log.concat("io_op_callback() rejected a callback because the bus op failed.\n");
       Kernel::log(&local_log);
@@ -879,7 +1681,7 @@ int8_t ManuManager::io_op_callback(BusOp* _op) {
     return SPI_CALLBACK_ERROR;
   }
 
-  uint8_t cpld_addr = op->getTransferParam(0);
+  uint8_t cpld_addr = op->getTransferParam(0) & 0x7F;   // Less the RW bit.
   uint8_t imu_count = op->getTransferParam(2);
   uint8_t reg_addr  = op->getTransferParam(3);
   RegID   idx       = RegPtrMap::regIdFromAddr(cpld_addr, reg_addr);
@@ -906,61 +1708,66 @@ int8_t ManuManager::io_op_callback(BusOp* _op) {
     case RegID::G_DATA_X:  // Then, the data is sent to the integrator.
     case RegID::G_DATA_Y:  //
     case RegID::G_DATA_Z:  //
-      {
-        // First, note the pointer relation.
-        float scalar_a;
-        float scalar_g;
-        float ax;
-        float ay;
-        float az;
-        float gx;
-        float gy;
-        float gz;
-        int16_t* offset = (int16_t*) op->buf;
-
-        // Scale the data
-        uint32_t this_frame_time = millis();
-        SensorFrame* nu_msrmnt = _frame_pool.take();
-        nu_msrmnt->time((this_frame_time - _frame_time_last)/1000.0f);
-        _frame_time_last = this_frame_time;
-        for (int i = 0; i < LEGEND_DATASET_IIU_COUNT; i++) {
-          scalar_a = imus[i].scaleA();
-          scalar_g = imus[i].scaleG();
-          if (imus[i].cancel_error()) {
-            ax = ((((int16_t) *(offset +  0)) - noise_floor_acc[i].x) * reflection_acc.x * scalar_a);
-            ay = ((((int16_t) *(offset +  2)) - noise_floor_acc[i].y) * reflection_acc.y * scalar_a);
-            az = ((((int16_t) *(offset +  4)) - noise_floor_acc[i].z) * reflection_acc.z * scalar_a);
-            gx = ((((int16_t) *(offset +  6)) - noise_floor_gyr[i].x) * reflection_gyr.x * scalar_g);
-            gy = ((((int16_t) *(offset +  8)) - noise_floor_gyr[i].y) * reflection_gyr.y * scalar_g);
-            gz = ((((int16_t) *(offset + 10)) - noise_floor_gyr[i].z) * reflection_gyr.z * scalar_g);
-          }
-          else {
-            ax = (((int16_t) *(offset +  0)) * reflection_acc.x * scalar_a);
-            ay = (((int16_t) *(offset +  2)) * reflection_acc.y * scalar_a);
-            az = (((int16_t) *(offset +  4)) * reflection_acc.z * scalar_a);
-            gx = (((int16_t) *(offset +  6)) * reflection_gyr.x * scalar_g);
-            gy = (((int16_t) *(offset +  8)) * reflection_gyr.y * scalar_g);
-            gz = (((int16_t) *(offset + 10)) * reflection_gyr.z * scalar_g);
-          }
-          nu_msrmnt->setI(i, ax, ay, az, gx, gy, gz);
-
-          if (true) {  // TODO
-            // If there is magnetometer data waiting, include it with the frame.
-            float scalar_m = imus[i].scaleM();
-            //float x = ((((int16_t)regValue(RegID::AG_DATA_X_M) - noise_floor_mag_mag.x) * reflection_vector_mag.x) * scaler);
-            //float y = ((((int16_t)regValue(RegID::AG_DATA_Y_M) - noise_floor_mag_mag.y) * reflection_vector_mag.y) * scaler);
-            //float z = ((((int16_t)regValue(RegID::AG_DATA_Z_M) - noise_floor_mag_mag.z) * reflection_vector_mag.z) * scaler);
-            nu_msrmnt->setM(
-              i,
-              (_reg_block_m_data[i*3 + 0] * reflection_mag.x * scalar_m),
-              (_reg_block_m_data[i*3 + 1] * reflection_mag.y * scalar_m),
-              (_reg_block_m_data[i*3 + 2] * reflection_mag.z * scalar_m)
-            );
-          }
-          offset += 12;
+      if (op == &_preformed_read_i) {
+        // Ping-pong. The half that was just filled becomes the stable half,
+        //   and the op is pointed at the other one before it is recycled.
+        //   Scaling is deferred to the integrator event, so that it overlaps
+        //   the next transfer rather than delaying it.
+        if (nullptr != _stable_half_i) {
+          // The last stable half was never converted, and it is about to be
+          //   handed back to the bus. It is lost.
+          _frame_overruns_i++;
+        }
+        _stable_half_i = (int16_t*) _frame_half_of(op->buf);
+        _stable_t_us   = _clock_us(_bus->xferDoneUs());
+        // If the read was chained, the magnetometer data came with it.
+        _stable_half_m = chainedFrames() ? (_stable_half_i + MANU_FRAME_BUF_I_AG) : _reg_block_m_data;
+        if (chainedFrames()) {
+          // Any IMU that raised DRDY_M since the last read has a new sample in
+          //   this one, unless the edge landed during the transfer itself.
+          //   That sample is then a read late, and is marked fresh regardless.
+          _mag_fresh |= _mag_ready & _plan.mask_m;
+          _mag_ready  = 0;
+        }
+        uint8_t* nxt = (uint8_t*) ((_stable_half_i == _frame_buf_i) ? &_frame_buf_i[MANU_FRAME_BUF_I_HALF] : _frame_buf_i);
+        if (_plan_stale & MANU_PLAN_STALE_I) {
+          _apply_plan_i(nxt);
+        }
+        else {
+          op->buf = nxt + _read_i_offset;
         }
-        // Send softened and scaled frame to the integrator.
-        sample_count++;
+      }
+      else if (op == &_preformed_burst_i) {
+        // Each FIFO gave up _burst_n samples, oldest first. Each sample
+        //   becomes its own frame, one sample period after the last.
+        //   The last sample was captured at the end of the transfer, and the
+        //   others are spaced back from it by the sample period.
+        int16_t* mag = chainedFrames() ? &_burst_buf[MANU_BURST_BUF_AG] : _reg_block_m_data;
+        const uint64_t t_done = _clock_us(_bus->xferDoneUs());
+        if ((0 != _frame_t_us) && (t_done > _frame_t_us)) {
+          _track_drift(t_done - _frame_t_us, _burst_n);
+        }
+        const float    dt    = _sample_period();
+        const uint32_t dt_us = (uint32_t) (dt * 1e6f);
+        if (chainedFrames()) {
+          // Fresh magnetometer samples go with the first frame of the burst.
+          _mag_fresh |= _mag_ready & _plan.mask_m;
+          _mag_ready  = 0;
+        }
+        for (uint8_t k = 0; k < _burst_n; k++) {
+          _intake_frame_i(&_burst_buf[6 * k], mag, (6 * _burst_n), t_done - ((uint64_t) (_burst_n - 1 - k) * dt_us), dt);
+        }
+        _bursts++;
+        _burst_samples += _burst_n;
+        _refresh_bus_demand();
+        _event_integrator.fireNow();
+        if (_burst_more) {
+          // The FIFOs held more than the burst could take. Go again.
+          read_fifo_depth();
+        }
+      }
+      else {
+        _intake_frame_i((int16_t*) op->buf, _reg_block_m_data, 6, _clock_us(_bus->xferDoneUs()), 0.0f);
       }
       break;
 
@@ -1009,6 +1816,22 @@ int8_t ManuManager::io_op_callback(BusOp* _op) {
     case RegID::M_STATUS_REG:
       break;
     case RegID::M_DATA_X:
+      if (op == &_preformed_read_m) {
+        // Only IMUs that raised DRDY_M before the read went out are known to
+        //   have new samples in it.
+        _mag_fresh   |= _mag_inflight & _plan.mask_m;
+        _mag_inflight = 0;
+        _mag_reads++;
+        if (_plan_stale & MANU_PLAN_STALE_M) {
+          _apply_plan_m();
+        }
+        if (_mag_ready & _plan.mask_m) {
+          // More samples arrived while this read was out. Go again.
+          _mag_inflight = _mag_ready;
+          _mag_ready    = 0;
+          return_value  = SPI_CALLBACK_RECYCLE;
+        }
+      }
       break;
     case RegID::M_DATA_Y:
       break;
@@ -1055,6 +1878,9 @@ int8_t ManuManager::io_op_callback(BusOp* _op) {
     case RegID::AG_STATUS_REG_ALT:
       break;
     case RegID::AG_FIFO_SRC:
+      if ((op == &_preformed_fifo_read) && fifoBurst()) {
+        _read_fifo_burst();
+      }
       break;
     case RegID::G_INT_GEN_CFG:
       break;
@@ -1079,9 +1905,11 @@ int8_t ManuManager::io_op_callback(BusOp* _op) {
   }
 
   if (op == &_preformed_read_i) {
+    _refresh_read_deadline();
+    _refresh_bus_demand();
     _event_integrator.fireNow();
-    // TODO: If the FIFO watermark IRQ signal is still asserted, read another batch.
-    return_value = SPI_CALLBACK_RECYCLE;
+    // In burst mode, the FIFOs are drained by _preformed_burst_i instead.
+    return_value = fifoBurst() ? SPI_CALLBACK_NOMINAL : SPI_CALLBACK_RECYCLE;
   }
 
   flushLocalLog();
@@ -1133,6 +1961,7 @@ int8_t ManuManager::attached() {
       noise_floor_acc[i].set(0, 0, 0);
       noise_floor_gyr[i].set(0, 0, 0);
     }
+    _cal_stale = true;
 
     /* Setup our pre-formed quat crunch event. */
     _event_integrator.repurpose(DIGITABULUM_MSG_IMU_QUAT_CRUNCH, this);
@@ -1159,6 +1988,11 @@ int8_t ManuManager::attached() {
     _set_target_state(ManuState::READY_IDLE);
 
     integrator.rangeBind(true);   // Range-bind everything....
+    #if defined(CONFIG_INTEGRATOR_THREADED)
+      if (0 != integrator.startWorker()) {
+        local_log.concat("Integrator failed to start its worker. Integrating in the kernel.\n");
+      }
+    #endif
     return 1;
   }
   return 0;
@@ -1199,7 +2033,9 @@ int8_t ManuManager::callback_proc(ManuvrMsg* event) {
 
     case DIGITABULUM_MSG_IMU_QUAT_CRUNCH:
       if (!debugFrameCycle()) {
-        if (integrator.has_quats_left()) {
+        // Only come back if the budget ran out. A stall on results would
+        //   otherwise spin the kernel.
+        if (_crunch_more) {
           return_value = EVENT_CALLBACK_RETURN_RECYCLE;
         }
       }
@@ -1249,15 +2085,52 @@ int8_t ManuManager::notify(ManuvrMsg* active_event) {
       break;
 
     case DIGITABULUM_MSG_IMU_QUAT_CRUNCH:
-      if (!integrator.has_quats_left()) {
-        // Debug to allow cycling frames without hardware.
-        uint32_t this_frame_time = millis();
-        SensorFrame* nu_msrmnt = _frame_pool.take();
-        nu_msrmnt->time((this_frame_time - _frame_time_last)/1000.0f);
-        _frame_time_last = this_frame_time;
-        integrator.pushFrame(nu_msrmnt);
-      }
-      integrator.churn();
+      if (nullptr != _stable_half_i) {
+        // Take in the stable half while the bus fills the other one.
+        _intake_frame_i(_stable_half_i, _stable_half_m, 6, _stable_t_us, 0.0f);
+        _stable_half_i = nullptr;
+      }
+      if (debugFrameCycle() && (ManuState::READY_READING != _current_state) && (0 == _raw_queue.count()) && !integrator.has_quats_left()) {
+        // Debug to allow cycling frames without hardware. These frames keep
+        //   time of their own, so real frames don't take dt from them.
+        const uint64_t now = _clock_us(micros());
+        SensorFrame* nu_msrmnt = _take_frame();
+        if (nullptr != nu_msrmnt) {
+          nu_msrmnt->time((0 != _fake_t_us) ? ((now - _fake_t_us) * 1e-6f) : 0.0f);
+          nu_msrmnt->captureTime(now);
+          _fake_t_us = now;
+          if (0 != integrator.pushFrame(nu_msrmnt)) reclaimMeasurement(nu_msrmnt);
+        }
+      }
+      if (integrator.threaded()) {
+        // The worker integrates. We only scale, as far as it has room. Whatever
+        //   doesn't fit waits for the next crunch.
+        _crunch_more = false;
+        if (0 < _raw_queue.count()) _scale_pending();
+      }
+      else {
+        // Scale and integrate by turns, until the backlog is cleared, or
+        //   can't move, or the budget is spent.
+        const uint32_t t0 = micros();
+        uint8_t done = 0;
+        _crunch_more = false;
+        while (true) {
+          const uint32_t spent = (uint32_t) (micros() - t0);
+          const bool out_of_frames = (0 != max_quats_per_event) && (done >= max_quats_per_event);
+          const bool out_of_time   = (0 != _crunch_budget_us) && (spent >= _crunch_budget_us);
+          if (out_of_frames || out_of_time) {
+            _crunch_more = integrator.has_quats_left() || (0 < _raw_queue.count());
+            break;
+          }
+          if (0 < _raw_queue.count()) _scale_pending();
+          const int8_t n = integrator.churn(
+            ((0 != _crunch_budget_us) ? (_crunch_budget_us - spent) : 0),
+            ((0 != max_quats_per_event) ? (max_quats_per_event - done) : 0)
+          );
+          if (0 >= n) break;
+          done += n;
+        }
+      }
       return_value++;
       break;
 
@@ -1391,9 +2264,38 @@ void ManuManager::printDebug(StringBuilder *output) {
   }
   grav_consensus /= 17;
   output->concatf("-- Gravity consensus:  %.4fg\n", (double) grav_consensus);
-  output->concatf("-- Max quat proc       %u\n",    max_quats_per_event);
+  output->concatf("-- Crunch budget       %u frames, %u us\n", max_quats_per_event, (unsigned int) _crunch_budget_us);
   output->concatf("-- Identities read     %c\n",    imuIdentitiesRead() ? 'y':'n');
   output->concatf("-- sample_count        %d\n",    sample_count);
+  output->concatf("-- Inertial overruns   %u\n",    _frame_overruns_i);
+  output->concatf("-- Raw frame pool      %u of %u out (high-water %u, %u queued)  %s\n", _raws_out, PREALLOCD_RAW_FRAMES, _raws_out_max, _raw_queue.count(), getFramePolicyString(_frame_policy));
+  output->concatf("-- Result frame pool   %u of %u out (high-water %u, %u stalls)\n", _frames_out, PREALLOCD_IMU_FRAMES, _frames_out_max, (unsigned int) _result_stalls);
+  output->concatf("-- Unwritten reads     %u\n", (unsigned int) SensorFrame::unwrittenReads());
+  output->concatf("-- Frame drops         pool %u  pending %u  decimated %u\n",
+    (unsigned int) _frame_drops[MANU_DROP_POOL],
+    (unsigned int) _frame_drops[MANU_DROP_PENDING],
+    (unsigned int) _frame_drops[MANU_DROP_DECIMATED]
+  );
+  output->concatf("-- Time starved        %uus%s\n", (unsigned int) _starved_us, (_starving ? " (starving now)" : ""));
+  output->concatf("-- Sample period       %.1fus (drift x%.5f, dt from %s)\n", (double) (_sample_period() * 1e6f), (double) _odr_drift, (dtFromODR() ? "ODR" : "timestamps"));
+  output->concatf("-- Mag reads           %u  (%u fresh samples, waiting 0x%05x)\n", (unsigned int) _mag_reads, (unsigned int) _mag_fresh_count, (unsigned int) (_mag_ready | _mag_inflight));
+  output->concatf("-- Inertial skips      %u (deadline %uus)\n", _frame_skips_i, _read_deadline_us);
+  output->concatf("-- Chained A/G/M reads %s (%u runs)\n", (chainedFrames() ? "yes":"no"), (unsigned int) _frame_chain.runs());
+  output->concatf("-- Read plan           I 0x%05x (%u runs, %u bytes)  M 0x%05x (%u runs, %u bytes)%s\n",
+    (unsigned int) _plan.mask_i, _plan.runs_i, _plan.bytes_i,
+    (unsigned int) _plan.mask_m, _plan.runs_m, _plan.bytes_m,
+    (_plan_stale ? "  (pending)" : "")
+  );
+  output->concatf("-- Read plan rebuilds  %u\n", (unsigned int) _plan_rebuilds);
+  output->concatf("-- Conversion tables   %u rebuilds%s\n", (unsigned int) _cal_refreshes, (_cal_stale ? " (stale)" : ""));
+  output->concatf("-- FIFO bursts         %s  %u bursts, %u samples/IMU, %u starved\n",
+    (fifoBurst() ? "on ":"off"),
+    (unsigned int) _bursts, (unsigned int) _burst_samples, (unsigned int) _burst_starved
+  );
+  if (getVerbosity() > 4) {
+    _frame_chain.printDebug(output);
+    _mag_chain.printDebug(output);
+  }
 
   if (getVerbosity() > 3) {
     output->concatf("-- MAX_DATASET_SIZE    %u\n",    (unsigned long) LEGEND_MGR_MAX_DATASET_SIZE);
@@ -1439,6 +2341,14 @@ static const ConsoleCommand console_cmds[] = {
   { "i4", "Frame pool info" },
   { "i5", "Type sizes" },
   { "i6", "FIFO levels" },
+  { "i8", "Benchmark frame conversion" },
+  { "i9", "Benchmark Madgwick kernels" },
+  { "i10", "Benchmark orientation filters" },
+  { "H", "Chain mag reads onto inertial reads" },
+  { "F", "Drain FIFOs in bursts (0 to disable)" },
+  { "D", "Frame dt from ODR (0 for timestamps)" },
+  { "P", "Frame policy (0 drop newest, 1 drop oldest, N decimate by N)" },
+  { "h", "Read mag separately" },
 
   { "E", "Set data encoding" },
 
@@ -1455,9 +2365,12 @@ static const ConsoleCommand console_cmds[] = {
   { "y", "Disable bearing nullification" },
 
   { "Q", "Set Madgwick iterations" },
-  { ",", "Quats per event" },
+  { ",", "Quats per event (0 for no limit)" },
+  { "C", "Integration time budget per event, in us (0 for no limit)" },
   { "b", "Set Madjwick beta" },
+  { "A", "Orientation filter (1 Mahony, 2 Madgwick, 3 ESKF)" },
   { "L", "Set sample rate profile" },
+  { "K", "Hand skeleton (N scales it to N% of average, 0 to show)" },
   { "o", "Set GYR base filter" },
   { "O", "Set ACC base filter" }
 };
@@ -1524,13 +2437,34 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
           printIMURollCall(&local_log);   // Show us the results, JIC
           break;
         case 4:
+          local_log.concat("Result frames:\n");
           _frame_pool.printDebug(&local_log);
+          local_log.concat("Raw frames:\n");
+          _raw_pool.printDebug(&local_log);
           break;
         case 5:
           local_log.concatf("\nsizeof(ManuLegendPipe)\t%u\n", sizeof(ManuLegendPipe));
           local_log.concatf("sizeof(ManuLegend)  \t%u\n", sizeof(ManuLegend));
           local_log.concatf("sizeof(Integrator)  \t%u\n", sizeof(Integrator));
-          local_log.concatf("sizeof(SensorFrame) \t%u\n", sizeof(SensorFrame));
+          local_log.concatf("sizeof(SensorFrame) \t%u  (x%u)\n", sizeof(SensorFrame), PREALLOCD_IMU_FRAMES);
+          local_log.concatf("sizeof(RawFrame)    \t%u  (x%u)\n", sizeof(RawFrame), PREALLOCD_RAW_FRAMES);
+          {
+            // What a wipe costs, for a frame the read plan filled.
+            SensorFrame* frame = _take_frame();
+            if (nullptr != frame) {
+              uint32_t t_wipe = 0;
+              for (uint16_t n = 0; n < 1000; n++) {
+                for (uint32_t m = _plan.mask_i; 0 != m; m &= (m - 1)) {
+                  frame->setI(__builtin_ctz(m), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+                }
+                const uint32_t t0 = micros();
+                frame->wipe();
+                t_wipe += micros() - t0;
+              }
+              returnFrame(frame);
+              local_log.concatf("SensorFrame::wipe() \t%uns\n", (unsigned int) t_wipe);
+            }
+          }
           local_log.concatf("sizeof(LSM9DS1)     \t%u\n", sizeof(LSM9DS1));
           local_log.concatf("sizeof(RegPtrMap)   \t%u\n", sizeof(RegPtrMap));
           local_log.concatf("sizeof(_frame_buf_i)\t%u\n", sizeof(_frame_buf_i));
@@ -1541,6 +2475,24 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
         case 7:
           printFIFOLevels(&local_log);
           break;
+        case 8:
+          _bench_conversion(&local_log, 10000);
+          break;
+        case 9:
+          {
+            SensorFrame* frame = _take_frame();
+            if (nullptr != frame) {
+              integrator.benchKernels(frame, &local_log, 1000);
+              returnFrame(frame);
+            }
+            else {
+              local_log.concat("Kernel benchmark needs a free frame.\n");
+            }
+          }
+          break;
+        case 10:
+          integrator.benchFilters(&local_log, 2000);
+          break;
 
         case 0:
         default:
@@ -1572,7 +2524,10 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
       switch (temp_byte) {
         case 1:
           local_log.concat("Pushing SensorFrame into integrator...\n");
-          integrator.pushFrame(_frame_pool.take());
+          {
+            SensorFrame* frame = _take_frame();
+            if ((nullptr != frame) && (0 != integrator.pushFrame(frame))) reclaimMeasurement(frame);
+          }
           break;
         case 2:
           local_log.concat("Cycling the integrator...\n");
@@ -1584,7 +2539,10 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
         case 4:
           debugFrameCycle(true);
           local_log.concat("Frame cycle started.\n");
-          integrator.pushFrame(_frame_pool.take());
+          {
+            SensorFrame* frame = _take_frame();
+            if ((nullptr != frame) && (0 != integrator.pushFrame(frame))) reclaimMeasurement(frame);
+          }
           _event_integrator.enableSchedule(true);
           break;
         case 5:
@@ -1592,6 +2550,16 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
           local_log.concat("Frame cycle stopped.\n");
           _event_integrator.enableSchedule(false);
           break;
+        case 6:
+          integrator.laneKernel(!integrator.laneKernel());
+          local_log.concatf("Integrator uses the %s kernel.\n", integrator.laneKernel() ? madgwick_soa_isa() : "scalar");
+          break;
+        case 7:
+          if (0 != (integrator.threaded() ? integrator.stopWorker() : integrator.startWorker())) {
+            local_log.concat("Integrator worker failed to change state.\n");
+          }
+          local_log.concatf("Integrator runs in the %s.\n", integrator.threaded() ? "worker" : "kernel");
+          break;
         default:
           break;
       }
@@ -1718,6 +2686,7 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
           break;
       }
       local_log.concatf("Reflection vectors\n\tMag (%d, %d, %d)\n\tAcc (%d, %d, %d)\n\tGyr (%d, %d, %d)\n", reflection_mag.x, reflection_mag.y, reflection_mag.z, reflection_acc.x, reflection_acc.y, reflection_acc.z, reflection_gyr.x, reflection_gyr.y, reflection_gyr.z);
+      _cal_stale = true;
       break;
 
     case '[':
@@ -1738,6 +2707,34 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
       integrator.dropObviousBadMag((*(str) == 'Z'));
       break;
 
+    case 'h':
+    case 'H':
+      if (0 == chainedFrames(*(str) == 'H')) {
+        local_log.concatf("%sabled chained A/G/M frame reads.\n", (chainedFrames() ? "En":"Dis"));
+      }
+      else {
+        local_log.concat("Could not change frame chaining.\n");
+      }
+      break;
+
+    case 'F':
+      fifoBurst(0 != temp_byte);
+      local_log.concatf("%sabled FIFO burst reads.\n", (fifoBurst() ? "En":"Dis"));
+      break;
+
+    case 'P':
+      // 0: drop newest, 1: drop oldest pending, N: decimate by N.
+      framePolicy((temp_byte > 1) ? FramePolicy::DECIMATE : (FramePolicy) temp_byte, temp_byte);
+      local_log.concatf("Frame policy is now %s", getFramePolicyString(framePolicy()));
+      if (FramePolicy::DECIMATE == framePolicy()) local_log.concatf(" (1 in %u)", _decimate_n);
+      local_log.concat(".\n");
+      break;
+
+    case 'D':
+      dtFromODR(0 != temp_byte);
+      local_log.concatf("Frame dt now comes from %s.\n", (dtFromODR() ? "the ODR, corrected for drift" : "capture timestamps"));
+      break;
+
     case 'z':
     case 'Z':
       local_log.concatf("%sabling autoscale on all IMUs.\n", ((*(str) == 'Z') ? "En":"Dis"));
@@ -1774,15 +2771,39 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
       local_log.concatf("IIU class now runs a maximum of %u quats per event.\n", max_quats_per_event);
       break;
 
+    case 'C':
+      _crunch_budget_us = atoi((char*) str+1);
+      local_log.concatf("Integration now stops after %u us per event (0 is no limit).\n", (unsigned int) _crunch_budget_us);
+      break;
+
     case 'b':
-      integrator.beta = (float)temp_byte * 0.1;
-      local_log.concatf("Beta value is now %f.\n", (double) integrator.beta);
+      integrator.beta((float)temp_byte * 0.1);
+      local_log.concatf("Beta value is now %f.\n", (double) integrator.beta());
+      break;
+
+    case 'A':
+      if ((temp_byte > 0) && (temp_byte <= (uint8_t) FusionFilter::ESKF)) {
+        integrator.filter((FusionFilter) temp_byte);
+      }
+      local_log.concatf("Orientation filter is %s. Running %s.\n", fusion_filter_name(integrator.filter()), fusion_filter_name(integrator.activeFilter()));
+      break;
+
+    case 'K':
+      if (temp_byte > 0) {
+        HandSkeleton skel;
+        hand_skeleton_default(&skel);
+        hand_skeleton_scale(&skel, temp_byte * 0.01f);
+        integrator.skeleton(&skel);
+        local_log.concatf("Hand skeleton is now %u%% of average.\n", temp_byte);
+      }
+      integrator.printSkeleton(&local_log);
       break;
 
     case 'L':
       for (uint8_t i = 0; i < 17; i++) {
         imus[i].setSampleRateProfile(temp_byte);
       }
+      _refresh_bus_demand();
       local_log.concatf("Moving to sample rate profile %d.\n", temp_byte);
       break;
 
@@ -1839,7 +2860,7 @@ void ManuManager::consoleCmdProc(StringBuilder* input) {
       queue_io_job(&_preformed_read_temp);
       break;
     case '@':   // Mag
-      queue_io_job(&_preformed_read_m);
+      read_mag_frame();
       break;
     case '#':   // Intertial
       queue_io_job(&_preformed_read_i);
@@ -1880,12 +2901,144 @@ int8_t ManuManager::read_fifo_depth() {
   return queue_io_job(&_preformed_fifo_read);
 }
 
+
+/**
+* Sizes and queues a burst from the levels in __fifo_levels. Every IMU in the
+*   plan has at least the burst's worth of samples waiting, so each gives up
+*   the same number, and the frames built from them stay aligned in time.
+*
+* @return 0 if a burst was queued, 1 if there was nothing to take, or negative
+*   if the burst couldn't be queued.
+*/
+int8_t ManuManager::_read_fifo_burst() {
+  uint8_t least = 0x3F;
+  for (uint32_t m = _plan.mask_i; 0 != m; m &= (m - 1)) {
+    const uint8_t lvl = __fifo_levels[__builtin_ctz(m)] & 0x3F;   // FSS
+    if (lvl < least) least = lvl;
+  }
+  if (0 == least) {
+    _burst_starved++;
+    return 1;
+  }
+  if (XferState::IDLE != _preformed_burst_i.get_state()) return -1;
+
+  _burst_n    = (least > MANU_FIFO_BURST_MAX) ? MANU_FIFO_BURST_MAX : least;
+  _burst_more = (least > _burst_n);
+  _shape_read_i(
+    &_preformed_burst_i, &_burst_chain, (uint8_t*) _burst_buf, _burst_n,
+    chainedFrames() ? (uint8_t*) &_burst_buf[MANU_BURST_BUF_AG] : nullptr
+  );
+  return queue_io_job(&_preformed_burst_i);
+}
+
+
+/**
+* In burst mode, the inertial stream is replaced by reads of the FIFO levels
+*   (on the watermark IRQ), each followed by a burst that takes as many
+*   samples as every FIFO can give. This trades latency for far fewer bus
+*   transactions per sample at high rates.
+*
+* @param  en  true to drain the FIFOs in bursts.
+* @return 0 on success.
+*/
+int8_t ManuManager::fifoBurst(bool en) {
+  if (en != fifoBurst()) {
+    _er_set_flag(LEGEND_MGR_FLAGS_FIFO_BURST, en);
+    if (en && (XferState::IDLE == _preformed_fifo_read.get_state())) {
+      // The watermark might already be up, in which case no edge is coming.
+      read_fifo_depth();
+    }
+    if (!en && (XferState::IDLE == _preformed_read_i.get_state())) {
+      // The inertial stream was let go in burst mode. Nothing else will
+      //   start it again.
+      _apply_plan_i(_frame_half_of(_preformed_read_i.buf));
+      read_ag_frame();
+    }
+    _refresh_bus_demand();
+  }
+  return 0;
+}
+
+/**
+* Chaining the magnetometer read onto the inertial read means that every
+*   inertial frame arrives with its magnetometer data, in one bus callback.
+* The change is made through the read plan, so it takes effect when each
+*   read is next off the bus.
+*
+* @param  en  true to chain the reads.
+* @return 0 on success.
+*/
+int8_t ManuManager::chainedFrames(bool en) {
+  if (en != chainedFrames()) {
+    _er_set_flag(LEGEND_MGR_FLAGS_CHAINED_FRAMES, en);
+    _demand_changed();
+  }
+  return 0;
+}
+
+
 int8_t ManuManager::read_ag_frame() {
   return queue_io_job(&_preformed_read_i);
 }
 
+/**
+* Reads the magnetometers in the plan. Called on DRDY_M. If a read is already
+*   out, the IMUs that asked will be picked up when it returns.
+*
+* @return 0 on success, or if there was nothing to do.
+*/
 int8_t ManuManager::read_mag_frame() {
-  return queue_io_job(&_preformed_read_m);
+  // When chained, or when no magnetometers are wanted, there is nothing to do.
+  if (chainedFrames() || (0 == _plan.runs_m)) return 0;
+  if (XferState::IDLE != _preformed_read_m.get_state()) return 0;
+  const int8_t ret = queue_io_job(&_preformed_read_m);
+  if (0 == ret) {
+    _mag_inflight = _mag_ready;
+    _mag_ready    = 0;
+  }
+  return ret;
+}
+
+
+/**
+* Tells the bus what the sensor reads cost at the present sample rates, so the
+*   CPLD clock can be governed to suit. The bus ignores repeat declarations, so
+*   this is cheap enough to call once per inertial frame.
+* When frames are chained, the magnetometer data rides along with every
+*   inertial read, at the inertial rate. Costs follow the read plan, so they
+*   scale with the number of sensors wanted.
+*/
+void ManuManager::_refresh_bus_demand() {
+  const float dt_i = imus[0].deltaT_I();
+  const float dt_m = imus[0].deltaT_M();
+  const uint32_t hz_i = (dt_i > 0.0f) ? (uint32_t) ((1.0f / dt_i) + 0.5f) : 0;
+  const uint32_t hz_m = (dt_m > 0.0f) ? (uint32_t) ((1.0f / dt_m) + 0.5f) : 0;
+  uint32_t ops   = 0;
+  uint32_t bytes = 0;
+  if (fifoBurst()) {
+    // Each burst costs a level read as well. Assume the last burst's size.
+    const uint32_t n      = (_burst_n > 0) ? _burst_n : 1;
+    const uint32_t mag_rt = chainedFrames() ? _plan.runs_m : 0;
+    ops   += (hz_i / n) * (1 + _plan.runs_i + mag_rt);
+    bytes += (hz_i / n) * LEGEND_DATASET_IIU_COUNT;
+    bytes += hz_i * _plan.bytes_i;
+    if (chainedFrames()) {
+      bytes += (hz_i / n) * _plan.bytes_m;
+    }
+    else {
+      ops   += hz_m * _plan.runs_m;
+      bytes += hz_m * _plan.bytes_m;
+    }
+  }
+  else if (chainedFrames()) {
+    ops   += hz_i * (_plan.runs_i + _plan.runs_m);
+    bytes += hz_i * (_plan.bytes_i + _plan.bytes_m);
+  }
+  else {
+    ops   += (hz_i * _plan.runs_i) + (hz_m * _plan.runs_m);
+    bytes += (hz_i * _plan.bytes_i) + (hz_m * _plan.bytes_m);
+  }
+  _bus->setBusDemand(ops, bytes);
 }
 
 
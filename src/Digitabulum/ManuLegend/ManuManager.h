@@ -58,6 +58,8 @@ In Digitabulum r0, this class held 17 instances of the IIU class, each of which
 */
 #define LEGEND_MGR_FLAGS_CHIRALITY_KNOWN       0x01   // Has the chirality been determined?
 #define LEGEND_MGR_FLAGS_CHIRALITY_LEFT        0x02   // If so, is it a left hand?
+#define LEGEND_MGR_FLAGS_CHAINED_FRAMES        0x04   // Mag reads ride along with inertial reads.
+#define LEGEND_MGR_FLAGS_FIFO_BURST            0x08   // Inertial data is drained from the FIFOs in bursts.
 #define LEGEND_MGR_FLAGS_IO_ON_HIGH_FRAME_AG   0x10   //
 #define LEGEND_MGR_FLAGS_IO_ON_HIGH_FRAME_M    0x20   //
 #define LEGEND_MGR_FLAGS_EMPTY_FRAME_CYCLE     0x40   //
@@ -67,12 +69,30 @@ In Digitabulum r0, this class held 17 instances of the IIU class, each of which
 
 
 #ifndef PREALLOCD_IMU_FRAMES
-  #define PREALLOCD_IMU_FRAMES    10   // We retain this many frames.
+  #define PREALLOCD_IMU_FRAMES     6   // We retain this many result frames.
 #endif
-#ifndef CONFIG_INTEGRATOR_Q_DEPTH
-  #define CONFIG_INTEGRATOR_Q_DEPTH  PREALLOCD_IMU_FRAMES
+#ifndef PREALLOCD_RAW_FRAMES
+  #define PREALLOCD_RAW_FRAMES    16   // Raw samples that can wait for scaling.
 #endif
 
+/* Places in the frame pipeline where a sample can be lost. */
+#define MANU_DROP_POOL         0   // No free raw frame for the sample.
+#define MANU_DROP_PENDING      1   // An unscaled raw frame gave way to a newer one.
+#define MANU_DROP_DECIMATED    2   // Skipped by decimation.
+#define MANU_DROP_STAGES       3
+
+// What one more CPLD transaction costs, in byte-times on the wire. Runs of
+//   sensors separated by fewer unneeded bytes than this are read as one run.
+#define MANU_READ_RUN_OVERHEAD  CPLD_CLK_GOV_OP_OVERHEAD
+#define MANU_READ_MAX_RUNS      (CPLD_SPI_CHAIN_SEGMENTS + 1)
+
+#ifndef MANU_FIFO_BURST_MAX
+  // Most samples taken from each IMU's FIFO in one burst. The CPLD's XFER_LEN
+  //   is a byte, so no more than 21 12-byte samples fit in one transaction.
+  #define MANU_FIFO_BURST_MAX     8
+#endif
+static_assert((MANU_FIFO_BURST_MAX > 0) && ((12 * MANU_FIFO_BURST_MAX) < 256), "MANU_FIFO_BURST_MAX must be in [1, 21].");
+
 
 /*
 * This class is the authoritative maintainer of the state of the sensor package
@@ -92,6 +112,16 @@ enum class ManuState : uint8_t {
   FAULT           // The class experienced a fault.
 };
 
+/*
+* What to do when samples arrive faster than frames can be integrated and
+*   collected.
+*/
+enum class FramePolicy : uint8_t {
+  DROP_NEWEST = 0,  // The incoming sample is lost.
+  DROP_OLDEST = 1,  // The oldest frame awaiting integration is lost instead.
+  DECIMATE    = 2   // While the pool runs low, keep only one sample in N.
+};
+
 /*
 * Wetware is chiral. Hardware is not.
 */
@@ -115,6 +145,31 @@ enum class Anatomical : uint8_t {
   UNKNOWN     = 6
 };
 
+/*
+* A run of IMUs with consecutive CPLD addresses, which the CPLD can read in one
+*   transaction.
+*/
+typedef struct {
+  uint8_t first;   // Index of the first IMU.
+  uint8_t count;   // How many IMUs.
+} IMURun;
+
+/*
+* The shape of the preformed sensor reads. Only the IMUs that the legend wants,
+*   and that are present, are read. Each IMU's data lands in its own slot in
+*   the frame, regardless of what is read around it.
+*/
+typedef struct {
+  uint32_t mask_i;                         // IMUs whose inertial data is read.
+  uint32_t mask_m;                         // IMUs whose magnetometer data is read.
+  uint16_t bytes_i;                        // Inertial bytes per read.
+  uint16_t bytes_m;                        // Magnetometer bytes per read.
+  uint8_t  runs_i;                         // Transactions in the inertial read.
+  uint8_t  runs_m;                         // Transactions in the magnetometer read.
+  IMURun   run_i[MANU_READ_MAX_RUNS];
+  IMURun   run_m[MANU_READ_MAX_RUNS];
+} ReadPlan;
+
 
 /*
 * The ManuManager is a system service that deals with interpreting the raw data generated by
@@ -162,7 +217,8 @@ class ManuManager : public EventReceiver,
     int8_t read_ag_frame();
     int8_t read_mag_frame();
 
-    int8_t deliverIRQ(DigitPort, uint8_t imu, uint8_t data, uint8_t svc);
+    int8_t deliverIRQ(DigitPort, uint8_t imu, uint8_t data, uint8_t svc, uint32_t t_us);
+    void   digitPresenceChanged();
 
     /* Expose our idea about handedness to other modules. */
     int set_chirality(Chirality);
@@ -174,15 +230,25 @@ class ManuManager : public EventReceiver,
     inline bool debugFrameCycle() {           return (_er_flag(LEGEND_MGR_FLAGS_EMPTY_FRAME_CYCLE));           };
     inline void debugFrameCycle(bool nu) {    return (_er_set_flag(LEGEND_MGR_FLAGS_EMPTY_FRAME_CYCLE, nu));   };
 
+    inline bool chainedFrames() {             return (_er_flag(LEGEND_MGR_FLAGS_CHAINED_FRAMES));              };
+    int8_t chainedFrames(bool);
+
+    inline bool fifoBurst() {                 return (_er_flag(LEGEND_MGR_FLAGS_FIFO_BURST));                  };
+    int8_t fifoBurst(bool);
+
+    /* Should frame dt be the IMUs' nominal sample period (corrected for drift)? */
+    inline bool dtFromODR() {                 return _dt_from_odr;    };
+    inline void dtFromODR(bool nu) {          _dt_from_odr = nu;      };
+
     inline bool imuIdentitiesRead() {         return (_er_flag(LEGEND_MGR_FLAGS_IMU_IDENT_WAS_READ));          };
     inline void imuIdentitiesRead(bool nu) {  return (_er_set_flag(LEGEND_MGR_FLAGS_IMU_IDENT_WAS_READ, nu));  };
 
     inline bool hasFrame() {           return integrator.resultsWaiting();   };
     inline SensorFrame* takeFrame() {  return integrator.takeResult();       };
-    inline void returnFrame(SensorFrame* frame) {
-      frame->wipe();
-      _frame_pool.give(frame);
-    };
+    inline void returnFrame(SensorFrame* frame) {  reclaimMeasurement(frame);  };
+
+    inline FramePolicy framePolicy() {     return _frame_policy;   };
+    void framePolicy(FramePolicy, uint8_t decimation = 2);
 
     inline uint32_t totalSamples() {   return sample_count;   };
     inline ManuState getState() {      return _current_state; };
@@ -201,6 +267,8 @@ class ManuManager : public EventReceiver,
   private:
     CPLDDriver* _bus;      // This is the gateway to the hardware.
     ElementPool<SensorFrame> _frame_pool;
+    ElementPool<RawFrame>    _raw_pool;
+    RingBuffer<RawFrame*>    _raw_queue;   // Raw samples, oldest first, awaiting scaling.
     ManuvrMsg event_iiu_read;
     ManuvrMsg _event_integrator;
 
@@ -215,18 +283,86 @@ class ManuManager : public EventReceiver,
     uint32_t*       _ptr_sequence = nullptr;
     float*          _ptr_delta_t  = nullptr;
     uint32_t  sample_count       = 0;   // How many samples have we read since init?
-    uint32_t  _frame_time_last   = 0;   // Used to track inter-frame time differences.
-
-    uint8_t  max_quats_per_event = 2;   // Cuts down on overhead if load is high.
+    uint64_t  _frame_t_us        = 0;   // Capture time of the last frame.
+    uint64_t  _fake_t_us         = 0;   // Capture time of the last frame of a debug frame cycle.
+    uint64_t  _us_clock          = 0;   // The latest time seen by _clock_us().
+    uint64_t  _stable_t_us       = 0;   // Capture time of the stable inertial half.
+    float     _odr_drift         = 1.0f;     // Measured sample period over nominal.
+    bool      _dt_from_odr       = false;    // Take dt from the ODR, rather than timestamps.
+    uint32_t  _frame_overruns_i  = 0;   // Inertial halves overwritten before being scaled.
+    uint32_t  _frame_skips_i     = 0;   // Inertial reads the bus skipped as stale.
+    uint32_t  _read_deadline_us  = 0;   // Deadline given to the bus for inertial reads.
+    int16_t*  _stable_half_i     = nullptr;  // Inertial half awaiting conversion, if any.
+    int16_t*  _stable_half_m     = nullptr;  // The magnetometer data that goes with it.
+    ReadPlan  _plan;                         // What the sensor reads should look like.
+    uint32_t  _plan_rebuilds     = 0;        // How many times the plan has changed.
+    uint16_t  _read_i_offset     = 0;        // Where the inertial op's buffer sits in its half.
+    uint8_t   _plan_stale        = 0;        // Which preformed reads still need the plan.
+    uint32_t  _bursts            = 0;        // FIFO bursts read.
+    uint32_t  _burst_samples     = 0;        // Samples per IMU taken in those bursts.
+    uint32_t  _burst_starved     = 0;        // FIFO level reads that found nothing to take.
+    uint8_t   _burst_n           = 0;        // Samples per IMU in the burst on the bus.
+    bool      _burst_more        = false;    // Did the FIFOs hold more than the burst took?
+    uint32_t  _cal_epoch         = 0;        // LSM9DS1::scaleEpoch() when the tables were built.
+    uint32_t  _cal_refreshes     = 0;        // How many times the tables were built.
+    bool      _cal_stale         = true;     // Reflection or calibration changed.
+    uint32_t  _mag_ready         = 0;        // IMUs whose DRDY_M rose since their last mag read.
+    uint32_t  _mag_inflight      = 0;        // IMUs whose new samples the mag read in flight will fetch.
+    uint32_t  _mag_fresh         = 0;        // IMUs with a mag sample that no frame has carried yet.
+    uint32_t  _mag_reads         = 0;        // Mag reads completed.
+    uint32_t  _mag_fresh_count   = 0;        // Fresh mag samples handed to frames.
+    uint32_t  _frame_drops[MANU_DROP_STAGES];    // Samples lost, by where.
+    uint32_t  _starved_us        = 0;        // Total time the raw pool has been empty.
+    uint32_t  _starve_since_us   = 0;        // When the raw pool last ran dry.
+    uint32_t  _result_stalls     = 0;        // Raw frames that waited on a result frame.
+    uint32_t  _raw_carry_fresh   = 0;        // Fresh mag bits of dropped raw frames.
+    float     _raw_carry_dt      = 0.0f;     // Time steps of dropped raw frames.
+    uint16_t  _frames_out        = 0;        // Result frames taken from the pool, and not yet returned.
+    uint16_t  _frames_out_max    = 0;        // High-water mark of the above.
+    uint16_t  _raws_out          = 0;        // Raw frames taken from the pool, and not yet scaled.
+    uint16_t  _raws_out_max      = 0;        // High-water mark of the above.
+    uint16_t  _lost_run          = 0;        // Samples lost since the last frame was sent.
+    uint8_t   _decimate_n        = 2;        // Under DECIMATE, keep one sample in this many.
+    uint8_t   _decimate_phase    = 0;
+    FramePolicy _frame_policy    = FramePolicy::DROP_NEWEST;
+    bool      _decimating        = false;    // Is the raw pool low enough to decimate?
+    bool      _starving          = false;    // Is the raw pool empty?
+
+    uint8_t  max_quats_per_event = 8;   // Frame budget per QUAT_CRUNCH. 0 for no limit.
+    uint32_t _crunch_budget_us   = 1000; // Time budget per QUAT_CRUNCH. 0 for no limit.
+    bool     _crunch_more        = false; // Did the last QUAT_CRUNCH leave work for lack of budget?
     ManuState _last_state    = ManuState::UNKNOWN;
     ManuState _current_state = ManuState::UNKNOWN;
     ManuState _target_state  = ManuState::UNKNOWN;
 
-    /* The pool of SensorFrames is maintained by ManuManager. */
+    /* The pools of SensorFrames and RawFrames are maintained by ManuManager. */
     void reclaimMeasurement(SensorFrame*);
+    SensorFrame* _take_frame();
+    RawFrame*    _take_raw();
+    void         _give_raw(RawFrame*);
+    int8_t       _scale_pending();
+    static const char* getFramePolicyString(FramePolicy);
 
     int8_t send_map_event();
 
+    int8_t _intake_frame_i(int16_t*, int16_t*, uint16_t stride, uint64_t t_us, float dt);
+    uint64_t _clock_us(uint32_t);
+    void   _track_drift(uint64_t span_us, uint8_t samples);
+    float  _sample_period();
+    void   _scale_frame_i(SensorFrame*, RawFrame*);
+    void   _refresh_cal();
+    void   _bench_conversion(StringBuilder*, uint32_t iterations);
+    void   _init_read_i(uint8_t*);
+    int8_t _read_fifo_burst();
+    uint16_t _shape_read_i(SPIBusOp*, SPIBusChain*, uint8_t* base, uint8_t n, uint8_t* mag);
+    void   _plan_reads();
+    void   _apply_plan_i(uint8_t*);
+    void   _apply_plan_m();
+    void   _demand_changed();
+    int8_t _push_demand();
+    void   _refresh_read_deadline();
+    void   _refresh_bus_demand();
+
     int8_t init_iius();
     int8_t read_identities();
     int8_t read_fifo_depth();
@@ -263,6 +399,10 @@ class ManuManager : public EventReceiver,
     static SPIBusOp _preformed_read_m;
     static SPIBusOp _preformed_read_temp;
     static SPIBusOp _preformed_fifo_read;
+    static SPIBusOp _preformed_burst_i;  // Takes several samples from each FIFO.
+    static SPIBusChain _frame_chain;     // Runs the inertial runs, and maybe the mag runs, as one op.
+    static SPIBusChain _mag_chain;       // Runs the mag runs as one op, when they are read separately.
+    static SPIBusChain _burst_chain;     // Runs the burst's runs as one op.
 };
 
 #endif  // __DIGITABULUM_MANU_MGR_H_
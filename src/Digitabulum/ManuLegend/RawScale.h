@@ -0,0 +1,79 @@
+/*
+File:   RawScale.h
+Author: J. Ian Lindsay
+Date:   2017.10.24
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Raw sensor data comes off the bus as a block of int16's. Turning it into
+  floats is one subtract and one multiply per value, with an (offset, gain)
+  pair that is fixed until a scale, calibration, or reflection changes. So
+  the pairs are kept in tables laid out exactly like the raw block, and the
+  whole block is converted in one pass.
+
+The pass uses SSE2 or NEON where the compiler says it has them (x86 and ARM
+  Linux builds). Elsewhere (EG, the Cortex-M7) it is a plain loop, which the
+  compiler is free to unroll.
+*/
+
+#ifndef __DIGITABULUM_RAW_SCALE_H__
+#define __DIGITABULUM_RAW_SCALE_H__
+
+#include <inttypes.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+#endif
+
+
+/**
+* out[i] = (raw[i] - off[i]) * gain[i], for i in [0, n).
+* None of the arrays need any particular alignment.
+*
+* @param  raw   The raw values.
+* @param  off   The offset for each value.
+* @param  gain  The gain for each value.
+* @param  out   Receives the results.
+* @param  n     How many values.
+*/
+static inline void raw_scale_s16(const int16_t* raw, const float* off, const float* gain, float* out, unsigned int n) {
+  unsigned int i = 0;
+  #if defined(__SSE2__)
+    for (; (i + 8) <= n; i += 8) {
+      const __m128i r  = _mm_loadu_si128((const __m128i*) (raw + i));
+      // Sign-extend by putting each int16 in the high half, and shifting down.
+      const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(r, r), 16));
+      const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(r, r), 16));
+      _mm_storeu_ps(out + i,     _mm_mul_ps(_mm_sub_ps(lo, _mm_loadu_ps(off + i)),     _mm_loadu_ps(gain + i)));
+      _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_sub_ps(hi, _mm_loadu_ps(off + i + 4)), _mm_loadu_ps(gain + i + 4)));
+    }
+  #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; (i + 8) <= n; i += 8) {
+      const int16x8_t   r  = vld1q_s16(raw + i);
+      const float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(r)));
+      const float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(r)));
+      vst1q_f32(out + i,     vmulq_f32(vsubq_f32(lo, vld1q_f32(off + i)),     vld1q_f32(gain + i)));
+      vst1q_f32(out + i + 4, vmulq_f32(vsubq_f32(hi, vld1q_f32(off + i + 4)), vld1q_f32(gain + i + 4)));
+    }
+  #endif
+  for (; i < n; i++) {
+    out[i] = (raw[i] - off[i]) * gain[i];
+  }
+}
+
+#endif  // __DIGITABULUM_RAW_SCALE_H__
@@ -34,6 +34,10 @@ limitations under the License.
 *******************************************************************************/
 
 uint32_t SensorFrame::_total_sequences = 0;
+std::atomic<uint32_t> SensorFrame::_unwritten_reads{0};
+
+/* What printDebug() shows for a field that was never written. */
+static const Vector3<float> _unwritten_v3;
 
 void SensorFrame::resetSequenceCounter() {
   _total_sequences = 0;
@@ -50,32 +54,37 @@ void SensorFrame::resetSequenceCounter() {
 /**
 * Vanilla constructor. Vector class will initiallize conponents to zero.
 */
-SensorFrame::SensorFrame() : ManuLegend() {
+SensorFrame::SensorFrame() {
+  _gen = 0;
   wipe();
 }
 
 /**
-* Wipes the instance. Sets all member data to 0.0.
+* Wipes the instance. The per-IMU fields are not touched. They are only marked
+*   unwritten, and will read as zero until they are written again.
 */
 void SensorFrame::wipe() {
+  _gen++;
+  _v_quat = 0;
+  _v_acc  = 0;
+  _v_gyr  = 0;
+  _v_mag  = 0;
+  _v_null = 0;
+  _v_temp = 0;
+  _written = 0;
   _read_time = 0.0f;
+  _t_capture = 0;
   _stage     = FrameStage::IDLE;
   _seq = 0;
-  for (int i = 0; i < 17; i++) {
-    a_data[i](0.0f, 0.0f, 0.0f);
-    g_data[i](0.0f, 0.0f, 0.0f);
-    m_data[i](0.0f, 0.0f, 0.0f);
-    v_data[i](0.0f, 0.0f, 0.0f);
-    n_data[i](0.0f, 0.0f, 0.0f);
-    p_data[i](0.0f, 0.0f, 0.0f);
-    quat[i].set(0.0f, 0.0f, 0.0f, 0.0f);
-  }
+  _mag_fresh = 0;
+  hand_position(0.0f, 0.0f, 0.0f);
+  hand.digits = 0;
 }
 
 
 #if defined(MANUVR_IMU_DEBUG)
 void SensorFrame::printDebug(StringBuilder* output) {
-  output->concatf("SensorFrame (0x%02x)\nseq# %u   Delta-t = %.3f sec", (uint8_t) _stage, _seq, time());
+  output->concatf("SensorFrame (0x%02x)\nseq# %u   gen %u   Delta-t = %.3f sec   Fresh mag 0x%05x", (uint8_t) _stage, _seq, (unsigned int) _gen, time(), (unsigned int) _mag_fresh);
   StringBuilder a_line;
   StringBuilder g_line;
   StringBuilder m_line;
@@ -133,9 +142,13 @@ void SensorFrame::printDebug(StringBuilder* output) {
       default:
         break;
     }
-    a_line.concatf("A(%.4f, %.4f, %.4f)  ", (double)a_data[i].x, (double)a_data[i].y, (double)a_data[i].z);
-    g_line.concatf("G(%.4f, %.4f, %.4f)  ", (double)g_data[i].x, (double)g_data[i].y, (double)g_data[i].z);
-    m_line.concatf("M(%.4f, %.4f, %.4f)  ", (double)m_data[i].x, (double)m_data[i].y, (double)m_data[i].z);
+    // Printing is not a read that should count against the frame.
+    const Vector3<float>* a = ((_v_acc >> i) & 1) ? &_acc[i] : &_unwritten_v3;
+    const Vector3<float>* g = ((_v_gyr >> i) & 1) ? &_gyr[i] : &_unwritten_v3;
+    const Vector3<float>* m = ((_v_mag >> i) & 1) ? &_mag[i] : &_unwritten_v3;
+    a_line.concatf("A(%.4f, %.4f, %.4f)  ", (double)a->x, (double)a->y, (double)a->z);
+    g_line.concatf("G(%.4f, %.4f, %.4f)  ", (double)g->x, (double)g->y, (double)g->z);
+    m_line.concatf("M(%.4f, %.4f, %.4f)  ", (double)m->x, (double)m->y, (double)m->z);
   }
 }
 #endif  // MANUVR_IMU_DEBUG
@@ -30,6 +30,7 @@ Orientation
 #define __IIU_MEASUREMENT_H__
 
 #include <inttypes.h>
+#include <atomic>
 #include <DataStructures/Vector3.h>
 #include <DataStructures/Quaternion.h>
 #include "ManuLegend.h"
@@ -62,24 +63,40 @@ enum class FrameStage {
 };
 
 
+/*
+* A sample from every IMU in the read plan, as it came off the bus. This is what
+*   the intake path queues. It is converted to floats (into a SensorFrame) only
+*   when the integrator has room for it.
+* Every field is written at intake, so there is nothing to wipe.
+*/
+class RawFrame {
+  public:
+    int16_t  ag[LEGEND_DATASET_IIU_COUNT * 6];  // A(x, y, z), G(x, y, z) for each IMU.
+    int16_t  m[LEGEND_DATASET_IIU_COUNT * 3];   // M(x, y, z) for each IMU.
+    uint64_t t_us;        // Capture time. See ManuManager::_clock_us().
+    float    dt;          // Time step since the frame before.
+    uint32_t mask_i;      // IMUs with inertial data.
+    uint32_t mask_m;      // IMUs with magnetometer data.
+    uint32_t mag_fresh;   // IMUs whose magnetometer data no earlier frame carried.
+};
+
+
 /*
 * This is a container class that is pushed downstream to the Integrator class,
 *   which will integrate it into a sensible representation of position and
 *   orientation, taking error into account.
+* Frames are pooled, and wiping one is lazy: wipe() bumps the generation and
+*   clears a valid-mask for each field. The field arrays are never cleared.
+*   An accessor that finds its field unwritten this generation zeroes it on
+*   the spot, and counts the read in unwrittenReads(), since reading what
+*   nobody wrote is usually a bug upstream. Such a read doesn't put the IMU
+*   into imuMask(). Only the set*() functions do that.
 * Operations that span many elements are assumed to have element counts of 17.
 */
-class SensorFrame : public ManuLegend {
+class SensorFrame {
   public:
-    // TODO: The dynamic memory pool code that was in ManuLegend should be moved here.
-    Vector4f         quat[17];  // Orientation
-    Vector3<float> a_data[17];  // The vector of the accel data.
-    Vector3<float> g_data[17];  // The vector of the gyro data.
-    Vector3<float> m_data[17];  // The vector of the mag data.
-    Vector3<float> n_data[17];  // Null-grav
-    Vector3<float> v_data[17];  // Velocity
-    Vector3<float> p_data[17];  // Position
-    float     temperature[17];  // Temperature
     Vector3<float> hand_position;
+    HandPose       hand;          // Only filled if the legend asks for the skeleton.
 
     SensorFrame();
 
@@ -88,33 +105,70 @@ class SensorFrame : public ManuLegend {
       void printDebug(StringBuilder* output);
     #endif
 
+    /* Per-IMU fields. Each is zero unless written since the last wipe(). */
+    inline Vector4f&       quat(uint8_t i) {         return _lazy(_quat, &_v_quat, i);    };
+    inline Vector3<float>& acc(uint8_t i) {          return _lazy(_acc,  &_v_acc,  i);    };
+    inline Vector3<float>& gyro(uint8_t i) {         return _lazy(_gyr,  &_v_gyr,  i);    };
+    inline Vector3<float>& mag(uint8_t i) {          return _lazy(_mag,  &_v_mag,  i);    };
+    inline Vector3<float>& nullGrav(uint8_t i) {     return _lazy(_null, &_v_null, i);    };
+    inline float&          temperature(uint8_t i) {  return _lazy(_temp, &_v_temp, i);    };
+
     inline uint32_t seq() {         return _seq;       };
     inline float   time() {         return _read_time; };
     inline void    time(float x) {  _read_time = x;    };
 
+    /* When the sample was captured, in microseconds. See ManuManager::_clock_us(). */
+    inline uint64_t captureTime() {            return _t_capture;  };
+    inline void     captureTime(uint64_t x) {  _t_capture = x;     };
+
+    /* The IMUs that this frame has data for. */
+    inline uint32_t imuMask() {     return _written;   };
+
+    /*
+    * Bumped by every wipe(). Something that holds a frame across a handoff can
+    *   note this, and later tell if the frame was recycled under it.
+    */
+    inline uint32_t generation() {   return _gen;   };
+
     inline void setO(uint8_t i, float w, float x, float y, float z) {
-      quat[i].set(w, x, y, z);
+      _quat[i].set(w, x, y, z);
+      _v_quat  |= (1UL << i);
+      _written |= (1UL << i);
     };
 
     inline void setI(uint8_t i, float ax, float ay, float az, float gx, float gy, float gz) {
-      a_data[i](ax, ay, az);
-      g_data[i](gx, gy, gz);
+      _acc[i](ax, ay, az);
+      _gyr[i](gx, gy, gz);
+      _v_acc   |= (1UL << i);
+      _v_gyr   |= (1UL << i);
+      _written |= (1UL << i);
     };
 
     inline void setM(uint8_t i, float x, float y, float z) {
-      m_data[i](x, y, z);
+      _mag[i](x, y, z);
+      _v_mag   |= (1UL << i);
+      _written |= (1UL << i);
     };
 
-    inline void setV(uint8_t i, float x, float y, float z) {
-      v_data[i](x, y, z);
+    inline void setT(uint8_t i, float x) {
+      _temp[i] = x;
+      _v_temp  |= (1UL << i);
+      _written |= (1UL << i);
     };
 
-    inline void setN(uint8_t i, float x, float y, float z) {
-      n_data[i](x, y, z);
-    };
+    /*
+    * Magnetometer data is sampled-and-held. mag(i) always has the last
+    *   sample from IMU i, but only the IMUs in this mask have a sample that no
+    *   earlier frame carried.
+    */
+    inline uint32_t magFresh() {             return _mag_fresh;                };
+    inline bool     magFresh(uint8_t i) {    return (_mag_fresh >> i) & 1;     };
+    inline void     magFresh(uint32_t m) {   _mag_fresh = m;                   };
 
-    inline void setP(uint8_t i, float x, float y, float z) {
-      p_data[i](x, y, z);
+    inline void setN(uint8_t i, float x, float y, float z) {
+      _null[i](x, y, z);
+      _v_null  |= (1UL << i);
+      _written |= (1UL << i);
     };
 
     inline FrameStage stage() {
@@ -130,16 +184,47 @@ class SensorFrame : public ManuLegend {
 
 
     static void resetSequenceCounter();
+    static uint32_t unwrittenReads() {   return _unwritten_reads.load(std::memory_order_relaxed);   };
 
 
 
   private:
+    Vector4f       _quat[17];  // Orientation
+    Vector3<float> _acc[17];   // The vector of the accel data.
+    Vector3<float> _gyr[17];   // The vector of the gyro data.
+    Vector3<float> _mag[17];   // The vector of the mag data.
+    Vector3<float> _null[17];  // Null-grav
+    float          _temp[17];  // Temperature
+    uint32_t   _v_quat;     // Bit i set if _quat[i] is good this generation (written, or zeroed).
+    uint32_t   _v_acc;      // ...and so on, for each field.
+    uint32_t   _v_gyr;
+    uint32_t   _v_mag;
+    uint32_t   _v_null;
+    uint32_t   _v_temp;
+    uint32_t   _written;    // Bit i set if any set*() was called for IMU i this generation.
+    uint32_t   _gen;        // Generation. See generation().
     uint32_t   _seq;        // Sequence number
     float      _read_time;  // Derived from the system time when the values arrived from the sensor.
+    uint64_t   _t_capture;  // Capture time of the sample, in microseconds.
+    uint32_t   _mag_fresh;  // Bit i set if mag(i) is new in this frame.
     FrameStage _stage;      // Tracks the integration efforts across sync barriers.
 
+    static inline void _zero(Vector3<float>& v) {  v(0.0f, 0.0f, 0.0f);          };
+    static inline void _zero(Vector4f& v) {        v.set(0.0f, 0.0f, 0.0f, 0.0f); };
+    static inline void _zero(float& v) {           v = 0.0f;                      };
+
+    /* Returns the field for IMU i, zeroing it first if it is stale. */
+    template <typename T> static inline T& _lazy(T* field, uint32_t* valid, uint8_t i) {
+      if (0 == ((*valid >> i) & 1)) {
+        _zero(field[i]);
+        *valid |= (1UL << i);   // Remembers the zeroing. Not a write.
+        _unwritten_reads.fetch_add(1, std::memory_order_relaxed);
+      }
+      return field[i];
+    };
 
     static uint32_t _total_sequences;  // We try to keep details hidden.
+    static std::atomic<uint32_t> _unwritten_reads;  // Fields read before being written. Counted from any thread.
 };
 
 #endif  //__IIU_MEASUREMENT_H__
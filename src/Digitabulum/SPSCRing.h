@@ -0,0 +1,118 @@
+/*
+File:   SPSCRing.h
+Author: J. Ian Lindsay
+Date:   2017.10.21
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+A fixed-capacity ring for passing items from exactly one producer context to
+  exactly one consumer context (EG, from an ISR to the kernel's event loop).
+
+Both ends are wait-free: insert() and get() are O(1), never allocate, and
+  never block on the other side. The producer owns _head, the consumer owns
+  _tail, and each side only ever reads the other's index. So there is no need
+  to mask interrupts around either call.
+
+If more than one context can produce (or consume), the caller must serialize
+  those contexts. This class will not do it for you.
+
+N must be a power of two. One slot is never used, so as to tell full from
+  empty without a shared count.
+*/
+
+#ifndef __DIGITABULUM_SPSC_RING_H__
+#define __DIGITABULUM_SPSC_RING_H__
+
+#include <inttypes.h>
+#include <atomic>
+
+
+template <class T, unsigned int N> class SPSCRing {
+  static_assert((N >= 2) && (0 == (N & (N - 1))), "SPSCRing capacity must be a power of two.");
+
+  public:
+    SPSCRing() {};
+
+    /**
+    * Producer-side only.
+    *
+    * @param  x  The item to add to the ring.
+    * @return 0 on success, or -1 if the ring was full. The item is not added in that case.
+    */
+    inline int8_t insert(T x) {
+      const unsigned int h = _head.load(std::memory_order_relaxed);
+      const unsigned int t = _tail.load(std::memory_order_acquire);
+      const unsigned int n = ((h + 1) & (N - 1));
+      if (n == t) {
+        _overflows++;
+        return -1;
+      }
+      _pool[h] = x;
+      _head.store(n, std::memory_order_release);
+      const unsigned int depth = ((n - t) & (N - 1));
+      if (depth > _high_water) _high_water = depth;
+      return 0;
+    };
+
+    /**
+    * Consumer-side only.
+    *
+    * @param  x  Receives the oldest item in the ring, if there is one.
+    * @return true if an item was taken.
+    */
+    inline bool get(T* x) {
+      const unsigned int t = _tail.load(std::memory_order_relaxed);
+      if (t == _head.load(std::memory_order_acquire)) {
+        return false;
+      }
+      *x = _pool[t];
+      _tail.store(((t + 1) & (N - 1)), std::memory_order_release);
+      return true;
+    };
+
+    /**
+    * Safe to call from either side. The answer might be stale by the time the
+    *   caller acts on it, but it will never be torn.
+    *
+    * @return The number of items in the ring.
+    */
+    inline unsigned int count() {
+      return ((_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire)) & (N - 1));
+    };
+
+    inline bool         isEmpty() {    return (0 == count());   };
+    inline unsigned int capacity() {   return (N - 1);          };
+    inline unsigned int highWater() {  return _high_water;      };
+    inline uint32_t     overflows() {  return _overflows;       };
+
+    /**
+    * Clears the profiling counters. Doesn't touch the contents.
+    */
+    inline void resetStats() {
+      _high_water = count();
+      _overflows  = 0;
+    };
+
+
+  private:
+    T _pool[N];
+    std::atomic<unsigned int> _head{0};  // Next slot to be written. Owned by the producer.
+    std::atomic<unsigned int> _tail{0};  // Next slot to be read. Owned by the consumer.
+    unsigned int _high_water = 0;        // Deepest the ring has been. Written by the producer.
+    uint32_t     _overflows  = 0;        // Rejected inserts. Written by the producer.
+};
+
+#endif  // __DIGITABULUM_SPSC_RING_H__
@@ -15,4 +15,4 @@ CPPFLAGS += -D__MANUVR_ESP32
 COMPONENT_SRCDIRS := CPLDDriver LSM9DS1 ManuLegend DigitabulumPMU .
 #COMPONENT_ADD_LDFLAGS := -L$(OUTPUT_PATH)/Digitabulum
 
-COMPONENT_OBJS := Digitabulum.o CPLDDriver/CPLDDriver.o LSM9DS1/LSM9DS1.o LSM9DS1/RegPtrMap.o ManuLegend/SensorFrame.o ManuLegend/Integrator.o ManuLegend/ManuManager.o ManuLegend/ManuLegend.o ManuLegend/ManuLegendPipe.o DigitabulumPMU/DigitabulumPMU-r2.o
+COMPONENT_OBJS := Digitabulum.o CPLDDriver/CPLDDriver.o CPLDDriver/BusProfiler.o LSM9DS1/LSM9DS1.o LSM9DS1/RegPtrMap.o ManuLegend/SensorFrame.o ManuLegend/Integrator.o ManuLegend/IntegratorWorker.o ManuLegend/ManuManager.o ManuLegend/ManuLegend.o ManuLegend/ManuLegendPipe.o DigitabulumPMU/DigitabulumPMU-r2.o
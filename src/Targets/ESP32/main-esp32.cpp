@@ -276,8 +276,9 @@ void app_main() {
   platform.platformPreInit();
   gpioDefine(ESP32_LED_PIN, GPIOMode::OUTPUT);
 
-  // The entire front-end driver apparatus lives on the stack.
-  xTaskCreate(manuvr_task, "_manuvr", 48000, NULL, (tskIDLE_PRIORITY + 2), NULL);
+  // The entire front-end driver apparatus lives on the stack. The kernel keeps
+  //   to the PRO core, so that the Integrator can have the APP core.
+  xTaskCreatePinnedToCore(manuvr_task, "_manuvr", 48000, NULL, (tskIDLE_PRIORITY + 2), NULL, 0);
 
   // TODO: Ultimately generalize this... Taken from ESP32 examples....
   // https://github.com/espressif/esp-idf/blob/master/examples/protocols/sntp/main/sntp_example_main.c
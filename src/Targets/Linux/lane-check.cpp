@@ -0,0 +1,266 @@
+/*
+File:   lane-check.cpp
+Author: J. Ian Lindsay
+Date:   2017.11.04
+
+Copyright 2017 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+    .__       ,    .     .
+    |  \* _ *-+- _.|_ . .|. .._ _
+    |__/|(_]| | (_][_)(_||(_|[ | )
+         ._|
+
+Checks the lane kernel (madgwick_soa()) against MadgwickFusion, which it is
+  meant to match to rounding. Needs nothing but the two filter headers, so it
+  builds on any host:
+
+    make PLATFORM=LINUX lanecheck
+
+The frames are those of Integrator::benchKernels(): made-up samples for all 17
+  IMUs, from the same xorshift32 sequence. Among them...
+    IMU 3 has no accelerometer data.
+    IMU 5 has a magnetometer reading too large to be the Earth's.
+    IMU 11 sits out every other frame, so its dt doubles.
+    Each IMU's magnetometer is fresh one frame in three, and stale (6-DOF)
+      otherwise.
+Each run is repeated for every IMU count from 1 to 17, so every remainder of
+  the lane count by four is padded. The inputs are prepared as in
+  Integrator::_integrate_with() and Integrator::_integrate_lanes().
+
+Exits non-zero if any quaternion component differs by more than
+  LANE_CHECK_TOLERANCE, if the two disagree on which updates fused the
+  magnetometer, or if a padding lane moves.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "ManuLegend/FusionFilters.h"
+#include "ManuLegend/MadgwickSoA.h"
+
+/* Largest difference allowed in any quaternion component. */
+#define LANE_CHECK_TOLERANCE   1e-5f
+
+#define LANE_CHECK_IMUS        17
+#define LANE_CHECK_FRAMES      500
+#define LANE_CHECK_DT_US       10000
+#define LANE_CHECK_MAG_THRESH  0.8f    // Integrator's default, in Gauss.
+#define DEG_TO_RAD             (3.14159f / 180.0f)   // As IIU_DEG_TO_RAD_SCALAR.
+
+
+/* One IMU's sample in a bench frame. */
+typedef struct {
+  float g[3];     // dps
+  float a[3];
+  float m[3];
+  bool  present;
+  bool  fresh;
+} BenchSample;
+
+
+/**
+* Fills a frame as _fill_bench_frame() does.
+*
+* @param  f  The frame. LANE_CHECK_IMUS samples.
+* @param  x  xorshift32 state.
+* @param  n  The frame's number in the run.
+*/
+static void fill_frame(BenchSample* f, uint32_t* x, uint32_t n) {
+  for (uint8_t i = 0; i < LANE_CHECK_IMUS; i++) {
+    float v[9];
+    for (uint8_t j = 0; j < 9; j++) {
+      *x ^= *x << 13;  *x ^= *x >> 17;  *x ^= *x << 5;   // xorshift32
+      v[j] = ((int32_t) *x) / 2147483648.0f;
+    }
+    BenchSample* s = &f[i];
+    s->present = !((11 == i) && (n & 1));
+    if (!s->present) continue;
+    if (3 == i) {
+      v[0] = 0.0f;
+      v[1] = 0.0f;
+      v[2] = 0.0f;
+    }
+    s->a[0] = v[0] * 2.0f;    s->a[1] = v[1] * 2.0f;    s->a[2] = v[2] * 2.0f;
+    s->g[0] = v[3] * 200.0f;  s->g[1] = v[4] * 200.0f;  s->g[2] = v[5] * 200.0f;
+    if (5 == i) {
+      s->m[0] = 3.0f;  s->m[1] = 0.0f;  s->m[2] = 0.0f;
+    }
+    else {
+      s->m[0] = v[6] * 0.6f;  s->m[1] = v[7] * 0.6f;  s->m[2] = v[8] * 0.6f;
+    }
+    s->fresh = (0 == ((n + i) % 3));
+  }
+}
+
+
+/**
+* Normalizes a vector in place, as Vector3::normalize() does.
+*
+* @return The vector's length before. A zero vector is left alone.
+*/
+static float normalize(float* v) {
+  const float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  if (0.0f != len) {
+    v[0] /= len;
+    v[1] /= len;
+    v[2] /= len;
+  }
+  return len;
+}
+
+
+/**
+* Runs one configuration through both kernels.
+*
+* @param  imus        How many IMUs take part. The first ones.
+* @param  iterations  Filter steps per frame.
+* @param  drop        Refuse mag samples at or above LANE_CHECK_MAG_THRESH?
+* @param  worst       Raised to the largest difference seen.
+* @return The number of failures.
+*/
+static unsigned int check_run(uint8_t imus, uint8_t iterations, bool drop, float* worst) {
+  static MadgwickLanes L;
+  float    q_s[LANE_CHECK_IMUS][4];   // Scalar.
+  float    q_l[LANE_CHECK_IMUS][4];   // Lanes.
+  uint32_t last_n[LANE_CHECK_IMUS];   // Frame of the last update, plus one. 0 if none.
+  uint8_t  lane_imu[MADGWICK_SOA_LANES];
+  bool     nine_s[LANE_CHECK_IMUS];
+  BenchSample f[LANE_CHECK_IMUS];
+  unsigned int fails = 0;
+  uint32_t x = 0x2545F491;
+
+  FusionParams p;
+  memset(&p, 0, sizeof(p));
+  p.beta       = 0.2f;
+  p.iterations = iterations;
+
+  for (uint8_t i = 0; i < LANE_CHECK_IMUS; i++) {
+    q_s[i][0] = 1.0f;  q_s[i][1] = 0.0f;  q_s[i][2] = 0.0f;  q_s[i][3] = 0.0f;
+    memcpy(q_l[i], q_s[i], sizeof(q_s[i]));
+    last_n[i] = 0;
+  }
+
+  for (uint32_t n = 0; n < LANE_CHECK_FRAMES; n++) {
+    fill_frame(f, &x, n);
+
+    // Scalar, as _integrate_with<MadgwickFusion>().
+    for (uint8_t i = 0; i < imus; i++) {
+      if (!f[i].present) continue;
+      BenchSample s = f[i];
+      FusionInput in;
+      in.gx = s.g[0] * DEG_TO_RAD;
+      in.gy = s.g[1] * DEG_TO_RAD;
+      in.gz = s.g[2] * DEG_TO_RAD;
+      normalize(s.a);
+      in.ax = s.a[0];
+      in.ay = s.a[1];
+      in.az = s.a[2];
+      const float m_len = s.fresh ? normalize(s.m) : 0.0f;
+      const bool  use_m = (0.0f != m_len) && !(drop && (m_len >= LANE_CHECK_MAG_THRESH));
+      in.mx = use_m ? s.m[0] : 0.0f;
+      in.my = use_m ? s.m[1] : 0.0f;
+      in.mz = use_m ? s.m[2] : 0.0f;
+      in.dt = (0 != last_n[i]) ? ((n + 1 - last_n[i]) * LANE_CHECK_DT_US * 1e-6f) : (LANE_CHECK_DT_US * 1e-6f);
+      nine_s[i] = MadgwickFusion::update(q_s[i], nullptr, &in, &p);
+    }
+
+    // Lanes, as _integrate_lanes(). IMUs are packed into consecutive lanes.
+    uint8_t lanes = 0;
+    for (uint8_t i = 0; i < imus; i++) {
+      if (!f[i].present) continue;
+      const BenchSample* s = &f[i];
+      lane_imu[lanes] = i;
+      L.q0[lanes] = q_l[i][0];
+      L.q1[lanes] = q_l[i][1];
+      L.q2[lanes] = q_l[i][2];
+      L.q3[lanes] = q_l[i][3];
+      L.gx[lanes] = s->g[0] * DEG_TO_RAD;
+      L.gy[lanes] = s->g[1] * DEG_TO_RAD;
+      L.gz[lanes] = s->g[2] * DEG_TO_RAD;
+      L.ax[lanes] = s->a[0];
+      L.ay[lanes] = s->a[1];
+      L.az[lanes] = s->a[2];
+      L.mx[lanes] = s->fresh ? s->m[0] : 0.0f;
+      L.my[lanes] = s->fresh ? s->m[1] : 0.0f;
+      L.mz[lanes] = s->fresh ? s->m[2] : 0.0f;
+      L.fresh[lanes] = s->fresh ? 1.0f : 0.0f;
+      L.dt[lanes] = (0 != last_n[i]) ? ((n + 1 - last_n[i]) * LANE_CHECK_DT_US * 1e-6f) : (LANE_CHECK_DT_US * 1e-6f);
+      lanes++;
+    }
+    if (0 == lanes) continue;
+    uint8_t padded = lanes;
+    for (; 0 != (padded & 3); padded++) madgwick_soa_pad(&L, padded);
+    madgwick_soa(&L, lanes, p.beta, p.iterations, drop, LANE_CHECK_MAG_THRESH);
+
+    for (uint8_t l = 0; l < lanes; l++) {
+      const uint8_t i = lane_imu[l];
+      q_l[i][0] = L.q0[l];
+      q_l[i][1] = L.q1[l];
+      q_l[i][2] = L.q2[l];
+      q_l[i][3] = L.q3[l];
+      last_n[i] = n + 1;
+      if (nine_s[i] != (0.0f != L.nine[l])) {
+        printf("FAIL  %2u IMUs, %u it, drop %s: frame %u IMU %u fused the mag %s\n",
+          imus, iterations, (drop ? "on" : "off"), (unsigned int) n, i,
+          (nine_s[i] ? "in the scalar code only" : "in the lanes only")
+        );
+        fails++;
+      }
+      for (uint8_t j = 0; j < 4; j++) {
+        const float d = fabsf(q_s[i][j] - q_l[i][j]);
+        if (d > *worst) *worst = d;
+        if (!(d <= LANE_CHECK_TOLERANCE)) {
+          printf("FAIL  %2u IMUs, %u it, drop %s: frame %u IMU %u q[%u] %.9f vs %.9f\n",
+            imus, iterations, (drop ? "on" : "off"), (unsigned int) n, i, j,
+            (double) q_s[i][j], (double) q_l[i][j]
+          );
+          fails++;
+        }
+      }
+    }
+    for (uint8_t l = lanes; l < padded; l++) {
+      if ((1.0f != L.q0[l]) || (0.0f != L.q1[l]) || (0.0f != L.q2[l]) || (0.0f != L.q3[l])) {
+        printf("FAIL  %2u IMUs, %u it, drop %s: frame %u padding lane %u moved\n",
+          imus, iterations, (drop ? "on" : "off"), (unsigned int) n, l
+        );
+        fails++;
+      }
+    }
+    if (fails > 20) break;   // Enough to go on.
+  }
+  return fails;
+}
+
+
+/*******************************************************************************
+* The main function.                                                           *
+*******************************************************************************/
+int main(int argc, const char *argv[]) {
+  unsigned int fails = 0;
+  unsigned int runs  = 0;
+  float worst = 0.0f;
+  for (uint8_t imus = 1; imus <= LANE_CHECK_IMUS; imus++) {
+    for (uint8_t it = 1; it <= 3; it += 2) {
+      fails += check_run(imus, it, false, &worst);
+      fails += check_run(imus, it, true, &worst);
+      runs  += 2;
+    }
+  }
+  printf("Lane kernel (%s) vs %s: %u runs of %u frames. Worst difference %.9f (tolerance %.9f). %s\n",
+    madgwick_soa_isa(), MadgwickFusion::name(), runs, LANE_CHECK_FRAMES,
+    (double) worst, (double) LANE_CHECK_TOLERANCE, (fails ? "FAILED" : "OK")
+  );
+  return (fails ? 1 : 0);
+}
@@ -61,13 +61,16 @@ LDFLAGS += -L. -L$(OUTPUT_PATH)
 ###########################################################################
 DRIVER_SRCS   = src/Targets/Linux/host-driver.cpp
 FIRMWARE_SRCS = src/Targets/Linux/main-emu.cpp
+CHECK_SRCS    = src/Targets/Linux/lane-check.cpp
 
 CXX_SRCS   = src/Digitabulum/Digitabulum.cpp
 CXX_SRCS  += src/Digitabulum/CPLDDriver/CPLDDriver.cpp
+CXX_SRCS  += src/Digitabulum/CPLDDriver/BusProfiler.cpp
 CXX_SRCS  += src/Digitabulum/LSM9DS1/LSM9DS1.cpp
 CXX_SRCS  += src/Digitabulum/LSM9DS1/RegPtrMap.cpp
 CXX_SRCS  += src/Digitabulum/ManuLegend/SensorFrame.cpp
 CXX_SRCS  += src/Digitabulum/ManuLegend/Integrator.cpp
+CXX_SRCS  += src/Digitabulum/ManuLegend/IntegratorWorker.cpp
 CXX_SRCS  += src/Digitabulum/ManuLegend/ManuManager.cpp
 CXX_SRCS  += src/Digitabulum/ManuLegend/ManuLegend.cpp
 CXX_SRCS  += src/Digitabulum/ManuLegend/ManuLegendPipe.cpp
@@ -77,6 +80,7 @@ CXX_SRCS  += src/Digitabulum/DigitabulumPMU/DigitabulumPMU-r2.cpp
 # Option conditionals
 ###########################################################################
 MANUVR_OPTIONS += -D__MANUVR_LINUX
+MANUVR_OPTIONS += -DCONFIG_INTEGRATOR_THREADED
 
 # Debugging options...
 ifeq ($(SECURE),1)
@@ -132,7 +136,7 @@ export CXXFLAGS += $(CFLAGS)
 vpath %.a $(OUTPUT_PATH)
 
 
-.PHONY: all
+.PHONY: all lanecheck
 
 all: firmware
 	$(SZ) $(OUTPUT_PATH)/$(FIRMWARE_NAME)
@@ -153,6 +157,15 @@ firmware: $(OBJS) $(FIRMWARE_OBJS) libs
 driver: $(OBJS) $(DRIVER_OBJS) libs
 	$(CXX) $(DRIVER_OBJS) $(OBJS) -o $(OUTPUT_PATH)/demo-driver $(CXXFLAGS) -std=$(CXX_STANDARD) $(LDFLAGS)
 
+# Checks the lane kernel against the scalar filter, both with the host's
+#   vector unit and without. Needs no libraries.
+lanecheck: $(CHECK_SRCS)
+	mkdir -p $(OUTPUT_PATH)
+	$(CXX) -std=$(CXX_STANDARD) $(OPTIMIZATION) -Wall -iquotesrc/Digitabulum $^ -o $(OUTPUT_PATH)/lane-check -lm
+	$(CXX) -std=$(CXX_STANDARD) $(OPTIMIZATION) -Wall -iquotesrc/Digitabulum -U__SSE2__ $^ -o $(OUTPUT_PATH)/lane-check-portable -lm
+	$(OUTPUT_PATH)/lane-check
+	$(OUTPUT_PATH)/lane-check-portable
+
 coverage: $(OUTPUT_PATH)/$(FIRMWARE_NAME)
 	#$(OUTPUT_PATH)/$(FIRMWARE_NAME) --run-tests
 	$(GCOV) --demangled-names --preserve-paths --source-prefix $(BUILD_ROOT) $(CXX_SRCS) $(C_SRCS)
@@ -95,10 +95,12 @@ SOURCES_C    += src/Targets/STM32F7/stm32f7xx_it.c
 SOURCES_C    += src/Targets/STM32F7/system_stm32f7xx.c
 
 SOURCES_CPP   = src/Digitabulum/CPLDDriver/CPLDDriver.cpp
+SOURCES_CPP  += src/Digitabulum/CPLDDriver/BusProfiler.cpp
 SOURCES_CPP  += src/Digitabulum/LSM9DS1/LSM9DS1.cpp
 SOURCES_CPP  += src/Digitabulum/LSM9DS1/RegPtrMap.cpp
 SOURCES_CPP  += src/Digitabulum/ManuLegend/SensorFrame.cpp
 SOURCES_CPP  += src/Digitabulum/ManuLegend/Integrator.cpp
+SOURCES_CPP  += src/Digitabulum/ManuLegend/IntegratorWorker.cpp
 SOURCES_CPP  += src/Digitabulum/ManuLegend/ManuManager.cpp
 SOURCES_CPP  += src/Digitabulum/ManuLegend/ManuLegend.cpp
 SOURCES_CPP  += src/Digitabulum/ManuLegend/ManuLegendPipe.cpp
@@ -133,6 +135,9 @@ INCLUDES   += -Ilib/Middlewares/Third_Party/FreeRTOS/Source/include
 INCLUDES   += -Ilib/Middlewares/Third_Party/FreeRTOS/Source/portable/GCC/ARM_CM7/r0p1
 SOURCES_C  += src/Targets/STM32F7/freertos.c
 MANUVR_OPTIONS += -D__BUILD_HAS_FREERTOS
+# The scheduler isn't started yet (see osKernelStart() in main.cpp). Until it
+#   is, a worker task would never run, and integration would stop.
+#MANUVR_OPTIONS += -DCONFIG_INTEGRATOR_THREADED
 export THREADS=1
 endif
 